@@ -0,0 +1,116 @@
+#include "gtest/gtest.h"
+#include "../batch_cpu.hpp"
+#include "../cpu.hpp"
+#include "../memory.hpp"
+#include <algorithm>
+#include <cstring>
+#include <memory>
+#include <random>
+
+namespace {
+
+constexpr uint16_t PROGRAM_START = 0x0200;
+
+// Random registers and memory, a random program at $0200, and every vector
+// pointing back at the program.
+void randomLane(BatchCPU& batch, size_t lane, std::mt19937& rng) {
+    uint8_t* mem = batch.memory(lane);
+    for (size_t i = 0; i < batch.memorySize(); ++i) {
+        mem[i] = static_cast<uint8_t>(rng());
+    }
+    for (size_t vector = batch.memorySize() - 6; vector < batch.memorySize(); vector += 2) {
+        mem[vector] = PROGRAM_START & 0xFF;
+        mem[vector + 1] = PROGRAM_START >> 8;
+    }
+    batch.a[lane] = rng() & 0xFF;
+    batch.x[lane] = rng() & 0xFF;
+    batch.y[lane] = rng() & 0xFF;
+    batch.ps[lane] = (rng() & 0xFF) | CPU::AF_RESERVED;
+    batch.sp[lane] = rng() & 0xFF;
+    batch.pc[lane] = PROGRAM_START;
+}
+
+// Lanes 0-7 each run their own program; lanes 8-15, if present, share one
+// program but start from different registers, so they mostly step as a group.
+void setUp(BatchCPU& batch, uint32_t seed) {
+    std::mt19937 rng(seed);
+    for (size_t lane = 0; lane < batch.lanes(); ++lane) {
+        randomLane(batch, lane, rng);
+    }
+    for (size_t lane = 9; lane < std::min<size_t>(16, batch.lanes()); ++lane) {
+        memcpy(batch.memory(lane), batch.memory(8), batch.memorySize());
+    }
+}
+
+} // namespace
+
+// Group steps and single-lane steps must be indistinguishable.
+TEST(BatchCPUTest, GroupStepsMatchLaneSteps) {
+    for (uint32_t seed = 1; seed <= 50; ++seed) {
+        BatchCPU grouped(16);
+        BatchCPU single(16);
+        setUp(grouped, seed);
+        setUp(single, seed);
+        single.vectorized = false;
+        grouped.execute(2000);
+        single.execute(2000);
+        for (size_t lane = 0; lane < 16; ++lane) {
+            SCOPED_TRACE("seed " + std::to_string(seed) + " lane " + std::to_string(lane));
+            EXPECT_EQ(grouped.a[lane], single.a[lane]);
+            EXPECT_EQ(grouped.x[lane], single.x[lane]);
+            EXPECT_EQ(grouped.y[lane], single.y[lane]);
+            EXPECT_EQ(grouped.ps[lane], single.ps[lane]);
+            EXPECT_EQ(grouped.sp[lane], single.sp[lane]);
+            EXPECT_EQ(grouped.pc[lane], single.pc[lane]);
+            EXPECT_EQ(grouped.cycles[lane], single.cycles[lane]);
+            EXPECT_EQ(0, memcmp(grouped.memory(lane), single.memory(lane), grouped.memorySize()));
+        }
+        EXPECT_GT(grouped.groupSteps, 0u);
+    }
+}
+
+// With a full 64K per lane the batch engine matches CPU::execute exactly.
+TEST(BatchCPUTest, MatchesScalarCPU) {
+    BatchCPU batch(8, Memory::ADDRESS_SPACE_SIZE);
+    int compared = 0;
+    for (uint32_t seed = 100; seed < 140; ++seed) {
+        setUp(batch, seed);
+        std::vector<std::unique_ptr<Memory>> mems;
+        std::vector<std::unique_ptr<CPU>> cpus;
+        for (size_t lane = 0; lane < batch.lanes(); ++lane) {
+            mems.push_back(std::make_unique<Memory>());
+            memcpy(mems.back()->data.data(), batch.memory(lane), Memory::ADDRESS_SPACE_SIZE);
+            cpus.push_back(std::make_unique<CPU>(*mems.back()));
+            CPU& cpu = *cpus.back();
+            cpu.a = batch.a[lane];
+            cpu.x = batch.x[lane];
+            cpu.y = batch.y[lane];
+            cpu.ps = batch.ps[lane];
+            cpu.sp = batch.sp[lane];
+            cpu.pc = batch.pc[lane];
+            cpu.cycles = 0;
+            batch.cycles[lane] = 0;
+        }
+        batch.execute(5000);
+        for (size_t lane = 0; lane < batch.lanes(); ++lane) {
+            CPU& cpu = *cpus[lane];
+            cpu.execute(5000);
+            // Memory has soft switches at $C000-$C0FF; the batch engine is plain RAM
+            const uint8_t* mem = batch.memory(lane);
+            if (mem[0xC000] != mems[lane]->data[0xC000] || mem[0xC010] != mems[lane]->data[0xC010]) {
+                continue;
+            }
+            SCOPED_TRACE("seed " + std::to_string(seed) + " lane " + std::to_string(lane));
+            EXPECT_EQ(batch.a[lane], cpu.a);
+            EXPECT_EQ(batch.x[lane], cpu.x);
+            EXPECT_EQ(batch.y[lane], cpu.y);
+            EXPECT_EQ(batch.ps[lane], cpu.ps);
+            EXPECT_EQ(batch.sp[lane], cpu.sp);
+            EXPECT_EQ(batch.pc[lane], cpu.pc);
+            EXPECT_EQ(batch.cycles[lane], cpu.cycles);
+            EXPECT_EQ(0, memcmp(mem, mems[lane]->data.data(), Memory::ADDRESS_SPACE_SIZE));
+            compared++;
+        }
+    }
+    EXPECT_GT(compared, 250);
+}
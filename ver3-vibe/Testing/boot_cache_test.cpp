@@ -0,0 +1,105 @@
+#include "gtest/gtest.h"
+#include "../boot_cache.hpp"
+#include <cstring>
+#include <filesystem>
+
+namespace {
+
+const char* const CACHE_DIR = "boot_cache_test";
+
+// 12K ROM that behaves like the Autostart Monitor: a cold reset sets the
+// power-up byte and jumps to the slot 6 boot PROM, a warm one prints a
+// marker and waits in KEYIN. `marker` tells ROMs apart.
+std::vector<uint8_t> autostartRom(uint8_t marker) {
+    std::vector<uint8_t> rom(Machine::ROM_SIZE, 0xEA);
+    auto put = [&](uint16_t address, std::initializer_list<uint8_t> bytes) {
+        std::copy(bytes.begin(), bytes.end(), rom.begin() + (address - Machine::ROM_START));
+    };
+    put(0xFD1B, {0xE6, 0x4E, 0xD0, 0x02, 0xE6, 0x4F,   // KEYIN: INC RNDL / BNE / INC RNDH
+                 0x2C, 0x00, 0xC0, 0x10, 0xF5,         //        BIT KBD / BPL KEYIN
+                 0xAD, 0x00, 0xC0, 0x2C, 0x10, 0xC0,   //        LDA KBD / BIT KBDSTRB
+                 0x60});                               //        RTS
+    put(0xE000, {0xAD, 0xF4, 0x03,                     // LDA $03F4
+                 0xC9, 0xA5,                           // CMP #$A5
+                 0xF0, 0x08,                           // BEQ warm
+                 0xA9, 0xA5,                           // LDA #$A5
+                 0x8D, 0xF4, 0x03,                     // STA $03F4
+                 0x4C, 0x00, 0xC6,                     // JMP $C600
+                 0xA9, marker,                         // warm: LDA #marker
+                 0x8D, 0x00, 0x04,                     // STA $0400
+                 0x20, 0x1B, 0xFD,                     // JSR KEYIN
+                 0x8D, 0x01, 0x04,                     // STA $0401
+                 0x4C, 0x14, 0xE0});                   // JMP $E014
+    put(0xFFFC, {0x00, 0xE0});
+    return rom;
+}
+
+class BootCacheTest : public ::testing::Test {
+protected:
+    void SetUp() override { std::filesystem::remove_all(CACHE_DIR); }
+    void TearDown() override { std::filesystem::remove_all(CACHE_DIR); }
+};
+
+} // namespace
+
+// Starting at DiskBoot and running on matches a cold boot cycle for cycle.
+TEST_F(BootCacheTest, SnapshotsMatchAColdBoot) {
+    std::vector<uint8_t> rom = autostartRom('A');
+    BootCache cache(rom, CACHE_DIR);
+    ASSERT_TRUE(cache.prepare());
+    EXPECT_TRUE(std::filesystem::exists(cache.path(BootCache::Point::DiskBoot)));
+    EXPECT_TRUE(std::filesystem::exists(cache.path(BootCache::Point::Prompt)));
+
+    const uint64_t total = 40 * Machine::SLICE_CYCLES;
+    Machine cold(rom);
+    cold.run(total);
+    Machine warm(rom);
+    cache.start(warm, BootCache::Point::DiskBoot);
+    EXPECT_EQ(warm.cpu.pc >> 8, 0xC6);
+    warm.run(total - warm.cpu.cycles);
+    EXPECT_EQ(warm.cpu.cycles, cold.cpu.cycles);
+    EXPECT_EQ(warm.cpu.pc, cold.cpu.pc);
+    EXPECT_EQ(0, memcmp(warm.memory.data.data(), cold.memory.data.data(), Memory::ADDRESS_SPACE_SIZE));
+
+    Machine ready(rom);
+    cache.start(ready, BootCache::Point::Prompt);
+    EXPECT_EQ(ready.memory.data[0x0400], 'A');
+    ready.type("Z");
+    EXPECT_EQ(ready.run(10 * Machine::SLICE_CYCLES), Machine::Exit::Idle);
+    EXPECT_EQ(ready.memory.data[0x0401], 'Z' | 0x80);
+}
+
+TEST_F(BootCacheTest, ReusesFilesOnlyForTheSameRom) {
+    std::vector<uint8_t> romA = autostartRom('A');
+    std::vector<uint8_t> romB = autostartRom('B');
+    BootCache a(romA, CACHE_DIR);
+    BootCache b(romB, CACHE_DIR);
+    ASSERT_NE(BootCache::checksum(romA), BootCache::checksum(romB));
+    ASSERT_NE(a.path(BootCache::Point::Prompt), b.path(BootCache::Point::Prompt));
+    ASSERT_TRUE(a.prepare());
+
+    // A second cache for the same ROM loads what the first one wrote.
+    auto written = std::filesystem::last_write_time(a.path(BootCache::Point::Prompt));
+    BootCache again(romA, CACHE_DIR);
+    ASSERT_TRUE(again.prepare());
+    EXPECT_EQ(std::filesystem::last_write_time(a.path(BootCache::Point::Prompt)), written);
+
+    // A file holding another ROM under this ROM's name is rebuilt.
+    std::filesystem::copy_file(a.path(BootCache::Point::Prompt), b.path(BootCache::Point::Prompt));
+    std::filesystem::copy_file(a.path(BootCache::Point::DiskBoot), b.path(BootCache::Point::DiskBoot));
+    ASSERT_TRUE(b.prepare());
+    Machine machine(romB);
+    b.start(machine, BootCache::Point::Prompt);
+    EXPECT_EQ(machine.memory.data[0x0400], 'B');
+}
+
+TEST_F(BootCacheTest, FailsForRomsThatNeverBootSlot6) {
+    std::vector<uint8_t> rom(Machine::ROM_SIZE, 0xEA);
+    rom[0x2FFC] = 0x00; // reset vector $E000: NOPs to $FFFF, then zero page BRKs
+    rom[0x2FFD] = 0xE0;
+    BootCache cache(rom, CACHE_DIR);
+    std::string error;
+    EXPECT_FALSE(cache.prepare(&error));
+    EXPECT_FALSE(error.empty());
+    EXPECT_FALSE(cache.ready());
+}
@@ -0,0 +1,114 @@
+#include "gtest/gtest.h"
+#include "../breakpoints.hpp"
+#include "../cpu.hpp"
+#include "../memory.hpp"
+
+namespace {
+
+// $0300: LDX #$00 / loop: INX / STX $2000 / LDA $2001 / JMP loop
+void loadLoop(Memory& mem) {
+    const uint8_t program[] = {0xA2, 0x00, 0xE8, 0x8E, 0x00, 0x20, 0xAD, 0x01, 0x20, 0x4C, 0x02, 0x03};
+    for (size_t i = 0; i < sizeof(program); ++i) {
+        mem.write(0x0300 + i, program[i]);
+    }
+}
+
+} // namespace
+
+class BreakpointsTest : public ::testing::Test {
+protected:
+    Memory mem;
+    CPU cpu{mem};
+    Breakpoints breakpoints{mem};
+
+    void SetUp() override {
+        loadLoop(mem);
+        cpu.reset();
+        cpu.pc = 0x0300;
+        cpu.breakpoints = &breakpoints;
+    }
+};
+
+TEST_F(BreakpointsTest, FlagsOnlyPagesThatHoldThem) {
+    breakpoints.add(0x0305);
+    breakpoints.add(0x0306);
+    breakpoints.watch(0x20F0, 0x2110, Breakpoints::WRITE);
+    EXPECT_EQ(mem.pageFlags[0x03], Memory::PAGE_BREAK);
+    EXPECT_EQ(mem.pageFlags[0x20], Memory::PAGE_WATCH_WRITE);
+    EXPECT_EQ(mem.pageFlags[0x21], Memory::PAGE_WATCH_WRITE);
+    EXPECT_EQ(mem.pageFlags[0x22], 0);
+    EXPECT_TRUE(breakpoints.has(0x0306));
+    EXPECT_FALSE(breakpoints.has(0x0307));
+    EXPECT_TRUE(breakpoints.watched(0x2110, Breakpoints::WRITE));
+    EXPECT_FALSE(breakpoints.watched(0x2110, Breakpoints::READ));
+
+    breakpoints.remove(0x0305);
+    EXPECT_EQ(mem.pageFlags[0x03], Memory::PAGE_BREAK);
+    breakpoints.remove(0x0306);
+    EXPECT_EQ(mem.pageFlags[0x03], 0);
+    breakpoints.unwatch(0x2100, 0x2110, Breakpoints::WRITE);
+    EXPECT_EQ(mem.pageFlags[0x21], 0);
+    EXPECT_EQ(mem.pageFlags[0x20], Memory::PAGE_WATCH_WRITE);
+    breakpoints.clear();
+    EXPECT_EQ(mem.pageFlags[0x20], 0);
+}
+
+TEST_F(BreakpointsTest, BreakpointStopsBeforeItsInstruction) {
+    breakpoints.add(0x0303); // STX $2000
+    cpu.execute(1000);
+    EXPECT_EQ(cpu.pc, 0x0303);
+    EXPECT_EQ(cpu.x, 1);
+    ASSERT_TRUE(breakpoints.stopped());
+    EXPECT_EQ(breakpoints.hit().kind, Breakpoints::Hit::BREAK);
+    EXPECT_EQ(breakpoints.hit().address, 0x0303);
+
+    // Stays stopped until resumed, then runs one lap to the same place.
+    cpu.execute(1000);
+    EXPECT_EQ(cpu.x, 1);
+    breakpoints.resume(cpu);
+    cpu.execute(1000);
+    EXPECT_EQ(cpu.pc, 0x0303);
+    EXPECT_EQ(cpu.x, 2);
+    EXPECT_EQ(mem.read(0x2000), 1);
+}
+
+TEST_F(BreakpointsTest, WatchpointStopsAfterTheAccess) {
+    breakpoints.watch(0x2000, 0x2000, Breakpoints::WRITE);
+    breakpoints.watch(0x2001, 0x2001, Breakpoints::READ);
+    cpu.execute(1000);
+    EXPECT_EQ(cpu.pc, 0x0306); // after STX $2000
+    ASSERT_EQ(breakpoints.hit().kind, Breakpoints::Hit::WRITE);
+    EXPECT_EQ(breakpoints.hit().address, 0x2000);
+    EXPECT_EQ(breakpoints.hit().value, 1);
+    EXPECT_EQ(mem.data[0x2000], 1);
+
+    breakpoints.resume(cpu);
+    cpu.execute(1000);
+    EXPECT_EQ(cpu.pc, 0x0309); // after LDA $2001
+    EXPECT_EQ(breakpoints.hit().kind, Breakpoints::Hit::READ);
+    EXPECT_EQ(breakpoints.hit().address, 0x2001);
+}
+
+TEST_F(BreakpointsTest, OtherAddressesOnAWatchedPageRunOn) {
+    breakpoints.watch(0x2080, 0x2080, Breakpoints::READ | Breakpoints::WRITE);
+    breakpoints.add(0x03F0);
+    cpu.execute(1000);
+    EXPECT_FALSE(breakpoints.stopped());
+    EXPECT_GE(cpu.cycles, 1000u);
+    EXPECT_EQ(mem.read(0x2000), cpu.x);
+}
+
+TEST_F(BreakpointsTest, ConditionAndIgnoreCountHoldBackStops) {
+    breakpoints.add(0x0303);
+    Breakpoints::Rule& rule = breakpoints.rule(0x0303);
+    ASSERT_TRUE(rule.condition.compile("X >= 5 && mem[$2000] == X - 1"));
+    rule.ignore = 2;
+    cpu.execute(1000);
+    EXPECT_EQ(cpu.pc, 0x0303);
+    EXPECT_EQ(cpu.x, 7); // X = 5 and 6 were ignored
+    EXPECT_EQ(breakpoints.findRule(0x0303)->hits, 3u);
+    EXPECT_EQ(breakpoints.findRule(0x0303)->ignore, 0u);
+
+    breakpoints.remove(0x0303);
+    EXPECT_EQ(breakpoints.findRule(0x0303), nullptr);
+}
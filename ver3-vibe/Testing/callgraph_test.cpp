@@ -0,0 +1,65 @@
+#include "gtest/gtest.h"
+#include "../callgraph.hpp"
+#include <sstream>
+
+class CallGraphTest : public ::testing::Test {
+protected:
+    CallGraph graph;
+
+    std::string folded() {
+        std::ostringstream out;
+        graph.writeFolded(out);
+        return out.str();
+    }
+};
+
+TEST_F(CallGraphTest, NestedCalls) {
+    graph.onCall(0x1000, 0xFF, 10);   // [top] runs 10 cycles, calls $1000
+    graph.onCall(0x2000, 0xFD, 30);   // $1000 runs 20, calls $2000
+    graph.onReturn(0xFD, 80);         // $2000 runs 50
+    graph.onReturn(0xFF, 85);         // $1000 runs 5 more
+    graph.finish(100);                // [top] runs 15 more
+
+    EXPECT_EQ(folded(),
+              "[top] 25\n"
+              "[top];$1000 25\n"
+              "[top];$1000;$2000 50\n");
+}
+
+TEST_F(CallGraphTest, RtsAsJumpKeepsFrame) {
+    graph.onCall(0x1000, 0xFF, 0);
+    // $1000 pushes a target address and RTSes into it: SP ends up below the frame
+    graph.onReturn(0xFD, 10);
+    graph.onCall(0x3000, 0xFD, 20);
+    graph.onReturn(0xFD, 30);
+    graph.onReturn(0xFF, 40);
+    graph.finish(40);
+
+    EXPECT_EQ(folded(),
+              "[top];$1000 30\n"
+              "[top];$1000;$3000 10\n");
+}
+
+TEST_F(CallGraphTest, PoppedReturnAddressUnwindsBothFrames) {
+    graph.onCall(0x1000, 0xFF, 0);
+    graph.onCall(0x2000, 0xFD, 10);
+    // $2000 drops its return address with PLA/PLA, then RTS returns to [top]
+    graph.onReturn(0xFF, 20);
+    graph.onCall(0x1000, 0xFF, 30);
+    graph.finish(40);
+
+    EXPECT_EQ(folded(),
+              "[top] 10\n"
+              "[top];$1000 20\n"
+              "[top];$1000;$2000 10\n");
+}
+
+TEST_F(CallGraphTest, InterruptFramesAreTagged) {
+    graph.onInterrupt(0xFA40, 0xFF, 5);
+    graph.onReturn(0xFF, 12);
+    graph.finish(12);
+
+    EXPECT_EQ(folded(),
+              "[top] 5\n"
+              "[top];[irq]$FA40 7\n");
+}
@@ -0,0 +1,90 @@
+#include "gtest/gtest.h"
+#include "../condition.hpp"
+#include "../cpu.hpp"
+#include "../memory.hpp"
+
+class ConditionTest : public ::testing::Test {
+protected:
+    Memory mem;
+    CPU cpu{mem};
+
+    void SetUp() override {
+        cpu.reset();
+        cpu.pc = 0xFD1B;
+        cpu.a = 0x8D;
+        cpu.x = 3;
+        cpu.y = 0;
+        mem.data[0x24] = 31;
+    }
+
+    bool holds(const std::string& text) {
+        Condition condition;
+        std::string error;
+        EXPECT_TRUE(condition.compile(text, &error)) << text << ": " << error;
+        return condition.evaluate(cpu, mem.data.data());
+    }
+};
+
+TEST_F(ConditionTest, EvaluatesRegistersAndMemory) {
+    EXPECT_TRUE(holds("PC=$FD1B && A==$8D && mem[$24]>30"));
+    EXPECT_FALSE(holds("PC=$FD1B && A==$8D && mem[$24]>31"));
+    EXPECT_TRUE(holds("a == 0x8d"));
+    EXPECT_TRUE(holds("mem[$20 + X + 1] == 31")); // computed address
+    EXPECT_TRUE(holds("Y == 1 || X == 3"));
+    EXPECT_FALSE(holds("!(X == 3)"));
+    EXPECT_TRUE(holds("(A & $80) != 0 && SP <= $FF"));
+    EXPECT_TRUE(holds("X - 4 < 0"));
+    EXPECT_TRUE(holds("1 + 2 == 3 && (0 || 2)"));
+    EXPECT_TRUE(Condition().evaluate(cpu, mem.data.data())); // empty: always
+}
+
+TEST_F(ConditionTest, FindsTheBreakpointAddress) {
+    Condition condition;
+    ASSERT_TRUE(condition.compile("A==$8D && PC=$FD1B"));
+    EXPECT_EQ(condition.pc(), 0xFD1B);
+    EXPECT_EQ(condition.text(), "A==$8D && PC=$FD1B");
+    ASSERT_TRUE(condition.compile("PC==$FD1B || A==$8D"));
+    EXPECT_EQ(condition.pc(), -1);
+    ASSERT_TRUE(condition.compile("(PC==$FD1B) + 1"));
+    EXPECT_EQ(condition.pc(), -1);
+}
+
+TEST_F(ConditionTest, ReportsSyntaxErrors) {
+    Condition condition;
+    ASSERT_TRUE(condition.compile("X == 3"));
+    std::string error;
+    EXPECT_FALSE(condition.compile("Q == 1", &error));
+    EXPECT_EQ(error, "Unknown name: q");
+    EXPECT_FALSE(condition.compile("(A == 1", &error));
+    EXPECT_EQ(error, "Expected )");
+    EXPECT_FALSE(condition.compile("mem[1", &error));
+    EXPECT_EQ(error, "Expected ]");
+    EXPECT_FALSE(condition.compile("A ==", &error));
+    EXPECT_EQ(error, "Unexpected end of condition");
+    EXPECT_FALSE(condition.compile("A == 1 B", &error));
+    EXPECT_EQ(error, "Unexpected B");
+    EXPECT_FALSE(condition.compile("$", &error));
+    EXPECT_EQ(error, "Expected a number");
+    EXPECT_EQ(condition.text(), "X == 3"); // unchanged by a failed compile
+}
+
+
+// Parentheses keep a condition off the range list, so the two compile paths
+// can be compared.
+TEST_F(ConditionTest, RangeListMatchesBytecode) {
+    const char* const tests[][2] = {
+        {"A < $80 && A != 5", "(A < $80) && (A != 5)"},
+        {"A >= 16 && A <= 32 && mem[$24] > 30", "(A >= 16) && (A <= 32) && (mem[$24] > 30)"},
+        {"A > 200 && Y = 0", "(A > 200) && (Y = 0)"},
+    };
+    for (const auto& test : tests) {
+        Condition ranges;
+        Condition bytecode;
+        ASSERT_TRUE(ranges.compile(test[0]));
+        ASSERT_TRUE(bytecode.compile(test[1]));
+        for (int a = 0; a < 256; ++a) {
+            cpu.a = static_cast<uint8_t>(a);
+            EXPECT_EQ(ranges.evaluate(cpu, mem.data.data()), bytecode.evaluate(cpu, mem.data.data())) << test[0] << " A=" << a;
+        }
+    }
+}
@@ -23,7 +23,7 @@ TEST_F(CPUTest, InitialState) {
     EXPECT_EQ(cpu->x, 0);
     EXPECT_EQ(cpu->y, 0);
     EXPECT_EQ(cpu->ps, 0x20);
-    EXPECT_EQ(cpu->sp, 0x01FF);
+    EXPECT_EQ(cpu->sp, 0xFF);
 }
 
 TEST_F(CPUTest, GH264_JMP_IND) {
@@ -113,6 +113,115 @@ TEST_F(CPUTest, GH271_ASL_DEC_INC_ABSX) {
     EXPECT_EQ(mem->read(base + cpu->x), (d + 1) & 0xff);
 }
 
+TEST_F(CPUTest, CycleCounting) {
+    // LDA abs,X: 4 cycles, +1 when the index crosses a page
+    cpu->reset();
+    cpu->pc = 0x300;
+    cpu->x = 0x01;
+    mem->write(0x300, 0xbd);
+    mem->write(0x301, 0xfe);
+    mem->write(0x302, 0x20);
+    uint64_t start = cpu->cycles;
+    cpu->execute(1);
+    EXPECT_EQ(cpu->cycles - start, 4u);
+
+    cpu->pc = 0x300;
+    cpu->x = 0x02;
+    start = cpu->cycles;
+    cpu->execute(1);
+    EXPECT_EQ(cpu->cycles - start, 5u);
+
+    // STA abs,X always takes 5 cycles
+    cpu->pc = 0x300;
+    mem->write(0x300, 0x9d);
+    start = cpu->cycles;
+    cpu->execute(1);
+    EXPECT_EQ(cpu->cycles - start, 5u);
+
+    // BNE: 2 not taken, 3 taken, 4 taken across a page
+    cpu->ps = 0x20 | CPU::AF_ZERO;
+    cpu->pc = 0x300;
+    mem->write(0x300, 0xd0);
+    mem->write(0x301, 0x10);
+    start = cpu->cycles;
+    cpu->execute(1);
+    EXPECT_EQ(cpu->cycles - start, 2u);
+
+    cpu->ps = 0x20;
+    cpu->pc = 0x300;
+    start = cpu->cycles;
+    cpu->execute(1);
+    EXPECT_EQ(cpu->pc, 0x312);
+    EXPECT_EQ(cpu->cycles - start, 3u);
+
+    cpu->pc = 0x300;
+    mem->write(0x301, 0x80);
+    start = cpu->cycles;
+    cpu->execute(1);
+    EXPECT_EQ(cpu->pc, 0x282);
+    EXPECT_EQ(cpu->cycles - start, 4u);
+}
+
+TEST_F(CPUTest, ExecuteBudgetIsCycles) {
+    // Three 2-cycle NOPs fit exactly in a 6-cycle budget
+    cpu->reset();
+    cpu->pc = 0x300;
+    for (int i = 0; i < 8; ++i) {
+        mem->write(0x300 + i, 0xea);
+    }
+    cpu->execute(6);
+    EXPECT_EQ(cpu->pc, 0x303);
+}
+
+TEST_F(CPUTest, StackWrapsWithinPageOne) {
+    cpu->reset();
+    cpu->pc = 0x300;
+    cpu->sp = 0x00;
+    cpu->a = 0x42;
+    mem->write(0x300, 0x48); // PHA
+    mem->write(0x301, 0x68); // PLA
+    cpu->execute(1);
+    EXPECT_EQ(mem->read(0x0100), 0x42);
+    EXPECT_EQ(cpu->sp, 0xFF);
+    cpu->a = 0;
+    cpu->execute(1);
+    EXPECT_EQ(cpu->a, 0x42);
+    EXPECT_EQ(cpu->sp, 0x00);
+}
+
+TEST_F(CPUTest, ZeroPagePointerWraps) {
+    // LDA ($FF),Y takes the pointer high byte from $00, not $100
+    cpu->reset();
+    cpu->pc = 0x300;
+    cpu->y = 1;
+    mem->write(0x300, 0xb1);
+    mem->write(0x301, 0xff);
+    mem->write(0x00ff, 0x00);
+    mem->write(0x0000, 0x20);
+    mem->write(0x0100, 0x30);
+    mem->write(0x2001, 0x55);
+    cpu->execute(1);
+    EXPECT_EQ(cpu->a, 0x55);
+}
+
+TEST_F(CPUTest, MemorySnapshotRestore) {
+    mem->write(0x1234, 0x11);
+    mem->takeSnapshot();
+    mem->write(0x1234, 0x22);
+    mem->write(0xBFFF, 0x33);
+    mem->keyPress('A');
+    mem->restoreSnapshot();
+    EXPECT_EQ(mem->read(0x1234), 0x11);
+    EXPECT_EQ(mem->read(0xBFFF), 0x00);
+    EXPECT_EQ(mem->data[0xC000], 0x00);
+    EXPECT_EQ(mem->data[0xC010], 0x00);
+
+    // The snapshot is reusable
+    mem->write(0x1234, 0x44);
+    mem->restoreSnapshot();
+    EXPECT_EQ(mem->read(0x1234), 0x11);
+}
+
 int main(int argc, char **argv) {
     ::testing::InitGoogleTest(&argc, argv);
     return RUN_ALL_TESTS();
@@ -0,0 +1,157 @@
+#include "gtest/gtest.h"
+#include "../debugger.hpp"
+#include "../machine.hpp"
+#include <initializer_list>
+#include <sstream>
+
+namespace {
+
+// NOPs, with RESET at $0300.
+std::vector<uint8_t> testRom() {
+    std::vector<uint8_t> rom(Machine::ROM_SIZE, 0xEA);
+    rom[0xFFFC - Machine::ROM_START] = 0x00;
+    rom[0xFFFD - Machine::ROM_START] = 0x03;
+    return rom;
+}
+
+// $0300: JSR $0310 / JMP *
+// $0310: DEC $10 / BEQ $0317 / JSR $0310 / RTS -- recurses $10 times
+void loadProgram(Machine& machine, uint8_t depth) {
+    auto put = [&](uint16_t address, std::initializer_list<uint8_t> bytes) {
+        for (uint8_t byte : bytes) {
+            machine.memory.poke(address++, byte);
+        }
+    };
+    put(0x0300, {0x20, 0x10, 0x03, 0x4C, 0x03, 0x03});
+    put(0x0310, {0xC6, 0x10, 0xF0, 0x03, 0x20, 0x10, 0x03, 0x60});
+    machine.memory.poke(0x0010, depth);
+}
+
+class DebuggerTest : public ::testing::Test {
+protected:
+    Machine machine{testRom()};
+    Debugger debugger{machine};
+    std::ostringstream out;
+
+    void SetUp() override { loadProgram(machine, 3); }
+
+    // What a frontend does after Action::Run.
+    bool runToStop() {
+        for (int i = 0; i < 100; ++i) {
+            if (machine.run(100000) == Machine::Exit::Break && debugger.stopped(out)) {
+                return true;
+            }
+        }
+        return false;
+    }
+};
+
+} // namespace
+
+TEST_F(DebuggerTest, StepsAndEditsRegistersAndMemory) {
+    EXPECT_EQ(debugger.command("s", out), Debugger::Action::Prompt);
+    EXPECT_EQ(machine.cpu.pc, 0x0310);
+    EXPECT_EQ(debugger.command("s 2", out), Debugger::Action::Prompt);
+    EXPECT_EQ(machine.cpu.pc, 0x0314);
+
+    debugger.command("r a $8d", out);
+    debugger.command("r PC 0300", out);
+    EXPECT_EQ(machine.cpu.a, 0x8D);
+    EXPECT_EQ(machine.cpu.pc, 0x0300);
+    debugger.command("e 2000 12 34", out);
+    EXPECT_EQ(machine.memory.data[0x2000], 0x12);
+    EXPECT_EQ(machine.memory.data[0x2001], 0x34);
+
+    out.str("");
+    debugger.command("m 2000 2", out);
+    EXPECT_EQ(out.str(), "$2000  12 34  .4\n");
+    out.str("");
+    debugger.command("r x", out);
+    EXPECT_EQ(out.str(), "Usage: r REG VALUE\n");
+}
+
+TEST_F(DebuggerTest, StepOverRunsTheWholeCall) {
+    EXPECT_EQ(debugger.command("n", out), Debugger::Action::Run);
+    ASSERT_TRUE(runToStop());
+    EXPECT_EQ(machine.cpu.pc, 0x0303);
+    EXPECT_EQ(machine.cpu.sp, 0xFF);
+    EXPECT_EQ(machine.memory.data[0x0010], 0);
+    EXPECT_FALSE(machine.breakpoints.has(0x0303)); // the temporary breakpoint is gone
+}
+
+TEST_F(DebuggerTest, FinishSkipsDeeperReturns) {
+    debugger.command("b 0310", out);
+    ASSERT_EQ(debugger.command("c", out), Debugger::Action::Run);
+    ASSERT_TRUE(runToStop()); // first call
+    ASSERT_EQ(debugger.command("c", out), Debugger::Action::Run);
+    ASSERT_TRUE(runToStop()); // second call
+    EXPECT_EQ(machine.cpu.pc, 0x0310);
+    uint8_t sp = machine.cpu.sp;
+    debugger.command("bc 0310", out);
+
+    // The third call returns to $0317 first, one level deeper.
+    ASSERT_EQ(debugger.command("f", out), Debugger::Action::Run);
+    ASSERT_TRUE(runToStop());
+    EXPECT_EQ(machine.cpu.pc, 0x0317);
+    EXPECT_EQ(machine.cpu.sp, uint8_t(sp + 2));
+}
+
+TEST_F(DebuggerTest, RunUntilKeepsUserBreakpoints) {
+    debugger.command("b 0317", out);
+    ASSERT_EQ(debugger.command("u 0317", out), Debugger::Action::Run);
+    ASSERT_TRUE(runToStop());
+    EXPECT_EQ(machine.cpu.pc, 0x0317);
+    EXPECT_TRUE(machine.breakpoints.has(0x0317));
+
+    out.str("");
+    debugger.command("b", out);
+    EXPECT_EQ(out.str(), "break $0317\n");
+}
+
+TEST_F(DebuggerTest, WatchpointReportsTheAccess) {
+    debugger.command("w 10", out);
+    ASSERT_EQ(debugger.command("c", out), Debugger::Action::Run);
+    out.str("");
+    ASSERT_TRUE(runToStop());
+    EXPECT_EQ(machine.cpu.pc, 0x0312); // after DEC $10
+    EXPECT_EQ(out.str().substr(0, 16), "Write $0010 = $0");
+}
+
+TEST_F(DebuggerTest, DisassemblyCacheFollowsWrites) {
+    uint8_t length = 0;
+    EXPECT_EQ(debugger.disassemble(0x0310, &length), "$0310  C6 10     DEC $10");
+    EXPECT_EQ(length, 2);
+    EXPECT_EQ(debugger.disassemble(0x0312), "$0312  F0 03     BEQ $0317");
+    EXPECT_EQ(debugger.cacheMisses, 2u);
+
+    // Running the program writes zero page and the stack, not page 3.
+    machine.run(1000);
+    EXPECT_EQ(debugger.disassemble(0x0310), "$0310  C6 10     DEC $10");
+    EXPECT_EQ(debugger.cacheHits, 1u);
+
+    machine.memory.write(0x0311, 0x20);
+    EXPECT_EQ(debugger.disassemble(0x0310), "$0310  C6 20     DEC $20");
+    EXPECT_EQ(debugger.cacheMisses, 3u);
+    debugger.command("e 0312 EA", out);
+    EXPECT_EQ(debugger.disassemble(0x0312, &length), "$0312  EA        NOP");
+    EXPECT_EQ(length, 1);
+}
+
+TEST_F(DebuggerTest, ConditionalBreakpointTakesItsAddressFromTheCondition) {
+    debugger.command("b if PC==$0310 && mem[$10] == 1", out);
+    out.str("");
+    debugger.command("b", out);
+    EXPECT_EQ(out.str(), "break $0310 if PC==$0310 && mem[$10] == 1\n");
+    ASSERT_EQ(debugger.command("c", out), Debugger::Action::Run);
+    ASSERT_TRUE(runToStop());
+    EXPECT_EQ(machine.cpu.pc, 0x0310);
+    EXPECT_EQ(machine.memory.data[0x0010], 1); // the third call
+
+    out.str("");
+    debugger.command("b 0310 if A ==", out);
+    EXPECT_EQ(out.str(), "Bad condition: Unexpected end of condition\n");
+    debugger.command("bi 0310 2", out);
+    out.str("");
+    debugger.command("b", out);
+    EXPECT_EQ(out.str(), "break $0310 if PC==$0310 && mem[$10] == 1, hits 1, ignore 2\n");
+}
@@ -0,0 +1,189 @@
+#include "gtest/gtest.h"
+#include "../cpu.hpp"
+#include "../disk2.hpp"
+#include "../gcr.hpp"
+#include "../memory.hpp"
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <random>
+
+namespace {
+
+std::vector<uint8_t> randomImage(uint32_t seed) {
+    std::mt19937 rng(seed);
+    std::vector<uint8_t> image(gcr::IMAGE_SIZE);
+    for (uint8_t& b : image) {
+        b = static_cast<uint8_t>(rng());
+    }
+    return image;
+}
+
+std::string writeImage(const std::vector<uint8_t>& image, const char* name) {
+    std::string path = ::testing::TempDir() + name;
+    std::ofstream file(path, std::ios::binary | std::ios::trunc);
+    file.write(reinterpret_cast<const char*>(image.data()), image.size());
+    return path;
+}
+
+std::vector<uint8_t> readImage(const std::string& path) {
+    std::ifstream file(path, std::ios::binary);
+    return std::vector<uint8_t>((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+}
+
+} // namespace
+
+TEST(GCRTest, SectorRoundTrip) {
+    std::vector<uint8_t> image = randomImage(1);
+    uint8_t nibbles[343];
+    uint8_t decoded[256];
+    gcr::encodeSector(image.data(), nibbles);
+    for (uint8_t n : nibbles) {
+        EXPECT_TRUE(n & 0x80);
+    }
+    ASSERT_TRUE(gcr::decodeSector(nibbles, decoded));
+    EXPECT_EQ(0, memcmp(decoded, image.data(), 256));
+
+    nibbles[100] = nibbles[100] == 0x96 ? 0x97 : 0x96;
+    EXPECT_FALSE(gcr::decodeSector(nibbles, decoded));
+}
+
+TEST(GCRTest, TrackRoundTrip) {
+    std::vector<uint8_t> image = randomImage(2);
+    for (const uint8_t* order : {gcr::DOS_ORDER, gcr::PRODOS_ORDER}) {
+        std::vector<uint8_t> nibbles = gcr::nibblizeTrack(&image[5 * gcr::TRACK_SIZE], 5, order);
+        // Rotate so a sector straddles the end of the track
+        std::rotate(nibbles.begin(), nibbles.begin() + 1000, nibbles.end());
+        std::vector<uint8_t> decoded(gcr::TRACK_SIZE);
+        EXPECT_EQ(gcr::denibblizeTrack(nibbles, 5, order, decoded.data()), 0xFFFF);
+        EXPECT_EQ(decoded, std::vector<uint8_t>(&image[5 * gcr::TRACK_SIZE], &image[6 * gcr::TRACK_SIZE]));
+        // Wrong track number: nothing matches
+        EXPECT_EQ(gcr::denibblizeTrack(nibbles, 6, order, decoded.data()), 0);
+    }
+}
+
+// Runs the P5 boot PROM against a disk whose boot sector asks for two
+// sectors, and checks that both land at $0800 and control passes to $0801.
+TEST(Disk2Test, BootROMLoadsBootSectors) {
+    std::vector<uint8_t> image = randomImage(3);
+    image[0] = 2; // sectors to load
+    std::string path = writeImage(image, "boot.dsk");
+
+    Memory mem;
+    CPU cpu(mem);
+    Disk2 disk(cpu.cycles);
+    mem.insertCard(6, &disk);
+    ASSERT_TRUE(disk.insert(0, path, true));
+    mem.write(0xFF58, 0x60); // IORTS
+    mem.write(0xFCA8, 0xA9); // WAIT, which returns with A = 0
+    mem.write(0xFCA9, 0x00);
+    mem.write(0xFCAA, 0x60);
+
+    cpu.pc = 0xC600;
+    while (cpu.pc != 0x0801 && cpu.cycles < 5000000) {
+        cpu.execute(1);
+    }
+    ASSERT_EQ(cpu.pc, 0x0801);
+    EXPECT_TRUE(disk.spinning());
+    // Physical sectors 0 and 1 hold DOS-order sectors 0 and 7
+    EXPECT_EQ(0, memcmp(&mem.data[0x0800], &image[0], 256));
+    EXPECT_EQ(0, memcmp(&mem.data[0x0900], &image[7 * 256], 256));
+    std::remove(path.c_str());
+}
+
+TEST(Disk2Test, SteppingMovesHead) {
+    uint64_t clock = 0;
+    Disk2 disk(clock);
+    disk.io(0x9, false, 0); // motor on
+    // Energize phases 1, 2, 3, 0 in turn: four half tracks outward
+    for (int phase : {1, 2, 3, 0}) {
+        disk.io(phase * 2 + 1, false, 0);
+        disk.io(((phase + 3) & 3) * 2, false, 0);
+    }
+    EXPECT_EQ(disk.halfTrack(0), 4);
+    for (int phase : {3, 2}) {
+        disk.io(phase * 2 + 1, false, 0);
+        disk.io(((phase + 1) & 3) * 2, false, 0);
+    }
+    EXPECT_EQ(disk.halfTrack(0), 2);
+}
+
+TEST(Disk2Test, WritesAreFlushedToImage) {
+    std::vector<uint8_t> image = randomImage(4);
+    std::string path = writeImage(image, "write.dsk");
+
+    uint64_t clock = 0;
+    {
+        Disk2 disk(clock);
+        ASSERT_TRUE(disk.insert(0, path));
+        disk.io(0x9, false, 0);
+
+        // Find the data field of the first sector read from the track
+        auto next = [&] {
+            for (;;) {
+                clock += 4;
+                uint8_t v = disk.io(0xC, false, 0);
+                if (v & 0x80) {
+                    return v;
+                }
+            }
+        };
+        uint8_t sector = 0xFF;
+        while (sector == 0xFF) {
+            while (next() != 0xD5) {}
+            if (next() != 0xAA || next() != 0x96) {
+                continue;
+            }
+            for (int i = 0; i < 4; ++i) {
+                next();
+            }
+            uint8_t odd = next();
+            uint8_t even = next();
+            sector = ((odd << 1) | 1) & even;
+        }
+        while (next() != 0xD5) {}
+        ASSERT_EQ(next(), 0xAA);
+        ASSERT_EQ(next(), 0xAD);
+
+        // Overwrite it with zeros, one nibble every 32 cycles
+        uint8_t zeros[256] = {};
+        uint8_t nibbles[343];
+        gcr::encodeSector(zeros, nibbles);
+        disk.io(0xD, false, 0);
+        for (uint8_t n : nibbles) {
+            clock += Disk2::CYCLES_PER_NIBBLE;
+            disk.io(0xF, true, n);
+            disk.io(0xC, false, 0);
+        }
+        disk.io(0xE, false, 0);
+        disk.io(0x8, false, 0);
+        memset(&image[gcr::DOS_ORDER[sector] * 256], 0, 256);
+    }
+    EXPECT_EQ(readImage(path), image);
+    std::remove(path.c_str());
+}
+
+// Sector writes land in the shared mapping at once; the dirty bitmap tracks
+// them until flush() has synced them.
+TEST(Disk2Test, SectorWritesMarkDirtyUntilSynced) {
+    std::vector<uint8_t> image = randomImage(5);
+    std::string path = writeImage(image, "mapped.dsk");
+
+    uint64_t clock = 0;
+    Disk2 disk(clock);
+    ASSERT_TRUE(disk.insert(0, path));
+    uint8_t data[256];
+    memset(data, 0x5A, sizeof(data));
+    ASSERT_TRUE(disk.writeSector(0, 17, 3, data));
+    EXPECT_EQ(disk.dirtySectors(0, 17), 1 << 3);
+    memset(&image[17 * gcr::TRACK_SIZE + 3 * 256], 0x5A, 256);
+    EXPECT_EQ(readImage(path), image);
+
+    ASSERT_TRUE(disk.flush(0));
+    EXPECT_EQ(disk.dirtySectors(0, 17), 0);
+    uint8_t readBack[256];
+    ASSERT_TRUE(disk.readSector(0, 17, 3, readBack));
+    EXPECT_EQ(0, memcmp(readBack, data, 256));
+    std::remove(path.c_str());
+}
@@ -0,0 +1,94 @@
+#include "gtest/gtest.h"
+#include "../spsc_queue.hpp"
+#include "../triple_buffer.hpp"
+#include <thread>
+
+namespace {
+
+// Every word holds the frame number, so a torn read shows up as a mismatch.
+struct TestFrame {
+    uint64_t words[64];
+};
+
+} // namespace
+
+TEST(TripleBufferTest, ConsumerSeesOnlyWholeNewerFrames) {
+    constexpr uint64_t FRAMES = 20000;
+    TripleBuffer<TestFrame> buffer;
+    std::thread producer([&] {
+        for (uint64_t n = 1; n <= FRAMES; ++n) {
+            for (uint64_t& word : buffer.back().words) {
+                word = n;
+            }
+            buffer.publish();
+        }
+    });
+
+    uint64_t last = 0;
+    uint64_t seen = 0;
+    bool torn = false;
+    bool backwards = false;
+    while (last < FRAMES) {
+        if (!buffer.update()) {
+            std::this_thread::yield();
+            continue;
+        }
+        const TestFrame& frame = buffer.front();
+        for (uint64_t word : frame.words) {
+            torn |= word != frame.words[0];
+        }
+        backwards |= frame.words[0] <= last;
+        last = frame.words[0];
+        seen++;
+    }
+    producer.join();
+
+    EXPECT_FALSE(torn);
+    EXPECT_FALSE(backwards);
+    EXPECT_GT(seen, 0u);
+    EXPECT_FALSE(buffer.update()); // nothing new after the last frame
+}
+
+TEST(SpscQueueTest, KeepsOrderAndFailsWhenFull) {
+    SpscQueue<int, 4> queue;
+    for (int i = 0; i < 4; ++i) {
+        EXPECT_TRUE(queue.push(i));
+    }
+    EXPECT_FALSE(queue.push(4));
+
+    int value = -1;
+    EXPECT_TRUE(queue.pop(value));
+    EXPECT_EQ(value, 0);
+    EXPECT_TRUE(queue.push(4));
+    for (int i = 1; i <= 4; ++i) {
+        ASSERT_TRUE(queue.pop(value));
+        EXPECT_EQ(value, i);
+    }
+    EXPECT_FALSE(queue.pop(value));
+}
+
+TEST(SpscQueueTest, TransfersAcrossThreadsInOrder) {
+    constexpr int COUNT = 100000;
+    SpscQueue<int, 256> queue;
+    std::thread producer([&] {
+        for (int i = 0; i < COUNT; ++i) {
+            while (!queue.push(i)) {
+                std::this_thread::yield();
+            }
+        }
+    });
+
+    int expected = 0;
+    bool ordered = true;
+    while (expected < COUNT) {
+        int value;
+        if (queue.pop(value)) {
+            ordered &= value == expected;
+            expected++;
+        } else {
+            std::this_thread::yield();
+        }
+    }
+    producer.join();
+    EXPECT_TRUE(ordered);
+}
@@ -0,0 +1,185 @@
+#include "gtest/gtest.h"
+#include "../history.hpp"
+#include "../debugger.hpp"
+#include <initializer_list>
+#include <sstream>
+
+namespace {
+
+// NOPs, with RESET at $0300.
+std::vector<uint8_t> testRom() {
+    std::vector<uint8_t> rom(Machine::ROM_SIZE, 0xEA);
+    rom[0xFFFC - Machine::ROM_START] = 0x00;
+    rom[0xFFFD - Machine::ROM_START] = 0x03;
+    return rom;
+}
+
+// $0300: LDX #$00
+// $0302: LDA $C000 / BPL $0302 / BIT $C010 / STA $2000,X / INX / JMP $0302
+// Stores each key typed at $2000 onwards.
+void loadProgram(Machine& machine) {
+    const std::initializer_list<uint8_t> program = {0xA2, 0x00, 0xAD, 0x00, 0xC0, 0x10, 0xFB, 0x2C, 0x10,
+                                                    0xC0, 0x9D, 0x00, 0x20, 0xE8, 0x4C, 0x02, 0x03};
+    uint16_t address = 0x0300;
+    for (uint8_t byte : program) {
+        machine.memory.poke(address++, byte);
+    }
+}
+
+// Instruction boundaries of a second machine, stepped from reset with the
+// same keys at the same cycles.
+std::vector<uint64_t> boundaries(uint64_t end, const std::vector<std::pair<uint64_t, uint8_t>>& keys) {
+    Machine machine(testRom());
+    loadProgram(machine);
+    std::vector<uint64_t> result;
+    size_t next = 0;
+    while (machine.cpu.cycles < end) {
+        if (next < keys.size() && keys[next].first == machine.cpu.cycles) {
+            machine.keyPress(keys[next++].second);
+        }
+        result.push_back(machine.cpu.cycles);
+        machine.cpu.execute(1);
+    }
+    return result;
+}
+
+} // namespace
+
+class HistoryTest : public ::testing::Test {
+protected:
+    Machine machine{testRom()};
+    std::unique_ptr<History> history;
+    std::vector<std::pair<uint64_t, uint8_t>> typed;
+
+    void SetUp() override {
+        loadProgram(machine);
+        history = std::make_unique<History>(machine);
+    }
+
+    void type(uint8_t key) {
+        typed.push_back({machine.cpu.cycles, key});
+        machine.keyPress(key);
+    }
+};
+
+TEST_F(HistoryTest, StepBackLandsOnEarlierInstructions) {
+    machine.run(2 * History::SNAPSHOT_CYCLES + 1000); // two snapshots back
+    EXPECT_EQ(history->snapshots(), 3u);
+    uint64_t now = machine.cpu.cycles;
+    std::vector<uint64_t> reference = boundaries(now, {});
+
+    ASSERT_TRUE(history->stepBack());
+    EXPECT_EQ(machine.cpu.cycles, reference[reference.size() - 1]);
+    ASSERT_TRUE(history->stepBack(1000)); // across a snapshot
+    EXPECT_EQ(machine.cpu.cycles, reference[reference.size() - 1001]);
+    EXPECT_EQ(history->snapshots(), 3u); // a new one where it stopped
+
+    EXPECT_FALSE(history->stepBack(10000000));
+    EXPECT_EQ(machine.cpu.cycles, 0u);
+    EXPECT_EQ(machine.cpu.pc, 0x0300);
+}
+
+TEST_F(HistoryTest, ReplayFeedsKeysBack) {
+    machine.run(50000);
+    type('A');
+    machine.run(History::SNAPSHOT_CYCLES);
+    type('B');
+    machine.run(50000);
+    type('C');
+    machine.run(50000);
+    ASSERT_EQ(machine.memory.data[0x2002], 'C' | 0x80);
+
+    machine.breakpoints.watch(0x2000, 0x20FF, Breakpoints::WRITE);
+    ASSERT_TRUE(history->continueBack());
+    EXPECT_EQ(machine.breakpoints.hit().address, 0x2002);
+    EXPECT_EQ(machine.breakpoints.hit().value, 'C' | 0x80);
+    machine.breakpoints.resume(machine.cpu);
+    ASSERT_TRUE(history->continueBack());
+    EXPECT_EQ(machine.breakpoints.hit().address, 0x2001);
+    EXPECT_EQ(machine.memory.data[0x2002], 0); // not typed yet
+    machine.breakpoints.resume(machine.cpu);
+    uint64_t cycle = machine.cpu.cycles;
+
+    std::vector<uint64_t> reference = boundaries(cycle, typed);
+    ASSERT_TRUE(history->stepBack(3));
+    EXPECT_EQ(machine.cpu.cycles, reference[reference.size() - 3]);
+
+    // The old future is gone: running on waits for a key again.
+    machine.breakpoints.clear();
+    machine.run(100000);
+    EXPECT_EQ(machine.memory.data[0x2001], 'B' | 0x80);
+    EXPECT_EQ(machine.memory.data[0x2002], 0);
+}
+
+TEST_F(HistoryTest, ContinueBackWithoutStopsGoesToTheStart) {
+    machine.run(100000);
+    EXPECT_FALSE(history->continueBack());
+    EXPECT_EQ(machine.cpu.cycles, history->start());
+    EXPECT_FALSE(history->stepBack());
+}
+
+// Replays start from the rule counters each snapshot kept, so hits are not
+// counted twice and an ignore count runs out where it did.
+TEST_F(HistoryTest, ContinueBackKeepsIgnoreCounts) {
+    Breakpoints& breakpoints = machine.breakpoints;
+    breakpoints.add(0x0302); // the key wait loop, every 7 cycles
+    breakpoints.rule(0x0302).ignore = 1000;
+    history->record(true); // as the debugger does after an edit
+    ASSERT_EQ(machine.run(50000), Machine::Exit::Break);
+    uint64_t stop = machine.cpu.cycles;
+    EXPECT_EQ(breakpoints.rule(0x0302).hits, 1001u);
+    EXPECT_EQ(breakpoints.rule(0x0302).ignore, 0u);
+
+    // Ignore a lot more from here, past the next snapshot.
+    breakpoints.rule(0x0302).ignore = 1000000;
+    history->record(true);
+    breakpoints.resume(machine.cpu);
+    ASSERT_EQ(machine.run(History::SNAPSHOT_CYCLES + 50000), Machine::Exit::Budget);
+    uint32_t hits = breakpoints.rule(0x0302).hits;
+    EXPECT_GT(hits, 1001 + History::SNAPSHOT_CYCLES / 7);
+
+    ASSERT_TRUE(history->continueBack());
+    EXPECT_EQ(machine.cpu.cycles, stop);
+    EXPECT_EQ(breakpoints.rule(0x0302).hits, 1001u);
+    EXPECT_EQ(breakpoints.rule(0x0302).ignore, 1000000u);
+
+    // Every arrival before the stop was ignored, and running on stops at
+    // the same one.
+    breakpoints.resume(machine.cpu);
+    EXPECT_FALSE(history->continueBack());
+    EXPECT_EQ(breakpoints.rule(0x0302).hits, 0u);
+    EXPECT_EQ(breakpoints.rule(0x0302).ignore, 1000u);
+    ASSERT_EQ(machine.run(50000), Machine::Exit::Break);
+    EXPECT_EQ(machine.cpu.cycles, stop);
+    EXPECT_EQ(breakpoints.rule(0x0302).hits, 1001u);
+}
+
+TEST_F(HistoryTest, DebuggerReverseCommands) {
+    Debugger debugger(machine, history.get());
+    std::ostringstream out;
+    machine.run(50000);
+    type('Z');
+    machine.run(50000);
+    debugger.command("w 2000", out);
+    out.str("");
+    EXPECT_EQ(debugger.command("rc", out), Debugger::Action::Prompt);
+    EXPECT_EQ(out.str().substr(0, 17), "Write $2000 = $DA");
+    EXPECT_EQ(machine.cpu.pc, 0x030D); // after STA $2000,X
+
+    out.str("");
+    debugger.command("rs", out);
+    EXPECT_EQ(machine.cpu.pc, 0x030A);
+    EXPECT_EQ(out.str().substr(0, 5), "A=DA ");
+    out.str("");
+    debugger.command("rc 5", out);
+    EXPECT_EQ(out.str(), "Usage: rc\n");
+    EXPECT_EQ(machine.cpu.pc, 0x030A);
+    out.str("");
+    debugger.command("rc", out);
+    EXPECT_EQ(out.str().substr(0, 17), "Start of history\n");
+
+    Debugger noHistory(machine);
+    out.str("");
+    noHistory.command("rs", out);
+    EXPECT_EQ(out.str(), "No history is recorded\n");
+}
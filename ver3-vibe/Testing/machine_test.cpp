@@ -0,0 +1,234 @@
+#include "gtest/gtest.h"
+#include "../farm.hpp"
+#include "../machine.hpp"
+#include <cstdio>
+#include <cstring>
+#include <memory>
+
+namespace {
+
+// 12K ROM holding the monitor's KEYIN loop at $FD1B and, at the reset
+// vector, a program that stores each key at $1000,X and hangs on 'Q'.
+std::vector<uint8_t> testRom() {
+    std::vector<uint8_t> rom(Machine::ROM_SIZE, 0xEA);
+    auto put = [&](uint16_t address, std::initializer_list<uint8_t> bytes) {
+        std::copy(bytes.begin(), bytes.end(), rom.begin() + (address - Machine::ROM_START));
+    };
+    put(0xFD1B, {0xE6, 0x4E, 0xD0, 0x02, 0xE6, 0x4F,   // KEYIN: INC RNDL / BNE / INC RNDH
+                 0x2C, 0x00, 0xC0, 0x10, 0xF5,         //        BIT KBD / BPL KEYIN
+                 0xAD, 0x00, 0xC0, 0x2C, 0x10, 0xC0,   //        LDA KBD / BIT KBDSTRB
+                 0x60});                               //        RTS
+    put(0xE000, {0xA2, 0x00,                           // LDX #0
+                 0x20, 0x1B, 0xFD,                     // JSR KEYIN
+                 0x9D, 0x00, 0x10,                     // STA $1000,X
+                 0xE8,                                 // INX
+                 0xC9, 'Q' | 0x80,                     // CMP #'Q'
+                 0xD0, 0xF5,                           // BNE $E002
+                 0x4C, 0x0D, 0xE0});                   // JMP * (hang)
+    put(0xFFFC, {0x00, 0xE0});
+    return rom;
+}
+
+} // namespace
+
+TEST(MachineTest, TypedKeysAreReadOnceEach) {
+    Machine machine(testRom());
+    machine.type("AB\n");
+    EXPECT_EQ(machine.run(10000000), Machine::Exit::Idle);
+    EXPECT_LT(machine.cpu.cycles, 10u * Machine::SLICE_CYCLES);
+    EXPECT_EQ(machine.memory.data[0x1000], 'A' | 0x80);
+    EXPECT_EQ(machine.memory.data[0x1001], 'B' | 0x80);
+    EXPECT_EQ(machine.memory.data[0x1002], 0x8D);
+    EXPECT_EQ(machine.memory.data[0x1003], 0x00);
+}
+
+TEST(MachineTest, StopsWhenHungOrOutOfBudget) {
+    Machine machine(testRom());
+    machine.type("XQ");
+    EXPECT_EQ(machine.run(10000000), Machine::Exit::Hung);
+    EXPECT_EQ(machine.cpu.pc, 0xE00D);
+
+    Machine busy(testRom());
+    busy.memory.data[0x0300] = 0xD0; // BNE * (Z is clear): spins without being a JMP
+    busy.memory.data[0x0301] = 0xFE;
+    busy.cpu.pc = 0x0300;
+    EXPECT_EQ(busy.run(100000), Machine::Exit::Budget);
+    EXPECT_GE(busy.cpu.cycles, 100000u);
+}
+
+TEST(MachineTest, BreakpointStopsRun) {
+    Machine machine(testRom());
+    machine.type("AB");
+    machine.breakpoints.add(0xE005); // STA $1000,X
+    EXPECT_EQ(machine.run(10000000), Machine::Exit::Break);
+    EXPECT_EQ(machine.cpu.pc, 0xE005);
+    EXPECT_EQ(machine.cpu.a, 'A' | 0x80);
+
+    // Run-ahead passes over breakpoints and leaves the stop in place.
+    machine.runAhead(2, [] {});
+    EXPECT_EQ(machine.cpu.pc, 0xE005);
+    EXPECT_TRUE(machine.breakpoints.stopped());
+
+    machine.breakpoints.resume(machine.cpu);
+    EXPECT_EQ(machine.run(10000000), Machine::Exit::Break);
+    EXPECT_EQ(machine.cpu.a, 'B' | 0x80);
+    EXPECT_EQ(machine.memory.data[0x1000], 'A' | 0x80);
+}
+
+// A loaded state runs on exactly as the saved machine does.
+TEST(MachineTest, LoadedStateRunsLikeTheOriginal) {
+    Machine original(testRom());
+    original.type("AB");
+    original.run(3 * Machine::SLICE_CYCLES);
+
+    auto state = std::make_unique<MachineState>();
+    original.save(*state);
+    EXPECT_TRUE(state->valid());
+
+    Machine clone(testRom());
+    clone.load(*state);
+    original.type("CQ");
+    clone.type("CQ");
+    EXPECT_EQ(original.run(10000000), Machine::Exit::Hung);
+    EXPECT_EQ(clone.run(10000000), Machine::Exit::Hung);
+    EXPECT_EQ(clone.cpu.cycles, original.cpu.cycles);
+    EXPECT_EQ(0, memcmp(clone.memory.data.data(), original.memory.data.data(), Memory::ADDRESS_SPACE_SIZE));
+}
+
+TEST(MachineTest, RewindReturnsToTheCheckpoint) {
+    Machine machine(testRom());
+    machine.run(Machine::SLICE_CYCLES);
+    machine.checkpoint();
+    auto state = std::make_unique<MachineState>();
+    machine.save(*state);
+
+    for (int pass = 0; pass < 2; ++pass) {
+        machine.type("XYQ");
+        EXPECT_EQ(machine.run(10000000), Machine::Exit::Hung);
+        EXPECT_EQ(machine.memory.data[0x1002], 'Q' | 0x80);
+        machine.rewind();
+        EXPECT_EQ(machine.cpu.pc, state->pc);
+        EXPECT_EQ(machine.cpu.cycles, state->cycles);
+        EXPECT_EQ(0, memcmp(machine.memory.data.data(), state->memory.data(), Memory::ADDRESS_SPACE_SIZE));
+    }
+
+    // After a load() the dirty pages no longer describe the difference.
+    Machine other(testRom());
+    other.type("Z");
+    other.run(3 * Machine::SLICE_CYCLES);
+    auto elsewhere = std::make_unique<MachineState>();
+    other.save(*elsewhere);
+    machine.load(*elsewhere);
+    machine.rewind();
+    EXPECT_EQ(0, memcmp(machine.memory.data.data(), state->memory.data(), Memory::ADDRESS_SPACE_SIZE));
+}
+
+// The frame shown is the one two frames on, and the machine itself
+// carries on as if run-ahead never happened.
+TEST(MachineTest, RunAheadShowsLaterFramesWithoutSideEffects) {
+    Machine machine(testRom());
+    Machine reference(testRom());
+    machine.type("AB");
+    reference.type("AB");
+    machine.run(3 * Machine::SLICE_CYCLES);
+    reference.run(3 * Machine::SLICE_CYCLES);
+
+    auto state = std::make_unique<MachineState>();
+    machine.save(*state);
+    Machine future(testRom());
+    future.load(*state);
+    future.cpu.execute(Machine::SLICE_CYCLES);
+    future.cpu.execute(Machine::SLICE_CYCLES);
+
+    bool shown = false;
+    machine.runAhead(2, [&] {
+        shown = true;
+        EXPECT_EQ(machine.cpu.cycles, future.cpu.cycles);
+        EXPECT_EQ(machine.cpu.pc, future.cpu.pc);
+    });
+    EXPECT_TRUE(shown);
+    EXPECT_EQ(machine.cpu.cycles, reference.cpu.cycles);
+
+    machine.type("CQ");
+    reference.type("CQ");
+    EXPECT_EQ(machine.run(10000000), Machine::Exit::Hung);
+    EXPECT_EQ(reference.run(10000000), Machine::Exit::Hung);
+    EXPECT_EQ(machine.cpu.cycles, reference.cpu.cycles);
+    EXPECT_EQ(0, memcmp(machine.memory.data.data(), reference.memory.data.data(), Memory::ADDRESS_SPACE_SIZE));
+}
+
+// A machine restored from a file carries on, typed-ahead keys included,
+// exactly as the one that saved it.
+TEST(MachineTest, SaveStateFileRoundTrips) {
+    for (bool compress : {false, true}) {
+        const std::string path = "machine_test.state";
+        Machine original(testRom());
+        original.type("ABCDQ");
+        original.run(2 * Machine::SLICE_CYCLES);
+        ASSERT_TRUE(original.saveState(path, compress));
+
+        Machine restored(testRom());
+        std::string error;
+        ASSERT_TRUE(restored.loadState(path, &error)) << error;
+        EXPECT_EQ(restored.cpu.pc, original.cpu.pc);
+        EXPECT_EQ(restored.cpu.cycles, original.cpu.cycles);
+
+        EXPECT_EQ(original.run(10000000), Machine::Exit::Hung);
+        EXPECT_EQ(restored.run(10000000), Machine::Exit::Hung);
+        EXPECT_EQ(restored.cpu.cycles, original.cpu.cycles);
+        EXPECT_EQ(0, memcmp(restored.memory.data.data(), original.memory.data.data(), Memory::ADDRESS_SPACE_SIZE));
+        std::remove(path.c_str());
+    }
+}
+
+TEST(MachineTest, RejectsBadSaveStates) {
+    const std::string path = "machine_test.state";
+    Machine machine(testRom());
+    machine.run(Machine::SLICE_CYCLES);
+    ASSERT_TRUE(machine.saveState(path));
+    std::vector<uint8_t> bytes;
+    ASSERT_TRUE(Machine::loadRom(path, bytes));
+
+    const uint16_t pc = machine.cpu.pc;
+    std::string error;
+    for (size_t keep : {size_t(10), bytes.size() / 2}) {
+        FILE* f = fopen(path.c_str(), "wb");
+        fwrite(bytes.data(), 1, keep, f);
+        fclose(f);
+        EXPECT_FALSE(machine.loadState(path, &error));
+        EXPECT_FALSE(error.empty());
+        EXPECT_EQ(machine.cpu.pc, pc);
+    }
+    EXPECT_FALSE(machine.loadState("missing.state", &error));
+    std::remove(path.c_str());
+}
+
+// Results come back in job order and match the same job run alone,
+// whichever worker ran it.
+TEST(FarmTest, ParallelRunsMatchSerialRuns) {
+    std::vector<FarmJob> jobs;
+    for (int i = 0; i < 64; ++i) {
+        FarmJob job;
+        job.keys = std::string(1 + i % 7, static_cast<char>('A' + i % 16));
+        job.cycles = 2000000;
+        jobs.push_back(job);
+    }
+    jobs[5].disk = "missing.dsk";
+
+    Farm farm(testRom(), 4);
+    std::vector<FarmResult> results = farm.run(jobs);
+    ASSERT_EQ(results.size(), jobs.size());
+    for (size_t i = 0; i < jobs.size(); ++i) {
+        if (i == 5) {
+            EXPECT_FALSE(results[i].booted);
+            continue;
+        }
+        Machine machine(testRom());
+        machine.type(jobs[i].keys);
+        Machine::Exit exit = machine.run(jobs[i].cycles);
+        EXPECT_TRUE(results[i].booted);
+        EXPECT_EQ(results[i].exit, exit) << "job " << i;
+        EXPECT_EQ(results[i].cycles, machine.cpu.cycles) << "job " << i;
+        EXPECT_EQ(results[i].screenHash, machine.screenHash()) << "job " << i;
+    }
+}
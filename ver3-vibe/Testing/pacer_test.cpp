@@ -0,0 +1,106 @@
+#include "gtest/gtest.h"
+#include "../pacer.hpp"
+
+namespace {
+
+constexpr uint64_t TICKS_PER_SECOND = 1000000000; // nanoseconds
+
+} // namespace
+
+// Budgets track 17,030 cycles per frame exactly, whatever the overshoot.
+TEST(FramePacerTest, CycleBudgetsDoNotDrift) {
+    FramePacer pacer(FramePacer::Sync::Timer, TICKS_PER_SECOND);
+    uint64_t cycles = 100;
+    for (int frame = 0; frame < 1000; ++frame) {
+        uint32_t budget = pacer.cyclesThisFrame(cycles);
+        cycles += budget + frame % 7; // execute() overshoots by a partial instruction
+    }
+    EXPECT_NEAR(static_cast<double>(cycles), 100 + 1000.0 * FramePacer::CYCLES_PER_FRAME, 7);
+}
+
+// Vsync at 144 Hz still emulates one second of cycles per second.
+TEST(FramePacerTest, VsyncRunsOneRefreshOfCycles) {
+    FramePacer pacer(FramePacer::Sync::Vsync, TICKS_PER_SECOND, 144);
+    uint64_t cycles = 0;
+    uint64_t now = 0;
+    for (int frame = 0; frame < 144; ++frame) {
+        cycles += pacer.cyclesThisFrame(cycles);
+        EXPECT_FALSE(pacer.shouldWait(now, 0));
+        pacer.frameDone(now);
+        now += TICKS_PER_SECOND / 144;
+    }
+    EXPECT_NEAR(static_cast<double>(cycles), FramePacer::CPU_CLOCK_HZ, 1);
+}
+
+TEST(FramePacerTest, TimerDeadlinesAndResync) {
+    FramePacer pacer(FramePacer::Sync::Timer, TICKS_PER_SECOND);
+    const uint64_t period = static_cast<uint64_t>(TICKS_PER_SECOND / FramePacer::FRAME_HZ);
+    uint64_t now = 5000;
+    pacer.frameDone(now);
+    // Deadlines are absolute: a late frame shortens the next wait.
+    EXPECT_TRUE(pacer.shouldWait(now, 0));
+    now += period + period / 4;
+    pacer.frameDone(now);
+    EXPECT_NEAR(static_cast<double>(pacer.ticksUntilDeadline(now)), period * 0.75, 2);
+
+    // A long stall resyncs instead of rushing to catch up.
+    now += 10 * period;
+    pacer.frameDone(now);
+    EXPECT_NEAR(static_cast<double>(pacer.ticksUntilDeadline(now)), period, 2);
+    ASSERT_TRUE(pacer.statsReady(now + TICKS_PER_SECOND));
+    FramePacer::Stats stats = pacer.takeStats(now);
+    EXPECT_EQ(stats.slips, 1u);
+    EXPECT_NEAR(stats.maxMs, 10 * 1000 / FramePacer::FRAME_HZ, 0.01);
+}
+
+// After the debugger steps back, the next frame runs one frame's worth
+// from where the machine now is, not the whole span it went back over.
+TEST(FramePacerTest, ResyncAfterCyclesGoBack) {
+    FramePacer pacer(FramePacer::Sync::Timer, TICKS_PER_SECOND);
+    uint64_t cycles = 0;
+    for (int frame = 0; frame < 3600; ++frame) {
+        cycles += pacer.cyclesThisFrame(cycles);
+    }
+    cycles = 1000000; // `rc` went back about a minute
+    pacer.resync(5000, cycles);
+    EXPECT_EQ(pacer.cyclesThisFrame(cycles), FramePacer::CYCLES_PER_FRAME);
+    cycles += FramePacer::CYCLES_PER_FRAME + 3;
+    EXPECT_EQ(pacer.cyclesThisFrame(cycles), FramePacer::CYCLES_PER_FRAME - 3);
+}
+
+TEST(FramePacerTest, AudioWaitsForTheDevice) {
+    FramePacer pacer(FramePacer::Sync::Audio, TICKS_PER_SECOND);
+    pacer.frameDone(0);
+    EXPECT_TRUE(pacer.shouldWait(1000, FramePacer::AUDIO_FRAMES_BUFFERED + 1));
+    EXPECT_FALSE(pacer.shouldWait(1000, FramePacer::AUDIO_FRAMES_BUFFERED - 1));
+    // The device stopped pulling: give up after two frames.
+    EXPECT_FALSE(pacer.shouldWait(TICKS_PER_SECOND / 20, 100));
+}
+
+// Frames take 1 ms unthrottled: about one in 33 is shown at 30 presents/s.
+TEST(FrameskipTest, AdaptsToFrameTime) {
+    Frameskip skip(TICKS_PER_SECOND);
+    uint64_t now = 1;
+    int shown = 0;
+    for (int frame = 0; frame < 3000; ++frame) {
+        now += TICKS_PER_SECOND / 1000;
+        shown += skip.frameDone(now, 30);
+    }
+    EXPECT_EQ(skip.skip(), 33);
+    EXPECT_NEAR(shown, 90, 5);
+
+    // Slower frames (a heavy program) need less skipping.
+    for (int frame = 0; frame < 300; ++frame) {
+        now += TICKS_PER_SECOND / 100;
+        skip.frameDone(now, 30);
+    }
+    EXPECT_EQ(skip.skip(), 3);
+}
+
+TEST(SpeedMeterTest, ReportsMultipleOfRealSpeed) {
+    SpeedMeter meter(TICKS_PER_SECOND);
+    meter.update(1000, 1);
+    meter.update(1000 + static_cast<uint64_t>(FramePacer::CPU_CLOCK_HZ * 5), 1 + TICKS_PER_SECOND);
+    EXPECT_NEAR(meter.multiple(), 5, 1e-6);
+    EXPECT_NEAR(meter.mhz(), FramePacer::CPU_CLOCK_HZ * 5 / 1e6, 1e-6);
+}
@@ -0,0 +1,74 @@
+#include "gtest/gtest.h"
+#include "../cpu.hpp"
+#include "../memory.hpp"
+#include <fstream>
+#include <sstream>
+
+// Built with CPU_PROFILER defined (see CMakeLists.txt).
+class ProfilerTest : public ::testing::Test {
+protected:
+    Memory mem;
+    CPU cpu{mem};
+    Profiler profiler;
+
+    // $0300: LDX #$03 / loop: DEX / BNE loop
+    // 7 instructions, 16 cycles: the first two BNEs are taken.
+    void SetUp() override {
+        const uint8_t program[] = {0xA2, 0x03, 0xCA, 0xD0, 0xFD, 0xEA};
+        for (size_t i = 0; i < sizeof(program); ++i) {
+            mem.write(static_cast<uint16_t>(0x0300 + i), program[i]);
+        }
+        cpu.reset();
+        cpu.pc = 0x0300;
+        cpu.profiler = &profiler;
+        cpu.execute(16);
+    }
+
+    std::string output(const std::string& name) {
+        std::string path = ::testing::TempDir() + name;
+        EXPECT_TRUE(profiler.write(path));
+        std::ifstream file(path);
+        std::stringstream text;
+        text << file.rdbuf();
+        return text.str();
+    }
+};
+
+TEST_F(ProfilerTest, CountsOpcodesAndAddresses) {
+    ASSERT_EQ(cpu.pc, 0x0305);
+    EXPECT_EQ(profiler.opcodeCount[0xA2], 1u);
+    EXPECT_EQ(profiler.opcodeCycles[0xA2], 2u);
+    EXPECT_EQ(profiler.opcodeCount[0xCA], 3u);
+    EXPECT_EQ(profiler.opcodeCycles[0xCA], 6u);
+    EXPECT_EQ(profiler.opcodeCount[0xD0], 3u);
+    EXPECT_EQ(profiler.opcodeCycles[0xD0], 8u);
+    EXPECT_EQ(profiler.pcCount[0x0303], 3u);
+    EXPECT_EQ(profiler.pcCycles[0x0303], 8u);
+}
+
+TEST_F(ProfilerTest, CSV) {
+    EXPECT_EQ(output("profile.csv"),
+              "kind,key,mnemonic,mode,count,cycles\n"
+              "opcode,162,LDX,immediate,1,2\n"
+              "opcode,202,DEX,implied,3,6\n"
+              "opcode,208,BNE,relative,3,8\n"
+              "mode,0,,implied,3,6\n"
+              "mode,2,,immediate,1,2\n"
+              "mode,12,,relative,3,8\n"
+              "pc,768,,,1,2\n"
+              "pc,770,,,3,6\n"
+              "pc,771,,,3,8\n");
+}
+
+TEST_F(ProfilerTest, Report) {
+    std::string report = output("profile.txt");
+    EXPECT_EQ(report.substr(0, report.find("\n\n")), "Instructions: 7  Cycles: 16");
+    // Sorted by cycles
+    EXPECT_NE(report.find("== Opcodes (by cycles) ==\n"
+                          "  op  mnem  mode          count        cycles      %\n"
+                          "  D0  BNE   relative                3             8  50.00\n"
+                          "  CA  DEX   implied                 3             6  37.50\n"
+                          "  A2  LDX   immediate               1             2  12.50\n"),
+              std::string::npos);
+    EXPECT_NE(report.find("  $0303           3             8  50.00\n"), std::string::npos);
+}
@@ -0,0 +1,130 @@
+#include "gtest/gtest.h"
+#include "../cpu.hpp"
+#include "../disk2.hpp"
+#include "../memory.hpp"
+#include "../rwts.hpp"
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <random>
+
+class RwtsTrapTest : public ::testing::Test {
+protected:
+    static constexpr uint16_t IOB = 0xB7E8;
+    static constexpr uint16_t BUFFER = 0x2000;
+
+    std::vector<uint8_t> image;
+    std::string path;
+    Memory mem;
+    CPU cpu{mem};
+    Disk2 disk{cpu.cycles};
+    RwtsTrap trap{mem, disk};
+
+    void SetUp() override {
+        std::mt19937 rng(7);
+        image.resize(gcr::IMAGE_SIZE);
+        for (uint8_t& b : image) {
+            b = static_cast<uint8_t>(rng());
+        }
+        path = ::testing::TempDir() + "rwts.dsk";
+        std::ofstream(path, std::ios::binary).write(reinterpret_cast<const char*>(image.data()), image.size());
+        mem.insertCard(6, &disk);
+        ASSERT_TRUE(disk.insert(0, path));
+        cpu.rwts = &trap;
+
+        // Stand-in RWTS code; the trap only accepts it once its checksum is known
+        for (uint32_t addr = 0xB800; addr <= 0xBEFF; ++addr) {
+            mem.write(addr, static_cast<uint8_t>(rng()));
+        }
+        mem.write(RwtsTrap::ENTRY, 0x00); // BRK if the trap declines
+
+        // LDA #>IOB / LDY #<IOB / JSR RWTS
+        const uint8_t program[] = {0xA9, IOB >> 8, 0xA0, IOB & 0xFF, 0x20, 0x00, 0xBD};
+        for (size_t i = 0; i < sizeof(program); ++i) {
+            mem.write(0x0300 + i, program[i]);
+        }
+    }
+
+    void TearDown() override {
+        disk.eject(0);
+        std::remove(path.c_str());
+    }
+
+    void setIOB(uint8_t command, uint8_t track, uint8_t sector, uint8_t volume = 0) {
+        const uint8_t iob[] = {1, 0x60, 1, volume, track, sector, 0xFB, 0xB7,
+                               BUFFER & 0xFF, BUFFER >> 8, 0, 0, command, 0xFF, 0, 0x60, 1};
+        for (size_t i = 0; i < sizeof(iob); ++i) {
+            mem.write(IOB + i, iob[i]);
+        }
+    }
+
+    // Runs the call and returns the IOB status, or -1 if the trap declined.
+    int call() {
+        cpu.pc = 0x0300;
+        for (int i = 0; i < 4 && cpu.pc != 0x0307; ++i) {
+            cpu.execute(1);
+        }
+        if (cpu.pc != 0x0307) {
+            return -1;
+        }
+        EXPECT_EQ(cpu.a, mem.read(IOB + 0x0D));
+        EXPECT_EQ((cpu.ps & CPU::AF_CARRY) != 0, cpu.a != RwtsTrap::OK);
+        return mem.read(IOB + 0x0D);
+    }
+
+    const uint8_t* sector(int track, int sector) const {
+        return &image[track * gcr::TRACK_SIZE + sector * gcr::SECTOR_SIZE];
+    }
+};
+
+TEST_F(RwtsTrapTest, FallsBackOnUnknownRwts) {
+    setIOB(1, 3, 5);
+    EXPECT_EQ(call(), -1);
+    EXPECT_EQ(trap.fallbacks, 1u);
+    EXPECT_EQ(trap.handled, 0u);
+}
+
+TEST_F(RwtsTrapTest, ReadsSector) {
+    trap.expectedChecksum = trap.checksum();
+    setIOB(1, 3, 5);
+    EXPECT_EQ(call(), RwtsTrap::OK);
+    EXPECT_EQ(0, memcmp(&mem.data[BUFFER], sector(3, 5), 256));
+    EXPECT_EQ(mem.read(IOB + 0x0E), gcr::DEFAULT_VOLUME);
+    EXPECT_EQ(trap.handled, 1u);
+}
+
+TEST_F(RwtsTrapTest, WritesSector) {
+    trap.expectedChecksum = trap.checksum();
+    for (int i = 0; i < 256; ++i) {
+        mem.write(BUFFER + i, static_cast<uint8_t>(i));
+    }
+    setIOB(2, 17, 15);
+    EXPECT_EQ(call(), RwtsTrap::OK);
+
+    uint8_t data[256];
+    ASSERT_TRUE(disk.readSector(0, 17, 15, data));
+    EXPECT_EQ(data[200], 200);
+    disk.flush(0);
+    std::ifstream file(path, std::ios::binary);
+    std::vector<uint8_t> saved((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+    for (int i = 0; i < 256; ++i) {
+        image[17 * gcr::TRACK_SIZE + 15 * gcr::SECTOR_SIZE + i] = static_cast<uint8_t>(i);
+    }
+    EXPECT_EQ(saved, image);
+}
+
+TEST_F(RwtsTrapTest, ReportsErrors) {
+    trap.expectedChecksum = trap.checksum();
+    setIOB(1, 3, 5, 99);
+    EXPECT_EQ(call(), RwtsTrap::VOLUME_MISMATCH);
+
+    ASSERT_TRUE(disk.insert(0, path, true));
+    setIOB(2, 3, 5);
+    EXPECT_EQ(call(), RwtsTrap::WRITE_PROTECTED);
+
+    // FORMAT and bad IOBs go to the real RWTS
+    setIOB(4, 3, 5);
+    EXPECT_EQ(call(), -1);
+    setIOB(1, 40, 5);
+    EXPECT_EQ(call(), -1);
+}
@@ -0,0 +1,51 @@
+#include "gtest/gtest.h"
+#include "../savestate.hpp"
+#include <cstdio>
+#include <vector>
+
+namespace {
+
+const char* const PATH = "savestate_test.state";
+
+} // namespace
+
+TEST(SaveStateTest, ChunksRoundTripStoredOrCompressed) {
+    std::vector<uint8_t> zeros(4096, 0);
+    std::vector<uint8_t> counting(1000);
+    for (size_t i = 0; i < counting.size(); ++i) {
+        counting[i] = static_cast<uint8_t>(i * 7);
+    }
+    savestate::Writer writer;
+    writer.add("ZERO", 1, zeros.data(), zeros.size(), true);
+    writer.add("NEWX", 9, counting.data(), 3, true); // e.g. from a newer version
+    writer.add("CNT ", 2, counting.data(), counting.size(), false);
+    writer.add("NONE", 1, nullptr, 0);
+    ASSERT_TRUE(writer.write(PATH));
+
+    savestate::Reader reader;
+    ASSERT_TRUE(reader.open(PATH));
+    std::vector<uint8_t> out(4096, 1);
+    EXPECT_TRUE(reader.read("ZERO", 1, out.data(), out.size()));
+    EXPECT_EQ(out, zeros);
+    out.assign(counting.size(), 0);
+    EXPECT_TRUE(reader.read("CNT ", 2, out.data(), out.size()));
+    EXPECT_EQ(out, counting);
+    EXPECT_TRUE(reader.has("NONE"));
+    EXPECT_EQ(reader.size("NONE"), 0u);
+
+    EXPECT_FALSE(reader.read("CNT ", 1, out.data(), out.size())); // wrong version
+    EXPECT_FALSE(reader.read("CNT ", 2, out.data(), 10));         // wrong size
+    EXPECT_FALSE(reader.has("MISS"));
+    std::remove(PATH);
+}
+
+TEST(SaveStateTest, RejectsOtherFiles) {
+    FILE* f = fopen(PATH, "wb");
+    fputs("A2TRACE, not a state", f);
+    fclose(f);
+    savestate::Reader reader;
+    std::string error;
+    EXPECT_FALSE(reader.open(PATH, &error));
+    EXPECT_EQ(error, "not a save state");
+    std::remove(PATH);
+}
@@ -0,0 +1,74 @@
+#include "gtest/gtest.h"
+#include "../lz.hpp"
+#include "../trace.hpp"
+#include <cstdio>
+#include <random>
+
+TEST(LZTest, RoundTrip) {
+    std::mt19937 rng(1);
+    std::vector<uint8_t> data(100000);
+    for (size_t i = 0; i < data.size(); ++i) {
+        // Mix of runs, repeats and noise
+        data[i] = (i % 1000 < 500) ? uint8_t(i / 7) : uint8_t(rng());
+    }
+    std::vector<uint8_t> packed = lzCompress(data.data(), data.size());
+    EXPECT_LT(packed.size(), data.size());
+
+    std::vector<uint8_t> unpacked(data.size());
+    ASSERT_TRUE(lzDecompress(packed.data(), packed.size(), unpacked.data(), unpacked.size()));
+    EXPECT_EQ(unpacked, data);
+}
+
+TEST(LZTest, EmptyAndTinyInputs) {
+    for (size_t size : {0, 1, 3, 4, 5}) {
+        std::vector<uint8_t> data(size, 0xAA);
+        std::vector<uint8_t> packed = lzCompress(data.data(), data.size());
+        std::vector<uint8_t> unpacked(size);
+        ASSERT_TRUE(lzDecompress(packed.data(), packed.size(), unpacked.data(), unpacked.size()));
+        EXPECT_EQ(unpacked, data);
+    }
+}
+
+TEST(LZTest, RejectsTruncatedInput) {
+    std::vector<uint8_t> data(4096, 0x55);
+    std::vector<uint8_t> packed = lzCompress(data.data(), data.size());
+    std::vector<uint8_t> unpacked(data.size());
+    EXPECT_FALSE(lzDecompress(packed.data(), packed.size() / 2, unpacked.data(), unpacked.size()));
+}
+
+TEST(TraceTest, WriteAndReadBack) {
+    const char* path = "trace_test.trace";
+    const size_t count = 300000; // several blocks, wraps a small ring
+    {
+        TraceWriter writer;
+        ASSERT_TRUE(writer.open(path, 4096));
+        TraceRecord r{};
+        for (size_t i = 0; i < count; ++i) {
+            r.cycles += 2 + (i % 3);
+            r.pc = static_cast<uint16_t>(0x300 + (i % 17));
+            r.opcode = static_cast<uint8_t>(i * 7);
+            r.a = static_cast<uint8_t>(i);
+            r.sp = 0xFF - (i % 4);
+            writer.push(r);
+        }
+        writer.close();
+        EXPECT_EQ(writer.recordsWritten(), count);
+    }
+
+    TraceReader reader;
+    ASSERT_TRUE(reader.open(path));
+    TraceRecord r;
+    uint64_t cycles = 0;
+    size_t n = 0;
+    while (reader.next(r)) {
+        cycles += 2 + (n % 3);
+        ASSERT_EQ(r.cycles, cycles);
+        ASSERT_EQ(r.pc, 0x300 + (n % 17));
+        ASSERT_EQ(r.opcode, static_cast<uint8_t>(n * 7));
+        ASSERT_EQ(r.a, static_cast<uint8_t>(n));
+        ASSERT_EQ(r.sp, 0xFF - (n % 4));
+        n++;
+    }
+    EXPECT_EQ(n, count);
+    std::remove(path);
+}
@@ -0,0 +1,180 @@
+#include "gtest/gtest.h"
+#include "../cpu.hpp"
+#include "../disk2.hpp"
+#include "../gcr.hpp"
+#include "../memory.hpp"
+#include "../woz.hpp"
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <random>
+
+namespace {
+
+std::vector<uint8_t> randomImage(uint32_t seed) {
+    std::mt19937 rng(seed);
+    std::vector<uint8_t> image(gcr::IMAGE_SIZE);
+    for (uint8_t& b : image) {
+        b = static_cast<uint8_t>(rng());
+    }
+    return image;
+}
+
+void put32(std::vector<uint8_t>& out, size_t at, uint32_t v) {
+    for (int i = 0; i < 4; ++i) {
+        out[at + i] = static_cast<uint8_t>(v >> (i * 8));
+    }
+}
+
+void chunk(std::vector<uint8_t>& out, const char* id, size_t size) {
+    out.insert(out.end(), id, id + 4);
+    out.resize(out.size() + 4);
+    put32(out, out.size() - 4, static_cast<uint32_t>(size));
+}
+
+// Builds a WOZ 2.0 file from a DOS-order image: each track is the nibble
+// stream, with two zero bits after every sync byte as on a real disk.
+std::vector<uint8_t> makeWoz(const std::vector<uint8_t>& image) {
+    std::vector<uint8_t> out = {'W', 'O', 'Z', '2', 0xFF, 0x0A, 0x0D, 0x0A, 0, 0, 0, 0};
+    chunk(out, "INFO", 60);
+    size_t info = out.size();
+    out.resize(info + 60);
+    out[info] = 2;     // version
+    out[info + 1] = 1; // 5.25"
+    out[info + 2] = 1; // write protected
+    memset(&out[info + 5], ' ', 32);
+    memcpy(&out[info + 5], "test", 4);
+    out[info + 39] = 32; // 4 us bits
+
+    chunk(out, "TMAP", 160);
+    size_t tmap = out.size();
+    out.resize(tmap + 160, 0xFF);
+    chunk(out, "TRKS", 160 * 8);
+    size_t trks = out.size();
+    out.resize(trks + 160 * 8);
+    out.resize(1536); // bit data starts at block 3
+
+    for (int t = 0; t < gcr::TRACKS; ++t) {
+        std::vector<uint8_t> nibbles = gcr::nibblizeTrack(&image[t * gcr::TRACK_SIZE], t, gcr::DOS_ORDER);
+        std::vector<uint8_t> bits;
+        uint32_t count = 0;
+        auto putBit = [&](int bit) {
+            if (count % 8 == 0) {
+                bits.push_back(0);
+            }
+            bits.back() |= bit << (7 - count % 8);
+            count++;
+        };
+        for (uint8_t n : nibbles) {
+            for (int b = 7; b >= 0; --b) {
+                putBit((n >> b) & 1);
+            }
+            if (n == 0xFF) {
+                putBit(0);
+                putBit(0);
+            }
+        }
+        size_t blocks = (bits.size() + 511) / 512;
+        size_t start = out.size() / 512;
+        bits.resize(blocks * 512);
+        out.insert(out.end(), bits.begin(), bits.end());
+        uint8_t* entry = &out[trks + t * 8];
+        entry[0] = static_cast<uint8_t>(start);
+        entry[1] = static_cast<uint8_t>(start >> 8);
+        entry[2] = static_cast<uint8_t>(blocks);
+        entry[3] = 0;
+        put32(out, trks + t * 8 + 4, count);
+        for (int q = t * 4 - 1; q <= t * 4 + 1; ++q) {
+            if (q >= 0) {
+                out[tmap + q] = static_cast<uint8_t>(t);
+            }
+        }
+    }
+    put32(out, trks - 4, static_cast<uint32_t>(out.size() - trks)); // TRKS holds the bit data too
+    put32(out, 8, woz::crc32(&out[12], out.size() - 12));
+    return out;
+}
+
+std::string writeFile(const std::vector<uint8_t>& bytes, const char* name) {
+    std::string path = ::testing::TempDir() + name;
+    std::ofstream file(path, std::ios::binary | std::ios::trunc);
+    file.write(reinterpret_cast<const char*>(bytes.data()), bytes.size());
+    return path;
+}
+
+} // namespace
+
+TEST(WozTest, ParsesTracksInPlace) {
+    std::vector<uint8_t> woz = makeWoz(randomImage(1));
+    std::string path = writeFile(woz, "parse.woz");
+
+    woz::Image image;
+    std::string error;
+    ASSERT_TRUE(image.open(path, &error)) << error;
+    EXPECT_TRUE(image.verify());
+    EXPECT_TRUE(image.writeProtected());
+    EXPECT_EQ(image.creator(), "test");
+    // Quarter tracks 3-5 all read track 1; 6 is unformatted
+    EXPECT_EQ(image.track(3).bits, image.track(4).bits);
+    EXPECT_EQ(image.track(5).bits, image.track(4).bits);
+    EXPECT_TRUE(image.track(6).empty());
+    EXPECT_FALSE(image.track(4).empty());
+    // The first bits of a track are the 0xFF sync of gap 1
+    for (uint32_t i = 0; i < 8; ++i) {
+        EXPECT_EQ(image.track(0).bit(i), 1);
+    }
+    EXPECT_EQ(image.track(0).bit(8), 0);
+    image.close();
+    std::remove(path.c_str());
+
+    woz[2000] ^= 1;
+    path = writeFile(woz, "corrupt.woz");
+    ASSERT_TRUE(image.open(path));
+    EXPECT_FALSE(image.verify());
+    image.close();
+    std::remove(path.c_str());
+
+    woz.resize(1000); // track data cut off
+    path = writeFile(woz, "short.woz");
+    EXPECT_FALSE(image.open(path, &error));
+    std::remove(path.c_str());
+}
+
+TEST(WozTest, ParsesNib) {
+    std::vector<uint8_t> nib(woz::NIB_IMAGE_SIZE, 0xFF);
+    nib[34 * woz::NIB_TRACK_SIZE] = 0xD5;
+    std::string path = writeFile(nib, "image.nib");
+    woz::Image image;
+    ASSERT_TRUE(image.open(path));
+    EXPECT_EQ(image.track(136).bitCount, woz::NIB_TRACK_SIZE * 8);
+    EXPECT_EQ(image.track(136).bits[0], 0xD5);
+    EXPECT_TRUE(image.track(138).empty());
+    std::remove(path.c_str());
+}
+
+// Same as the .dsk boot test, but the drive now assembles nibbles bit by bit.
+TEST(WozTest, BootROMReadsBitstream) {
+    std::vector<uint8_t> image = randomImage(3);
+    image[0] = 2; // sectors to load
+    std::string path = writeFile(makeWoz(image), "boot.woz");
+
+    Memory mem;
+    CPU cpu(mem);
+    Disk2 disk(cpu.cycles);
+    mem.insertCard(6, &disk);
+    ASSERT_TRUE(disk.insert(0, path));
+    EXPECT_TRUE(disk.writeProtected(0));
+    mem.write(0xFF58, 0x60); // IORTS
+    mem.write(0xFCA8, 0xA9); // WAIT, which returns with A = 0
+    mem.write(0xFCA9, 0x00);
+    mem.write(0xFCAA, 0x60);
+
+    cpu.pc = 0xC600;
+    while (cpu.pc != 0x0801 && cpu.cycles < 5000000) {
+        cpu.execute(1);
+    }
+    ASSERT_EQ(cpu.pc, 0x0801);
+    EXPECT_EQ(0, memcmp(&mem.data[0x0800], &image[0], 256));
+    EXPECT_EQ(0, memcmp(&mem.data[0x0900], &image[7 * 256], 256));
+    std::remove(path.c_str());
+}
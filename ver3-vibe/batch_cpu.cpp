@@ -0,0 +1,565 @@
+#include "batch_cpu.hpp"
+#include "cpu.hpp"
+#include "opcodes.hpp"
+#include <algorithm>
+#include <array>
+#include <cstring>
+#include <string>
+#ifdef __AVX2__
+#include <immintrin.h>
+#endif
+
+namespace {
+
+// --- Lane types -----------------------------------------------------------
+// Every instruction is written once against these operators. A "mask" is a
+// value with all bits set (true) or clear (false) in each lane.
+
+struct Scalar {
+    uint32_t v;
+    Scalar(uint32_t value = 0) : v(value) {}
+};
+
+inline Scalar operator+(Scalar a, Scalar b) { return a.v + b.v; }
+inline Scalar operator-(Scalar a, Scalar b) { return a.v - b.v; }
+inline Scalar operator&(Scalar a, Scalar b) { return a.v & b.v; }
+inline Scalar operator|(Scalar a, Scalar b) { return a.v | b.v; }
+inline Scalar operator^(Scalar a, Scalar b) { return a.v ^ b.v; }
+inline Scalar operator<<(Scalar a, int n) { return a.v << n; }
+inline Scalar operator>>(Scalar a, int n) { return a.v >> n; }
+inline Scalar eq(Scalar a, Scalar b) { return a.v == b.v ? ~0u : 0u; }
+inline Scalar gt(Scalar a, Scalar b) { return a.v > b.v ? ~0u : 0u; } // operands < 2^31
+
+#ifdef __AVX2__
+struct Vec8 {
+    __m256i v;
+    Vec8(uint32_t value = 0) : v(_mm256_set1_epi32(static_cast<int>(value))) {}
+    Vec8(__m256i value) : v(value) {}
+};
+
+inline Vec8 operator+(Vec8 a, Vec8 b) { return _mm256_add_epi32(a.v, b.v); }
+inline Vec8 operator-(Vec8 a, Vec8 b) { return _mm256_sub_epi32(a.v, b.v); }
+inline Vec8 operator&(Vec8 a, Vec8 b) { return _mm256_and_si256(a.v, b.v); }
+inline Vec8 operator|(Vec8 a, Vec8 b) { return _mm256_or_si256(a.v, b.v); }
+inline Vec8 operator^(Vec8 a, Vec8 b) { return _mm256_xor_si256(a.v, b.v); }
+inline Vec8 operator<<(Vec8 a, int n) { return _mm256_sll_epi32(a.v, _mm_cvtsi32_si128(n)); }
+inline Vec8 operator>>(Vec8 a, int n) { return _mm256_srl_epi32(a.v, _mm_cvtsi32_si128(n)); }
+inline Vec8 eq(Vec8 a, Vec8 b) { return _mm256_cmpeq_epi32(a.v, b.v); }
+inline Vec8 gt(Vec8 a, Vec8 b) { return _mm256_cmpgt_epi32(a.v, b.v); }
+inline Vec8 loadVec(const uint32_t* p) { return _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p)); }
+inline void storeVec(uint32_t* p, Vec8 a) { _mm256_storeu_si256(reinterpret_cast<__m256i*>(p), a.v); }
+inline bool allSet(Vec8 mask) { return _mm256_movemask_epi8(mask.v) == -1; }
+#else
+// Portable stand-in with the same interface; compilers vectorize the loops
+// with whatever SIMD the target has.
+struct Vec8 {
+    uint32_t v[8];
+    Vec8(uint32_t value = 0) {
+        for (uint32_t& lane : v) lane = value;
+    }
+};
+
+#define VEC8_OP(expr)                                  \
+    Vec8 r;                                            \
+    for (int i = 0; i < 8; ++i) r.v[i] = (expr);       \
+    return r
+
+inline Vec8 operator+(Vec8 a, Vec8 b) { VEC8_OP(a.v[i] + b.v[i]); }
+inline Vec8 operator-(Vec8 a, Vec8 b) { VEC8_OP(a.v[i] - b.v[i]); }
+inline Vec8 operator&(Vec8 a, Vec8 b) { VEC8_OP(a.v[i] & b.v[i]); }
+inline Vec8 operator|(Vec8 a, Vec8 b) { VEC8_OP(a.v[i] | b.v[i]); }
+inline Vec8 operator^(Vec8 a, Vec8 b) { VEC8_OP(a.v[i] ^ b.v[i]); }
+inline Vec8 operator<<(Vec8 a, int n) { VEC8_OP(a.v[i] << n); }
+inline Vec8 operator>>(Vec8 a, int n) { VEC8_OP(a.v[i] >> n); }
+inline Vec8 eq(Vec8 a, Vec8 b) { VEC8_OP(a.v[i] == b.v[i] ? ~0u : 0u); }
+inline Vec8 gt(Vec8 a, Vec8 b) { VEC8_OP(a.v[i] > b.v[i] ? ~0u : 0u); }
+#undef VEC8_OP
+inline Vec8 loadVec(const uint32_t* p) {
+    Vec8 r;
+    memcpy(r.v, p, sizeof(r.v));
+    return r;
+}
+inline void storeVec(uint32_t* p, Vec8 a) { memcpy(p, a.v, sizeof(a.v)); }
+inline bool allSet(Vec8 mask) {
+    for (uint32_t lane : mask.v) {
+        if (lane != ~0u) return false;
+    }
+    return true;
+}
+#endif
+
+template <class T> T select(T mask, T a, T b) { return (a & mask) | (b & (mask ^ T(~0u))); }
+template <class T> T ne(T a, T b) { return eq(a, b) ^ T(~0u); }
+
+// Registers of one lane or one group, plus where their memory lives.
+template <class T>
+struct Lanes {
+    T a, x, y, ps, sp, pc;
+    T base; // offset of each lane's memory in the arena
+    uint8_t* arena;
+    uint32_t mask; // memorySize - 1
+};
+
+inline Scalar load(const Lanes<Scalar>& c, Scalar address) { return c.arena[c.base.v + (address.v & c.mask)]; }
+inline void store(Lanes<Scalar>& c, Scalar address, Scalar value) {
+    c.arena[c.base.v + (address.v & c.mask)] = static_cast<uint8_t>(value.v);
+}
+
+inline Vec8 load(const Lanes<Vec8>& c, Vec8 address) {
+    Vec8 offset = c.base + (address & Vec8(c.mask));
+#ifdef __AVX2__
+    // 32-bit gathers; the arena has 3 bytes of slack past the last lane.
+    return Vec8(_mm256_i32gather_epi32(reinterpret_cast<const int*>(c.arena), offset.v, 1)) & Vec8(0xFF);
+#else
+    Vec8 r;
+    for (int i = 0; i < 8; ++i) r.v[i] = c.arena[offset.v[i]];
+    return r;
+#endif
+}
+
+inline void store(Lanes<Vec8>& c, Vec8 address, Vec8 value) {
+    // No scatter in AVX2: one byte store per lane.
+    alignas(32) uint32_t offsets[8];
+    alignas(32) uint32_t values[8];
+    storeVec(offsets, c.base + (address & Vec8(c.mask)));
+    storeVec(values, value);
+    for (int i = 0; i < 8; ++i) {
+        c.arena[offsets[i]] = static_cast<uint8_t>(values[i]);
+    }
+}
+
+// --- Instructions -----------------------------------------------------------
+
+enum class Op : uint8_t {
+    NOP, ADC, AND, ASL, BRANCH, BIT, BRK, CLC, CLD, CLI, CLV, CMP, CPX, CPY, DEC, DEX, DEY, EOR, INC, INX, INY,
+    JMP, JSR, LDA, LDX, LDY, LSR, ORA, PHA, PHP, PLA, PLP, ROL, ROR, RTI, RTS, SBC, SEC, SED, SEI, STA, STX,
+    STY, TAX, TAY, TSX, TXA, TXS, TYA,
+};
+
+const std::array<Op, 256> OPS = [] {
+    static const char* const NAMES[] = {
+        "NOP", "ADC", "AND", "ASL", "B??", "BIT", "BRK", "CLC", "CLD", "CLI", "CLV", "CMP", "CPX", "CPY", "DEC",
+        "DEX", "DEY", "EOR", "INC", "INX", "INY", "JMP", "JSR", "LDA", "LDX", "LDY", "LSR", "ORA", "PHA", "PHP",
+        "PLA", "PLP", "ROL", "ROR", "RTI", "RTS", "SBC", "SEC", "SED", "SEI", "STA", "STX", "STY", "TAX", "TAY",
+        "TSX", "TXA", "TXS", "TYA",
+    };
+    std::array<Op, 256> ops{};
+    for (int opcode = 0; opcode < 256; ++opcode) {
+        const OpcodeInfo& info = OPCODES[opcode];
+        if (info.mode == AddrMode::REL) {
+            ops[opcode] = Op::BRANCH;
+            continue;
+        }
+        for (size_t i = 0; i < sizeof(NAMES) / sizeof(NAMES[0]); ++i) {
+            if (std::string(NAMES[i]) == info.mnemonic) {
+                ops[opcode] = static_cast<Op>(i);
+            }
+        }
+    }
+    return ops;
+}();
+
+template <class T> void setNZ(Lanes<T>& c, T value) {
+    c.ps = (c.ps & T(~uint32_t(CPU::AF_ZERO | CPU::AF_SIGN))) | (eq(value, T(0)) & T(CPU::AF_ZERO)) |
+           (value & T(CPU::AF_SIGN));
+}
+
+// Sets `flag` in each lane where `mask` is true, clears it elsewhere.
+template <class T> void setFlag(Lanes<T>& c, uint32_t flag, T mask) {
+    c.ps = (c.ps & T(~flag)) | (mask & T(flag));
+}
+
+template <class T> void push(Lanes<T>& c, T value) {
+    store(c, T(0x100) | c.sp, value);
+    c.sp = (c.sp - T(1)) & T(0xFF);
+}
+
+template <class T> T pop(Lanes<T>& c) {
+    c.sp = (c.sp + T(1)) & T(0xFF);
+    return load(c, T(0x100) | c.sp);
+}
+
+template <class T> void addWithCarry(Lanes<T>& c, T value) {
+    T sum = c.a + value + (c.ps & T(CPU::AF_CARRY));
+    T overflow = ((c.a ^ value) ^ T(0xFF)) & (c.a ^ sum) & T(0x80); // bit 7
+    c.ps = (c.ps & T(~uint32_t(CPU::AF_CARRY | CPU::AF_OVERFLOW))) | (overflow >> 1) | (sum >> 8);
+    c.a = sum & T(0xFF);
+    setNZ(c, c.a);
+}
+
+template <class T> void compare(Lanes<T>& c, T reg, T value) {
+    setFlag(c, CPU::AF_CARRY, gt(value, reg) ^ T(~0u));
+    setNZ(c, (reg - value) & T(0xFF));
+}
+
+// Executes `opcode` (the same in every lane of `c`) and returns the cycles
+// it took in each lane.
+template <class T> T step(Lanes<T>& c, uint8_t opcode) {
+    const OpcodeInfo& info = OPCODES[opcode];
+    const T operand = (c.pc + T(1)) & T(0xFFFF);
+    T lo = 0;
+    T address = 0;
+    T crossed = 0; // indexed address crossed a page
+    switch (info.mode) {
+    case AddrMode::IMP:
+    case AddrMode::ACC:
+    case AddrMode::REL:
+        break;
+    case AddrMode::IMM:
+        address = operand;
+        break;
+    case AddrMode::ZPG:
+        address = load(c, operand);
+        break;
+    case AddrMode::ZPX:
+        address = (load(c, operand) + c.x) & T(0xFF);
+        break;
+    case AddrMode::ZPY:
+        address = (load(c, operand) + c.y) & T(0xFF);
+        break;
+    case AddrMode::ABS:
+    case AddrMode::ABX:
+    case AddrMode::ABY:
+    case AddrMode::IND: {
+        lo = load(c, operand);
+        address = lo | (load(c, (operand + T(1)) & T(0xFFFF)) << 8);
+        if (info.mode == AddrMode::IND) {
+            address = load(c, address) | (load(c, (address + T(1)) & T(0xFFFF)) << 8);
+        } else if (info.mode != AddrMode::ABS) {
+            T index = info.mode == AddrMode::ABX ? c.x : c.y;
+            crossed = gt(lo + index, T(0xFF));
+            address = (address + index) & T(0xFFFF);
+        }
+        break;
+    }
+    case AddrMode::IZX: {
+        T zp = (load(c, operand) + c.x) & T(0xFF);
+        address = load(c, zp) | (load(c, (zp + T(1)) & T(0xFF)) << 8);
+        break;
+    }
+    case AddrMode::IZY: {
+        T zp = load(c, operand);
+        lo = load(c, zp);
+        crossed = gt(lo + c.y, T(0xFF));
+        address = ((lo | (load(c, (zp + T(1)) & T(0xFF)) << 8)) + c.y) & T(0xFFFF);
+        break;
+    }
+    default:
+        break;
+    }
+    c.pc = (c.pc + T(addrModeLength(info.mode))) & T(0xFFFF);
+    T used = T(info.cycles);
+    if (info.pagePenalty) {
+        used = used + (crossed & T(1));
+    }
+
+    const bool accumulator = info.mode == AddrMode::ACC;
+    switch (OPS[opcode]) {
+    case Op::NOP:
+        break;
+    case Op::ADC:
+        addWithCarry(c, load(c, address));
+        break;
+    case Op::SBC:
+        addWithCarry(c, load(c, address) ^ T(0xFF));
+        break;
+    case Op::AND:
+        c.a = c.a & load(c, address);
+        setNZ(c, c.a);
+        break;
+    case Op::ORA:
+        c.a = c.a | load(c, address);
+        setNZ(c, c.a);
+        break;
+    case Op::EOR:
+        c.a = c.a ^ load(c, address);
+        setNZ(c, c.a);
+        break;
+    case Op::ASL:
+    case Op::LSR:
+    case Op::ROL:
+    case Op::ROR: {
+        T value = accumulator ? c.a : load(c, address);
+        T carryIn = c.ps & T(CPU::AF_CARRY);
+        T result;
+        if (OPS[opcode] == Op::ASL || OPS[opcode] == Op::ROL) {
+            result = ((value << 1) | (OPS[opcode] == Op::ROL ? carryIn : T(0))) & T(0xFF);
+            setFlag(c, CPU::AF_CARRY, ne(value & T(0x80), T(0)));
+        } else {
+            result = (value >> 1) | (OPS[opcode] == Op::ROR ? carryIn << 7 : T(0));
+            setFlag(c, CPU::AF_CARRY, ne(value & T(1), T(0)));
+        }
+        if (accumulator) {
+            c.a = result;
+        } else {
+            store(c, address, result);
+        }
+        setNZ(c, result);
+        break;
+    }
+    case Op::BRANCH: {
+        static constexpr uint8_t FLAG[4] = {CPU::AF_SIGN, CPU::AF_OVERFLOW, CPU::AF_CARRY, CPU::AF_ZERO};
+        T set = ne(c.ps & T(FLAG[opcode >> 6]), T(0));
+        T taken = (opcode & 0x20) ? set : set ^ T(~0u);
+        T offset = (load(c, operand) ^ T(0x80)) - T(0x80); // sign-extended
+        T target = (c.pc + offset) & T(0xFFFF);
+        T far = ne((c.pc ^ target) & T(0xFF00), T(0));
+        used = used + (taken & (T(1) + (far & T(1))));
+        c.pc = select(taken, target, c.pc);
+        break;
+    }
+    case Op::BIT: {
+        T value = load(c, address);
+        setFlag(c, CPU::AF_ZERO, eq(c.a & value, T(0)));
+        c.ps = (c.ps & T(~uint32_t(CPU::AF_SIGN | CPU::AF_OVERFLOW))) | (value & T(0xC0));
+        break;
+    }
+    case Op::BRK:
+        c.pc = (c.pc + T(1)) & T(0xFFFF);
+        push(c, c.pc >> 8);
+        push(c, c.pc & T(0xFF));
+        push(c, c.ps | T(CPU::AF_BREAK));
+        c.ps = c.ps | T(CPU::AF_INTERRUPT);
+        c.pc = load(c, T(0xFFFE)) | (load(c, T(0xFFFF)) << 8);
+        break;
+    case Op::CLC:
+        c.ps = c.ps & T(~uint32_t(CPU::AF_CARRY));
+        break;
+    case Op::CLD:
+        c.ps = c.ps & T(~uint32_t(CPU::AF_DECIMAL));
+        break;
+    case Op::CLI:
+        c.ps = c.ps & T(~uint32_t(CPU::AF_INTERRUPT));
+        break;
+    case Op::CLV:
+        c.ps = c.ps & T(~uint32_t(CPU::AF_OVERFLOW));
+        break;
+    case Op::SEC:
+        c.ps = c.ps | T(CPU::AF_CARRY);
+        break;
+    case Op::SED:
+        c.ps = c.ps | T(CPU::AF_DECIMAL);
+        break;
+    case Op::SEI:
+        c.ps = c.ps | T(CPU::AF_INTERRUPT);
+        break;
+    case Op::CMP:
+        compare(c, c.a, load(c, address));
+        break;
+    case Op::CPX:
+        compare(c, c.x, load(c, address));
+        break;
+    case Op::CPY:
+        compare(c, c.y, load(c, address));
+        break;
+    case Op::DEC:
+    case Op::INC: {
+        T value = (load(c, address) + T(OPS[opcode] == Op::INC ? 1 : 0xFF)) & T(0xFF);
+        store(c, address, value);
+        setNZ(c, value);
+        break;
+    }
+    case Op::DEX:
+        c.x = (c.x - T(1)) & T(0xFF);
+        setNZ(c, c.x);
+        break;
+    case Op::DEY:
+        c.y = (c.y - T(1)) & T(0xFF);
+        setNZ(c, c.y);
+        break;
+    case Op::INX:
+        c.x = (c.x + T(1)) & T(0xFF);
+        setNZ(c, c.x);
+        break;
+    case Op::INY:
+        c.y = (c.y + T(1)) & T(0xFF);
+        setNZ(c, c.y);
+        break;
+    case Op::JMP:
+        c.pc = address;
+        break;
+    case Op::JSR: {
+        T ret = (c.pc - T(1)) & T(0xFFFF);
+        push(c, ret >> 8);
+        push(c, ret & T(0xFF));
+        c.pc = address;
+        break;
+    }
+    case Op::RTS: {
+        T low = pop(c);
+        c.pc = ((low | (pop(c) << 8)) + T(1)) & T(0xFFFF);
+        break;
+    }
+    case Op::RTI: {
+        c.ps = (pop(c) & T(~uint32_t(CPU::AF_BREAK))) | T(CPU::AF_RESERVED);
+        T low = pop(c);
+        c.pc = low | (pop(c) << 8);
+        break;
+    }
+    case Op::LDA:
+        c.a = load(c, address);
+        setNZ(c, c.a);
+        break;
+    case Op::LDX:
+        c.x = load(c, address);
+        setNZ(c, c.x);
+        break;
+    case Op::LDY:
+        c.y = load(c, address);
+        setNZ(c, c.y);
+        break;
+    case Op::STA:
+        store(c, address, c.a);
+        break;
+    case Op::STX:
+        store(c, address, c.x);
+        break;
+    case Op::STY:
+        store(c, address, c.y);
+        break;
+    case Op::PHA:
+        push(c, c.a);
+        break;
+    case Op::PHP:
+        push(c, c.ps | T(CPU::AF_BREAK));
+        break;
+    case Op::PLA:
+        c.a = pop(c);
+        setNZ(c, c.a);
+        break;
+    case Op::PLP:
+        c.ps = (pop(c) & T(~uint32_t(CPU::AF_BREAK))) | T(CPU::AF_RESERVED);
+        break;
+    case Op::TAX:
+        c.x = c.a;
+        setNZ(c, c.x);
+        break;
+    case Op::TAY:
+        c.y = c.a;
+        setNZ(c, c.y);
+        break;
+    case Op::TSX:
+        c.x = c.sp;
+        setNZ(c, c.x);
+        break;
+    case Op::TXA:
+        c.a = c.x;
+        setNZ(c, c.a);
+        break;
+    case Op::TXS:
+        c.sp = c.x;
+        break;
+    case Op::TYA:
+        c.a = c.y;
+        setNZ(c, c.a);
+        break;
+    }
+    return used;
+}
+
+} // namespace
+
+BatchCPU::BatchCPU(size_t lanes, size_t memorySize)
+    : count((lanes + GROUP - 1) / GROUP * GROUP), size(memorySize), arena(count * size + 3) {
+    a.assign(count, 0);
+    x.assign(count, 0);
+    y.assign(count, 0);
+    ps.assign(count, CPU::AF_RESERVED);
+    sp.assign(count, 0xFF);
+    pc.assign(count, 0);
+    cycles.assign(count, 0);
+}
+
+bool BatchCPU::usesAvx2() {
+#ifdef __AVX2__
+    return true;
+#else
+    return false;
+#endif
+}
+
+// Runs one lane for up to `limit` instructions or until it reaches
+// `target` cycles, keeping its registers local; returns the count.
+uint32_t BatchCPU::runLane(size_t lane, uint64_t target, uint32_t limit) {
+    Lanes<Scalar> c{a[lane], x[lane], y[lane], ps[lane], sp[lane], pc[lane],
+                    static_cast<uint32_t>(lane * size), arena.data(), static_cast<uint32_t>(size - 1)};
+    const uint8_t* mem = arena.data() + lane * size;
+    uint64_t clock = cycles[lane];
+    uint32_t executed = 0;
+    while (executed < limit && clock < target) {
+        clock += step(c, mem[c.pc.v & (size - 1)]).v;
+        executed++;
+    }
+    cycles[lane] = clock;
+    a[lane] = c.a.v;
+    x[lane] = c.x.v;
+    y[lane] = c.y.v;
+    ps[lane] = c.ps.v;
+    sp[lane] = c.sp.v;
+    pc[lane] = c.pc.v;
+    return executed;
+}
+
+// Steps lanes [first, first + GROUP) together if they all have the same
+// opcode next; returns false (nothing done) if they do not.
+bool BatchCPU::stepGroup(size_t first) {
+    alignas(32) uint32_t bases[GROUP];
+    for (size_t i = 0; i < GROUP; ++i) {
+        bases[i] = static_cast<uint32_t>((first + i) * size);
+    }
+    Lanes<Vec8> c{loadVec(&a[first]),  loadVec(&x[first]),  loadVec(&y[first]),
+                  loadVec(&ps[first]), loadVec(&sp[first]), loadVec(&pc[first]),
+                  loadVec(bases),      arena.data(),        static_cast<uint32_t>(size - 1)};
+    uint8_t opcode = arena[first * size + (pc[first] & (size - 1))];
+    if (!allSet(eq(load(c, c.pc), Vec8(opcode)))) {
+        return false;
+    }
+    alignas(32) uint32_t used[GROUP];
+    storeVec(used, step(c, opcode));
+    storeVec(&a[first], c.a);
+    storeVec(&x[first], c.x);
+    storeVec(&y[first], c.y);
+    storeVec(&ps[first], c.ps);
+    storeVec(&sp[first], c.sp);
+    storeVec(&pc[first], c.pc);
+    for (size_t i = 0; i < GROUP; ++i) {
+        cycles[first + i] += used[i];
+    }
+    return true;
+}
+
+void BatchCPU::execute(uint32_t budget) {
+    for (size_t first = 0; first < count; first += GROUP) {
+        uint64_t target[GROUP];
+        for (size_t i = 0; i < GROUP; ++i) {
+            target[i] = cycles[first + i] + budget;
+        }
+        // After a group diverges each lane runs a burst on its own before
+        // the group is tried again; bursts double while it stays diverged.
+        uint32_t burst = 1;
+        for (;;) {
+            unsigned active = 0;
+            for (size_t i = 0; i < GROUP; ++i) {
+                active |= (cycles[first + i] < target[i]) << i;
+            }
+            if (active == 0) {
+                break;
+            }
+            if (active == (1u << GROUP) - 1 && vectorized) {
+                if (stepGroup(first)) {
+                    groupSteps++;
+                    burst = 1;
+                    continue;
+                }
+                burst = std::min(burst * 2, MAX_BURST);
+            } else if (!vectorized) {
+                burst = MAX_BURST;
+            }
+            for (size_t i = 0; i < GROUP; ++i) {
+                if (active & (1u << i)) {
+                    laneSteps += runLane(first + i, target[i], burst);
+                }
+            }
+        }
+    }
+}
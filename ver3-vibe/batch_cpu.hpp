@@ -0,0 +1,58 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// Many independent 6502s stepped together, for fuzzing and exhaustive tests
+// that run thousands of small programs. Registers are kept as structure of
+// arrays (one 32-bit entry per lane) and every lane has its own flat RAM of
+// `memorySize` bytes, mirrored through the 16-bit address space -- no I/O,
+// cards or ROM protection.
+//
+// Lanes are processed in groups of GROUP. When all lanes of a group are due
+// to run the same opcode, it executes once for the whole group with AVX2
+// (gathers for operand and memory reads, lane-wise ALU and flag logic); when
+// they diverge, each lane runs a short burst on its own and the group is
+// tried again. Both paths share one generic
+// definition of every instruction, which matches CPU::execute (binary-mode
+// ADC/SBC, undocumented opcodes as 2-cycle NOPs, same cycle counts).
+class BatchCPU {
+public:
+    static constexpr size_t GROUP = 8; // 32-bit lanes per AVX2 register
+
+    // `lanes` is rounded up to a multiple of GROUP. `memorySize` is a power
+    // of two from 0x400 to 0x10000.
+    BatchCPU(size_t lanes, size_t memorySize = 0x1000);
+
+    size_t lanes() const { return count; }
+    size_t memorySize() const { return size; }
+    uint8_t* memory(size_t lane) { return arena.data() + lane * size; }
+    const uint8_t* memory(size_t lane) const { return arena.data() + lane * size; }
+
+    // Runs whole instructions until every lane has executed at least
+    // `cycles` more cycles.
+    void execute(uint32_t cycles);
+
+    // Per-lane registers. `sp` holds only the low byte (the stack is page 1).
+    std::vector<uint32_t> a, x, y, ps, sp, pc;
+    std::vector<uint64_t> cycles;
+
+    bool vectorized = true;   // false steps every lane on its own
+    uint64_t groupSteps = 0;  // instructions run for a whole group at once
+    uint64_t laneSteps = 0;   // instructions run for a single lane
+    uint64_t instructions() const { return groupSteps * GROUP + laneSteps; }
+
+    // Whether group steps use AVX2 (else a portable 8-wide fallback).
+    static bool usesAvx2();
+
+private:
+    static constexpr uint32_t MAX_BURST = 64; // instructions per lane between group attempts
+
+    uint32_t runLane(size_t lane, uint64_t target, uint32_t limit);
+    bool stepGroup(size_t first);
+
+    size_t count;
+    size_t size;
+    std::vector<uint8_t> arena; // lane memories back to back, plus gather slack
+};
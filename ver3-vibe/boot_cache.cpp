@@ -0,0 +1,81 @@
+#include "boot_cache.hpp"
+#include "woz.hpp"
+#include <algorithm>
+#include <cstdio>
+#include <filesystem>
+
+namespace {
+
+constexpr uint16_t SLOT6_ROM = 0xC600;
+
+} // namespace
+
+BootCache::BootCache(std::vector<uint8_t> rom, std::string directory)
+    : rom(std::move(rom)), directory(std::move(directory)) {}
+
+uint32_t BootCache::checksum(const std::vector<uint8_t>& rom) {
+    return woz::crc32(rom.data(), rom.size());
+}
+
+std::string BootCache::path(Point point) const {
+    char name[32];
+    snprintf(name, sizeof(name), "boot-%08x-%s.state", checksum(rom), point == Point::DiskBoot ? "disk" : "prompt");
+    return (std::filesystem::path(directory) / name).string();
+}
+
+bool BootCache::prepare(std::string* error) {
+    auto diskBootState = std::make_unique<MachineState>();
+    auto promptState = std::make_unique<MachineState>();
+    if (!load(Point::DiskBoot, *diskBootState) || !load(Point::Prompt, *promptState)) {
+        std::string message;
+        if (!build(*diskBootState, *promptState, message)) {
+            if (error) {
+                *error = message;
+            }
+            return false;
+        }
+    }
+    diskBoot = std::move(diskBootState);
+    prompt = std::move(promptState);
+    return true;
+}
+
+void BootCache::start(Machine& machine, Point point) const {
+    machine.load(point == Point::DiskBoot ? *diskBoot : *prompt);
+}
+
+// A cached state is used only if it holds this very ROM.
+bool BootCache::load(Point point, MachineState& state) const {
+    Machine machine(rom, false);
+    if (!machine.loadState(path(point))) {
+        return false;
+    }
+    machine.save(state);
+    size_t size = std::min(rom.size(), Machine::ROM_SIZE);
+    return std::equal(rom.begin(), rom.begin() + size, state.memory.begin() + Machine::ROM_START);
+}
+
+// Failing to write the cache files only costs the next run a rebuild.
+bool BootCache::build(MachineState& diskBootState, MachineState& promptState, std::string& error) const {
+    std::error_code ignored;
+    std::filesystem::create_directories(directory, ignored);
+    Machine machine(rom, false);
+    while ((machine.cpu.pc >> 8) != (SLOT6_ROM >> 8)) {
+        if (machine.cpu.cycles >= MAX_BOOT_CYCLES) {
+            error = "ROM never jumps to the slot 6 boot PROM";
+            return false;
+        }
+        machine.cpu.execute(1);
+    }
+    machine.save(diskBootState);
+    machine.saveState(path(Point::DiskBoot));
+
+    machine.cpu.reset();
+    if (machine.run(MAX_BOOT_CYCLES) != Machine::Exit::Idle) {
+        error = "ROM never waits for a key after RESET";
+        return false;
+    }
+    machine.save(promptState);
+    machine.saveState(path(Point::Prompt));
+    return true;
+}
@@ -0,0 +1,48 @@
+#pragma once
+
+#include "machine.hpp"
+#include "machine_state.hpp"
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+// Post-reset snapshots, built once per ROM so machines can start where
+// every boot ends up anyway. They are kept as save-state files named after
+// the ROM's CRC32, so editing the ROM simply misses the cache; a file whose
+// ROM bytes do not match is rebuilt too.
+//
+//   DiskBoot  reset until the Autostart Monitor jumps into the slot 6 boot
+//             PROM, before it touches the drive: inserting a disk at this
+//             point and running on is the same as booting with it inserted
+//   Prompt    RESET again from there (as Ctrl-Reset does with no disk), up
+//             to Applesoft waiting for input at ]
+class BootCache {
+public:
+    enum class Point { DiskBoot, Prompt };
+
+    static constexpr uint64_t MAX_BOOT_CYCLES = 10000000;
+
+    BootCache(std::vector<uint8_t> rom, std::string directory);
+
+    // Loads both snapshots from the cache directory, building and writing
+    // any that are missing or stale. False, with `error` set if given, when
+    // the ROM never reaches the point (e.g. it is not an Autostart ROM).
+    bool prepare(std::string* error = nullptr);
+    bool ready() const { return diskBoot && prompt; }
+
+    // Puts a machine built from the same ROM, and not yet run, at `point`.
+    void start(Machine& machine, Point point) const;
+
+    std::string path(Point point) const;
+    static uint32_t checksum(const std::vector<uint8_t>& rom);
+
+private:
+    bool load(Point point, MachineState& state) const;
+    bool build(MachineState& diskBootState, MachineState& promptState, std::string& error) const;
+
+    std::vector<uint8_t> rom;
+    std::string directory;
+    std::unique_ptr<MachineState> diskBoot;
+    std::unique_ptr<MachineState> prompt;
+};
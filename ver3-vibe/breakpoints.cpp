@@ -0,0 +1,155 @@
+#include "breakpoints.hpp"
+#include "cpu.hpp"
+
+Breakpoints::Breakpoints(Memory& memory) : memory(memory) {
+    memory.watcher = this;
+}
+
+Breakpoints::~Breakpoints() {
+    clear();
+    if (memory.watcher == this) {
+        memory.watcher = nullptr;
+    }
+}
+
+void Breakpoints::set(Bitmap& bits, std::array<uint16_t, 256>& counts, uint8_t flag, uint16_t address, bool on) {
+    uint64_t mask = uint64_t(1) << (address & 63);
+    uint64_t& word = bits[address >> 6];
+    if (on == ((word & mask) != 0)) {
+        return;
+    }
+    word ^= mask;
+    uint8_t page = address >> 8;
+    if (on ? counts[page]++ == 0 : --counts[page] == 0) {
+        memory.pageFlags[page] ^= flag;
+    }
+}
+
+void Breakpoints::add(uint16_t address) {
+    set(breaks, breakCount, Memory::PAGE_BREAK, address, true);
+}
+
+void Breakpoints::remove(uint16_t address) {
+    set(breaks, breakCount, Memory::PAGE_BREAK, address, false);
+    rules.erase(address);
+}
+
+const Breakpoints::Rule* Breakpoints::findRule(uint16_t address) const {
+    auto found = rules.find(address);
+    return found != rules.end() ? &found->second : nullptr;
+}
+
+std::vector<Breakpoints::Count> Breakpoints::counts() const {
+    std::vector<Count> result;
+    result.reserve(rules.size());
+    for (const auto& [address, rule] : rules) {
+        result.push_back({address, rule.ignore, rule.hits});
+    }
+    return result;
+}
+
+void Breakpoints::setCounts(const std::vector<Count>& counts) {
+    for (const Count& count : counts) {
+        auto found = rules.find(count.address);
+        if (found != rules.end()) {
+            found->second.ignore = count.ignore;
+            found->second.hits = count.hits;
+        }
+    }
+}
+
+void Breakpoints::watch(uint16_t first, uint16_t last, uint8_t access) {
+    for (uint32_t address = first; address <= last; ++address) {
+        if (access & READ) {
+            set(reads, readCount, Memory::PAGE_WATCH_READ, address, true);
+        }
+        if (access & WRITE) {
+            set(writes, writeCount, Memory::PAGE_WATCH_WRITE, address, true);
+        }
+    }
+}
+
+void Breakpoints::unwatch(uint16_t first, uint16_t last, uint8_t access) {
+    for (uint32_t address = first; address <= last; ++address) {
+        if (access & READ) {
+            set(reads, readCount, Memory::PAGE_WATCH_READ, address, false);
+        }
+        if (access & WRITE) {
+            set(writes, writeCount, Memory::PAGE_WATCH_WRITE, address, false);
+        }
+    }
+}
+
+bool Breakpoints::watched(uint16_t address, Access access) const {
+    return test(access == READ ? reads : writes, address);
+}
+
+void Breakpoints::clear() {
+    breaks = {};
+    reads = {};
+    writes = {};
+    breakCount = {};
+    readCount = {};
+    writeCount = {};
+    rules.clear();
+    for (uint8_t& flags : memory.pageFlags) {
+        flags &= ~(Memory::PAGE_BREAK | Memory::PAGE_WATCH_READ | Memory::PAGE_WATCH_WRITE);
+    }
+}
+
+void Breakpoints::resume(const CPU& cpu) {
+    cancel();
+    skipPc = cpu.pc;
+    skipCycles = cpu.cycles;
+}
+
+void Breakpoints::cancel() {
+    last = {};
+    for (uint8_t& flags : memory.pageFlags) {
+        flags &= ~Memory::PAGE_STOP;
+    }
+    skipCycles = UINT64_MAX;
+}
+
+bool Breakpoints::stopAt(const CPU& cpu) {
+    if (last.kind != Hit::NONE) {
+        return true;
+    }
+    uint16_t pc = cpu.pc;
+    if (!test(breaks, pc) || (pc == skipPc && cpu.cycles == skipCycles)) {
+        return false;
+    }
+    if (!rules.empty()) {
+        auto found = rules.find(pc);
+        if (found != rules.end()) {
+            Rule& rule = found->second;
+            if (!rule.condition.evaluate(cpu, memory.data.data())) {
+                return false;
+            }
+            rule.hits++;
+            if (rule.ignore > 0) {
+                rule.ignore--;
+                return false;
+            }
+        }
+    }
+    stop({Hit::BREAK, pc, 0});
+    return true;
+}
+
+// Only the first hit is kept; the rest of the instruction still runs.
+void Breakpoints::access(uint16_t address, uint8_t value, bool write) {
+    if (last.kind != Hit::NONE || !test(write ? writes : reads, address)) {
+        return;
+    }
+    stop({write ? Hit::WRITE : Hit::READ, address, value});
+}
+
+// Every page is flagged, so the CPU stops before whatever comes next and
+// keeps stopping until resume().
+void Breakpoints::stop(const Hit& hit) {
+    last = hit;
+    for (uint8_t& flags : memory.pageFlags) {
+        flags |= Memory::PAGE_STOP;
+    }
+}
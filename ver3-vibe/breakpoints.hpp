@@ -0,0 +1,115 @@
+#pragma once
+
+#include "condition.hpp"
+#include "memory.hpp"
+#include <array>
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+
+class CPU;
+
+// Breakpoints and watchpoints for one Memory, kept as 64K bitmaps with a
+// count per page. A page holding any of them is flagged in
+// Memory::pageFlags; nothing else is looked at on unflagged pages, so
+// execution away from them runs at full speed.
+//
+// A breakpoint stops CPU::execute before the instruction at its address, a
+// watchpoint after the instruction that read or wrote the address. A stop
+// flags every page PAGE_STOP, so execute() keeps returning at once, and is
+// kept in hit() until resume().
+//
+// A breakpoint may have a Rule: a condition, evaluated only when the PC
+// reaches the breakpoint, and an ignore count of hits to run past. Hits
+// count every arrival where the condition held.
+class Breakpoints : public AccessWatcher {
+public:
+    enum Access : uint8_t { READ = 0x1, WRITE = 0x2 };
+
+    struct Hit {
+        enum Kind : uint8_t { NONE, BREAK, READ, WRITE } kind = NONE;
+        uint16_t address = 0; // breakpoint or watched address
+        uint8_t value = 0;    // byte read or written
+    };
+
+    struct Rule {
+        Condition condition;
+        uint32_t ignore = 0;
+        uint32_t hits = 0;
+    };
+
+    explicit Breakpoints(Memory& memory);
+    ~Breakpoints() override;
+    Breakpoints(const Breakpoints&) = delete;
+    Breakpoints& operator=(const Breakpoints&) = delete;
+
+    void add(uint16_t address);
+    // Also drops the breakpoint's rule.
+    void remove(uint16_t address);
+    bool has(uint16_t address) const { return test(breaks, address); }
+
+    // The rule for a breakpoint at `address`, created empty (always stops)
+    // if there is none.
+    Rule& rule(uint16_t address) { return rules[address]; }
+    const Rule* findRule(uint16_t address) const;
+
+    // Every rule's ignore count and hits, for History to put back before it
+    // replays hits that were already counted. setCounts() skips rules that
+    // are gone and leaves rules missing from `counts` alone.
+    struct Count {
+        uint16_t address;
+        uint32_t ignore;
+        uint32_t hits;
+    };
+    std::vector<Count> counts() const;
+    void setCounts(const std::vector<Count>& counts);
+
+    // Watches `first`..`last` inclusive for `access` (READ, WRITE or both).
+    void watch(uint16_t first, uint16_t last, uint8_t access);
+    void unwatch(uint16_t first, uint16_t last, uint8_t access);
+    bool watched(uint16_t address, Access access) const;
+
+    // Removes every breakpoint and watchpoint.
+    void clear();
+
+    bool stopped() const { return last.kind != Hit::NONE; }
+    const Hit& hit() const { return last; }
+    // Clears the stop. Execution continues from the CPU's current PC even
+    // if it holds a breakpoint; any later arrival there stops again.
+    void resume(const CPU& cpu);
+    // Clears the stop without stepping off anything (History, before it
+    // loads a snapshot).
+    void cancel();
+    // Stops as if `hit` had just happened (History, on reaching a stop it
+    // found by replaying).
+    void report(const Hit& hit) { stop(hit); }
+
+    // Called by CPU::execute on flagged pages, before the instruction at
+    // its PC. True to stop there.
+    bool stopAt(const CPU& cpu);
+
+    void access(uint16_t address, uint8_t value, bool write) override;
+
+private:
+    using Bitmap = std::array<uint64_t, Memory::ADDRESS_SPACE_SIZE / 64>;
+
+    static bool test(const Bitmap& bits, uint16_t address) { return bits[address >> 6] >> (address & 63) & 1; }
+    // Sets or clears one bit, keeping the page's count and flag in step.
+    void set(Bitmap& bits, std::array<uint16_t, 256>& counts, uint8_t flag, uint16_t address, bool on);
+    void stop(const Hit& hit);
+
+    Memory& memory;
+    Bitmap breaks{};
+    Bitmap reads{};
+    Bitmap writes{};
+    std::array<uint16_t, 256> breakCount{};
+    std::array<uint16_t, 256> readCount{};
+    std::array<uint16_t, 256> writeCount{};
+    std::unordered_map<uint16_t, Rule> rules;
+
+    Hit last;
+    // resume() steps off a breakpoint: the instruction at skipPc is not
+    // stopped at while the CPU is still at skipCycles.
+    uint16_t skipPc = 0;
+    uint64_t skipCycles = UINT64_MAX;
+};
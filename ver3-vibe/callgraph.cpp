@@ -0,0 +1,201 @@
+#include "callgraph.hpp"
+#include <algorithm>
+#include <cctype>
+#include <cstdio>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+
+CallGraph::CallGraph() : routines(0x10000) {
+    nodes.push_back({0, false, 0, 0});
+}
+
+void CallGraph::charge(uint64_t now) {
+    nodes[current()].exclusive += now - lastCycles;
+    lastCycles = now;
+}
+
+void CallGraph::onCall(uint16_t target, uint8_t sp, uint64_t now) {
+    enter(target, false, sp, now);
+}
+
+void CallGraph::onInterrupt(uint16_t vector, uint8_t sp, uint64_t now) {
+    enter(vector, true, sp, now);
+}
+
+void CallGraph::enter(uint16_t target, bool interrupt, uint8_t sp, uint64_t now) {
+    charge(now);
+    // Anything at or below the current stack pointer has already been popped.
+    unwind(sp, now);
+
+    uint32_t parent = current();
+    uint64_t key = (uint64_t(parent) << 17) | (uint64_t(interrupt) << 16) | target;
+    auto it = children.find(key);
+    uint32_t node;
+    if (it == children.end()) {
+        node = static_cast<uint32_t>(nodes.size());
+        nodes.push_back({target, interrupt, parent, 0});
+        children.emplace(key, node);
+    } else {
+        node = it->second;
+    }
+
+    stack.push_back({target, sp, node, now});
+    RoutineStats& stats = routines[target];
+    stats.calls++;
+    stats.active++;
+}
+
+void CallGraph::onReturn(uint8_t sp, uint64_t now) {
+    charge(now);
+    unwind(sp, now);
+}
+
+// Pops every frame whose return address lies at or below `sp`. A normal
+// RTS/RTI pops exactly the top frame; an RTS used as a jump pops nothing.
+void CallGraph::unwind(int sp, uint64_t now) {
+    while (!stack.empty() && stack.back().sp <= sp + 1) {
+        const Frame& frame = stack.back();
+        RoutineStats& stats = routines[frame.routine];
+        if (--stats.active == 0) {
+            stats.inclusive += now - frame.entry;
+        }
+        stack.pop_back();
+    }
+}
+
+void CallGraph::finish(uint64_t now) {
+    charge(now);
+    unwind(0x100, now);
+}
+
+namespace {
+
+bool parseAddress(std::string token, uint16_t& addr) {
+    if (token.rfind("C:", 0) == 0) {
+        token = token.substr(2);
+    }
+    if (!token.empty() && token[0] == '$') {
+        token = token.substr(1);
+    } else if (token.rfind("0x", 0) == 0 || token.rfind("0X", 0) == 0) {
+        token = token.substr(2);
+    }
+    if (token.empty() || token.size() > 4) {
+        return false;
+    }
+    for (char c : token) {
+        if (!isxdigit(static_cast<unsigned char>(c))) {
+            return false;
+        }
+    }
+    addr = static_cast<uint16_t>(std::stoul(token, nullptr, 16));
+    return true;
+}
+
+bool hasAddressPrefix(const std::string& token) {
+    return token.rfind("$", 0) == 0 || token.rfind("0x", 0) == 0 || token.rfind("0X", 0) == 0 ||
+           token.rfind("C:", 0) == 0;
+}
+
+} // namespace
+
+bool CallGraph::loadLabels(const std::string& filename) {
+    std::ifstream file(filename);
+    if (!file.is_open()) {
+        std::cerr << "Error: Could not open label file: " << filename << std::endl;
+        return false;
+    }
+
+    std::string line;
+    while (std::getline(file, line)) {
+        line = line.substr(0, line.find_first_of(";#"));
+        std::istringstream in(line);
+        std::vector<std::string> tokens;
+        std::string token;
+        while (in >> token) {
+            if (token != "=" && token != "EQU" && token != "equ" && token != "al") {
+                tokens.push_back(token);
+            }
+        }
+        if (tokens.size() != 2) {
+            continue;
+        }
+
+        // An explicitly prefixed token ($, 0x, C:) is the address; otherwise
+        // assume "ADDR NAME" when the first token parses as hex.
+        uint16_t addr;
+        int addrIndex;
+        if (hasAddressPrefix(tokens[0]) != hasAddressPrefix(tokens[1])) {
+            addrIndex = hasAddressPrefix(tokens[0]) ? 0 : 1;
+        } else {
+            addrIndex = parseAddress(tokens[0], addr) ? 0 : 1;
+        }
+        if (!parseAddress(tokens[addrIndex], addr)) {
+            continue;
+        }
+        std::string name = tokens[1 - addrIndex];
+        if (!name.empty() && name[0] == '.') {
+            name = name.substr(1);
+        }
+        labels[addr] = name;
+    }
+    return true;
+}
+
+std::string CallGraph::name(const Node& node) const {
+    std::string result;
+    auto it = labels.find(node.routine);
+    if (it != labels.end()) {
+        result = it->second;
+    } else {
+        char buf[8];
+        snprintf(buf, sizeof(buf), "$%04X", node.routine);
+        result = buf;
+    }
+    return node.interrupt ? "[irq]" + result : result;
+}
+
+void CallGraph::writeFolded(std::ostream& out) const {
+    std::vector<std::string> paths(nodes.size());
+    paths[0] = "[top]";
+    // Children are always created after their parent, so one forward pass works.
+    for (size_t i = 1; i < nodes.size(); ++i) {
+        paths[i] = paths[nodes[i].parent] + ";" + name(nodes[i]);
+    }
+    for (size_t i = 0; i < nodes.size(); ++i) {
+        if (nodes[i].exclusive) {
+            out << paths[i] << " " << nodes[i].exclusive << "\n";
+        }
+    }
+}
+
+void CallGraph::writeSummary(std::ostream& out, size_t topN) const {
+    std::vector<uint64_t> exclusive(0x10000);
+    uint64_t total = 0;
+    for (size_t i = 0; i < nodes.size(); ++i) {
+        total += nodes[i].exclusive;
+        if (i != 0) {
+            exclusive[nodes[i].routine] += nodes[i].exclusive;
+        }
+    }
+
+    std::vector<uint32_t> order;
+    for (uint32_t r = 0; r < 0x10000; ++r) {
+        if (routines[r].calls) {
+            order.push_back(r);
+        }
+    }
+    std::sort(order.begin(), order.end(), [this](uint32_t l, uint32_t r) {
+        return routines[l].inclusive != routines[r].inclusive ? routines[l].inclusive > routines[r].inclusive : l < r;
+    });
+
+    out << "== Routines (top " << topN << " by inclusive cycles, " << total << " total) ==\n";
+    out << "  routine                 calls     inclusive     exclusive\n";
+    for (size_t i = 0; i < order.size() && i < topN; ++i) {
+        uint16_t r = static_cast<uint16_t>(order[i]);
+        out << "  " << std::left << std::setw(18) << name({r, false, 0, 0}) << std::right
+            << std::setw(11) << routines[r].calls << std::setw(14) << routines[r].inclusive
+            << std::setw(14) << exclusive[r] << "\n";
+    }
+}
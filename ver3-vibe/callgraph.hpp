@@ -0,0 +1,70 @@
+#pragma once
+
+#include <cstdint>
+#include <iosfwd>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+// Shadow call stack driven by JSR/RTS/BRK/RTI. Attributes emulated cycles to
+// call paths (exclusive) and routines (inclusive/exclusive), and writes the
+// folded-stack format consumed by flamegraph.pl.
+//
+// Frames are keyed by the stack pointer at the call site, so stack tricks are
+// tolerated: an RTS used as a computed jump leaves the shadow stack alone, and
+// frames whose return address has been popped or overwritten (TXS resets,
+// PLA/PLA aborts) are discarded at the next call or return.
+class CallGraph {
+public:
+    CallGraph();
+
+    // `sp` is the stack pointer before the return address is pushed.
+    void onCall(uint16_t target, uint8_t sp, uint64_t now);
+    void onInterrupt(uint16_t vector, uint8_t sp, uint64_t now);
+    // `sp` is the stack pointer after the return address is pulled.
+    void onReturn(uint8_t sp, uint64_t now);
+
+    // Closes all open frames at `now`; call before writing results.
+    void finish(uint64_t now);
+
+    // Label file: one symbol per line, "NAME = $ADDR", "NAME EQU $ADDR",
+    // "ADDR NAME" or VICE "al C:ADDR .NAME". Blank lines and ;/# comments skipped.
+    bool loadLabels(const std::string& filename);
+
+    void writeFolded(std::ostream& out) const;
+    void writeSummary(std::ostream& out, size_t topN = 30) const;
+
+private:
+    struct Node {
+        uint16_t routine;
+        bool interrupt;
+        uint32_t parent;
+        uint64_t exclusive;
+    };
+
+    struct Frame {
+        uint16_t routine;
+        uint8_t sp;
+        uint32_t node;
+        uint64_t entry;
+    };
+
+    struct RoutineStats {
+        uint64_t calls = 0;
+        uint64_t inclusive = 0;
+        uint32_t active = 0; // frames currently on the shadow stack (recursion)
+    };
+
+    void enter(uint16_t target, bool interrupt, uint8_t sp, uint64_t now);
+    void unwind(int sp, uint64_t now);
+    void charge(uint64_t now);
+    uint32_t current() const { return stack.empty() ? 0 : stack.back().node; }
+    std::string name(const Node& node) const;
+
+    std::vector<Node> nodes;                          // node 0 is the root
+    std::unordered_map<uint64_t, uint32_t> children;  // (parent, interrupt, routine) -> node
+    std::vector<Frame> stack;
+    std::vector<RoutineStats> routines;
+    std::unordered_map<uint16_t, std::string> labels;
+    uint64_t lastCycles = 0;
+};
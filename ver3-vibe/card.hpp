@@ -0,0 +1,17 @@
+#pragma once
+
+#include <cstdint>
+
+// Peripheral card in slots 1-7. The card owns the 16 soft switches at
+// $C080+slot*16 and may provide a 256-byte ROM mapped at $Cn00.
+class Card {
+public:
+    virtual ~Card() = default;
+
+    // Access to soft switch `reg` (0-15). `value` is only meaningful for
+    // writes; the return value is only used for reads.
+    virtual uint8_t io(uint8_t reg, bool write, uint8_t value) = 0;
+
+    // Slot ROM contents, or nullptr if the card has none.
+    virtual const uint8_t* rom() const { return nullptr; }
+};
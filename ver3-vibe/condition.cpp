@@ -0,0 +1,370 @@
+#include "condition.hpp"
+#include "cpu.hpp"
+#include <cctype>
+#include <climits>
+#include <cstring>
+
+namespace {
+
+constexpr int32_t MAX_NUMBER = 0xFFFFFF;
+
+} // namespace
+
+// Recursive descent: || and && here, the other binary operators by
+// precedence climbing.
+struct Condition::Parser {
+    struct Binary {
+        const char* token;
+        Op op;
+        int precedence;
+    };
+    // Longer tokens first, so "<=" is not read as "<".
+    static constexpr Binary BINARY[] = {
+        {"==", Op::EQ, 4}, {"!=", Op::NE, 4}, {"<=", Op::LE, 5}, {">=", Op::GE, 5},
+        {"=", Op::EQ, 4},  {"<", Op::LT, 5},  {">", Op::GT, 5},  {"|", Op::OR, 1},
+        {"^", Op::XOR, 2}, {"&", Op::AND, 3}, {"+", Op::ADD, 6}, {"-", Op::SUB, 6},
+    };
+
+    const std::string& text;
+    size_t at = 0;
+    std::vector<Instruction> code;
+    int depth = 0;
+    int32_t pcTerm = -1;
+    std::vector<Range> ranges;
+    bool simple = true; // an && chain of terms that fit a Range
+    std::string error;
+
+    explicit Parser(const std::string& text) : text(text) {}
+
+    bool fail(const std::string& message) {
+        if (error.empty()) {
+            error = message;
+        }
+        return false;
+    }
+
+    void skipSpace() {
+        while (at < text.size() && isspace(static_cast<unsigned char>(text[at]))) {
+            at++;
+        }
+    }
+
+    bool accept(const char* token) {
+        skipSpace();
+        size_t length = strlen(token);
+        if (text.compare(at, length, token) != 0) {
+            return false;
+        }
+        at += length;
+        return true;
+    }
+
+    bool push(Instruction instruction) {
+        code.push_back(instruction);
+        return ++depth <= MAX_DEPTH || fail("Condition is nested too deeply");
+    }
+
+    // Marks the jump at `jump` to land after the last instruction.
+    void patch(size_t jump) {
+        code[jump].value = static_cast<int32_t>(code.size());
+    }
+
+    bool orExpression(bool top) {
+        if (!andExpression(top)) {
+            return false;
+        }
+        while (accept("||")) {
+            if (top) {
+                pcTerm = -1; // PC==ADDR no longer has to hold
+                simple = false;
+            }
+            size_t jump = code.size();
+            code.push_back({Op::OR_JUMP});
+            depth--;
+            if (!andExpression(false)) {
+                return false;
+            }
+            code.push_back({Op::BOOL});
+            patch(jump);
+        }
+        return true;
+    }
+
+    bool andExpression(bool top) {
+        if (!term(top)) {
+            return false;
+        }
+        while (accept("&&")) {
+            size_t jump = code.size();
+            code.push_back({Op::AND_JUMP});
+            depth--;
+            if (!term(top)) {
+                return false;
+            }
+            code.push_back({Op::BOOL});
+            patch(jump);
+        }
+        return true;
+    }
+
+    // One operand of &&. At the top level, notes a bare "PC==ADDR" and
+    // whether the term fits a Range.
+    bool term(bool top) {
+        size_t start = code.size();
+        if (!binary(1)) {
+            return false;
+        }
+        if (top && pcTerm < 0 && code.size() == start + 2 && code[start].op == Op::REG && code[start].value == PC &&
+            code[start + 1].op == Op::EQ && code[start + 1].immediate) {
+            pcTerm = code[start + 1].value & 0xFFFF;
+        }
+        if (top) {
+            simple = simple && code.size() == start + 2 && range(code[start], code[start + 1]);
+        }
+        return true;
+    }
+
+    // REG or MEM_AT compared with a constant, as a Range.
+    bool range(const Instruction& load, const Instruction& compare) {
+        if ((load.op != Op::REG && load.op != Op::MEM_AT) || !compare.immediate) {
+            return false;
+        }
+        Range r{load.op == Op::REG ? static_cast<uint8_t>(load.value) : MEMORY, false,
+                static_cast<uint16_t>(load.op == Op::MEM_AT ? load.value : 0), 0, 0};
+        int32_t c = compare.value;
+        switch (compare.op) {
+        case Op::EQ: r.lo = c; r.hi = c; break;
+        case Op::NE: r.lo = c; r.hi = c; r.outside = true; break;
+        case Op::LT: r.lo = INT32_MIN; r.hi = c - 1; break;
+        case Op::LE: r.lo = INT32_MIN; r.hi = c; break;
+        case Op::GT: r.lo = c + 1; r.hi = INT32_MAX; break;
+        case Op::GE: r.lo = c; r.hi = INT32_MAX; break;
+        default: return false;
+        }
+        ranges.push_back(r);
+        return true;
+    }
+
+    const Binary* binaryOperator(int minPrecedence) {
+        skipSpace();
+        for (const Binary& candidate : BINARY) {
+            size_t length = strlen(candidate.token);
+            if (candidate.precedence < minPrecedence || text.compare(at, length, candidate.token) != 0) {
+                continue;
+            }
+            // "|" and "&" are not the start of "||" and "&&"
+            if (length == 1 && (text[at] == '|' || text[at] == '&') && at + 1 < text.size() && text[at + 1] == text[at]) {
+                continue;
+            }
+            at += length;
+            return &candidate;
+        }
+        return nullptr;
+    }
+
+    bool binary(int minPrecedence) {
+        if (!unary()) {
+            return false;
+        }
+        while (const Binary* op = binaryOperator(minPrecedence)) {
+            size_t start = code.size();
+            if (!binary(op->precedence + 1)) {
+                return false;
+            }
+            if (code.size() == start + 1 && code.back().op == Op::CONST) {
+                code.back() = {op->op, true, code.back().value};
+            } else {
+                code.push_back({op->op});
+            }
+            depth--;
+        }
+        return true;
+    }
+
+    bool unary() {
+        if (accept("!")) {
+            if (!unary()) {
+                return false;
+            }
+            code.push_back({Op::NOT});
+            return true;
+        }
+        if (accept("(")) {
+            return orExpression(false) && (accept(")") || fail("Expected )"));
+        }
+        skipSpace();
+        if (at < text.size() && (text[at] == '$' || isdigit(static_cast<unsigned char>(text[at])))) {
+            return number();
+        }
+        size_t start = at;
+        while (at < text.size() && isalnum(static_cast<unsigned char>(text[at]))) {
+            at++;
+        }
+        std::string name = text.substr(start, at - start);
+        for (char& c : name) {
+            c = static_cast<char>(tolower(static_cast<unsigned char>(c)));
+        }
+        static const char* const REGISTERS[] = {"a", "x", "y", "p", "sp", "pc"};
+        for (int reg = A; reg <= PC; ++reg) {
+            if (name == REGISTERS[reg]) {
+                return push({Op::REG, false, reg});
+            }
+        }
+        if (name == "mem") {
+            if (!accept("[")) {
+                return fail("Expected [ after mem");
+            }
+            size_t inner = code.size();
+            if (!orExpression(false) || !(accept("]") || fail("Expected ]"))) {
+                return false;
+            }
+            if (code.size() == inner + 1 && code.back().op == Op::CONST) {
+                code.back() = {Op::MEM_AT, false, code.back().value & 0xFFFF};
+            } else {
+                code.push_back({Op::MEM});
+            }
+            return true;
+        }
+        if (name.empty()) {
+            return fail(at < text.size() ? "Unexpected " + text.substr(at, 1) : "Unexpected end of condition");
+        }
+        return fail("Unknown name: " + name);
+    }
+
+    bool number() {
+        int base = 10;
+        if (text[at] == '$') {
+            base = 16;
+            at++;
+        } else if (text.compare(at, 2, "0x") == 0 || text.compare(at, 2, "0X") == 0) {
+            base = 16;
+            at += 2;
+        }
+        size_t start = at;
+        int32_t value = 0;
+        while (at < text.size() && (base == 16 ? isxdigit(static_cast<unsigned char>(text[at]))
+                                                : isdigit(static_cast<unsigned char>(text[at])))) {
+            char c = static_cast<char>(tolower(static_cast<unsigned char>(text[at++])));
+            value = value * base + (isdigit(static_cast<unsigned char>(c)) ? c - '0' : c - 'a' + 10);
+            if (value > MAX_NUMBER) {
+                return fail("Number too large");
+            }
+        }
+        if (at == start) {
+            return fail("Expected a number");
+        }
+        return push({Op::CONST, false, value});
+    }
+};
+
+bool Condition::compile(const std::string& text, std::string* error) {
+    Parser parser(text);
+    bool ok = parser.orExpression(true);
+    parser.skipSpace();
+    if (ok && parser.at != text.size()) {
+        ok = parser.fail("Unexpected " + text.substr(parser.at));
+    }
+    if (!ok) {
+        if (error) {
+            *error = parser.error;
+        }
+        return false;
+    }
+    code = std::move(parser.code);
+    source = text;
+    pcTerm = parser.pcTerm;
+    useRanges = parser.simple;
+    ranges = useRanges ? std::move(parser.ranges) : std::vector<Range>();
+    return true;
+}
+
+bool Condition::evaluate(const CPU& cpu, const uint8_t* memory) const {
+    if (useRanges) {
+        for (const Range& r : ranges) {
+            int32_t value;
+            switch (r.reg) {
+            case A: value = cpu.a; break;
+            case X: value = cpu.x; break;
+            case Y: value = cpu.y; break;
+            case P: value = cpu.ps; break;
+            case SP: value = cpu.sp; break;
+            case PC: value = cpu.pc; break;
+            default: value = memory[r.address]; break;
+            }
+            // One unsigned compare for lo <= value <= hi
+            bool inside = uint32_t(value) - uint32_t(r.lo) <= uint32_t(r.hi) - uint32_t(r.lo);
+            if (inside == r.outside) {
+                return false;
+            }
+        }
+        return true;
+    }
+    int32_t stack[MAX_DEPTH];
+    int top = -1;
+    const Instruction* program = code.data();
+    size_t size = code.size();
+    for (size_t i = 0; i < size; ++i) {
+        const Instruction& in = program[i];
+        switch (in.op) {
+        case Op::CONST:
+            stack[++top] = in.value;
+            continue;
+        case Op::REG:
+            switch (in.value) {
+            case A: stack[++top] = cpu.a; break;
+            case X: stack[++top] = cpu.x; break;
+            case Y: stack[++top] = cpu.y; break;
+            case P: stack[++top] = cpu.ps; break;
+            case SP: stack[++top] = cpu.sp; break;
+            default: stack[++top] = cpu.pc; break;
+            }
+            continue;
+        case Op::MEM:
+            stack[top] = memory[stack[top] & 0xFFFF];
+            continue;
+        case Op::MEM_AT:
+            stack[++top] = memory[in.value];
+            continue;
+        case Op::NOT:
+            stack[top] = !stack[top];
+            continue;
+        case Op::BOOL:
+            stack[top] = stack[top] != 0;
+            continue;
+        case Op::AND_JUMP:
+            if (stack[top] == 0) {
+                i = in.value - 1;
+            } else {
+                top--;
+            }
+            continue;
+        case Op::OR_JUMP:
+            if (stack[top] != 0) {
+                stack[top] = 1;
+                i = in.value - 1;
+            } else {
+                top--;
+            }
+            continue;
+        default:
+            break;
+        }
+        int32_t right = in.immediate ? in.value : stack[top--];
+        int32_t& left = stack[top];
+        switch (in.op) {
+        case Op::ADD: left += right; break;
+        case Op::SUB: left -= right; break;
+        case Op::AND: left &= right; break;
+        case Op::XOR: left ^= right; break;
+        case Op::OR: left |= right; break;
+        case Op::LT: left = left < right; break;
+        case Op::LE: left = left <= right; break;
+        case Op::GT: left = left > right; break;
+        case Op::GE: left = left >= right; break;
+        case Op::EQ: left = left == right; break;
+        case Op::NE: left = left != right; break;
+        default: break;
+        }
+    }
+    return top < 0 || stack[top] != 0;
+}
@@ -0,0 +1,72 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+class CPU;
+
+// A breakpoint condition such as "PC=$FD1B && A==$8D && mem[$24]>30",
+// compiled once into bytecode for a small stack machine.
+//
+//   operands   A X Y P SP PC, mem[EXPR], numbers ($ or 0x for hex, else
+//              decimal), ( )
+//   operators  ! (unary), + -, &, ^, |, < <= > >=, == = !=, &&, ||
+//              with C precedence; && and || short-circuit
+//
+// Comparisons give 0 or 1; the condition holds if the result is not zero.
+// mem[] reads RAM directly, without soft-switch side effects. Constant
+// addresses and constant right-hand operands are folded into the
+// instruction that uses them, so "A==$8D" is two instructions.
+//
+// The usual condition, an && chain of registers or mem[CONSTANT] compared
+// with constants, is also compiled to a list of range tests, which
+// evaluate() runs instead of the bytecode: no stack, and one predictable
+// branch per term in place of an opcode dispatch.
+class Condition {
+public:
+    // An empty condition always holds.
+    Condition() = default;
+
+    bool compile(const std::string& text, std::string* error = nullptr);
+    bool empty() const { return code.empty(); }
+    const std::string& text() const { return source; }
+    // The address in a top-level "PC==ADDR" term, or -1.
+    int32_t pc() const { return pcTerm; }
+
+    bool evaluate(const CPU& cpu, const uint8_t* memory) const;
+
+private:
+    struct Parser;
+
+    enum class Op : uint8_t {
+        CONST, REG, MEM, MEM_AT, NOT, BOOL,
+        ADD, SUB, AND, XOR, OR, LT, LE, GT, GE, EQ, NE,
+        AND_JUMP, OR_JUMP, // short-circuit: jump to `value` or pop
+    };
+    enum Reg : uint8_t { A, X, Y, P, SP, PC };
+
+    struct Instruction {
+        Op op;
+        bool immediate = false; // binary op: right operand is `value`
+        int32_t value = 0;      // constant, register, address or jump target
+    };
+
+    // Holds if lo <= value <= hi, or if it does not when `outside`.
+    struct Range {
+        uint8_t reg;      // Reg, or MEMORY for mem[address]
+        bool outside;
+        uint16_t address;
+        int32_t lo;
+        int32_t hi;
+    };
+    static constexpr uint8_t MEMORY = PC + 1;
+
+    static constexpr int MAX_DEPTH = 16;
+
+    std::vector<Instruction> code;
+    std::vector<Range> ranges;
+    bool useRanges = false;
+    std::string source;
+    int32_t pcTerm = -1;
+};
@@ -1,4 +1,7 @@
 #include "cpu.hpp"
+#include "breakpoints.hpp"
+#include "opcodes.hpp"
+#include "rwts.hpp"
 #include <iostream>
 
 #define SET_FLAG(flag, value) (ps = (ps & ~(flag)) | ((value) ? (flag) : 0))
@@ -8,6 +11,19 @@
     SET_FLAG(AF_ZERO, (val) == 0); \
     SET_FLAG(AF_SIGN, ((val) & 0x80) != 0);
 
+// Profiler hooks compile to nothing unless CPU_PROFILER is defined.
+#ifdef CPU_PROFILER
+#define PROFILE_BEGIN() const uint16_t profilePC = pc
+#define PROFILE_END(opcode, used) \
+    if (profiler) profiler->record(profilePC, (opcode), (used))
+#define CALLGRAPH_EVENT(event) \
+    if (callGraph) callGraph->event
+#else
+#define PROFILE_BEGIN()
+#define PROFILE_END(opcode, used)
+#define CALLGRAPH_EVENT(event)
+#endif
+
 CPU::CPU(Memory& mem) : memory(mem) {
     reset();
 }
@@ -17,7 +33,7 @@ void CPU::reset() {
     x = 0;
     y = 0;
     ps = 0x20;
-    sp = 0x01FF;
+    sp = 0xFF;
 
     uint8_t lo = memory.read(0xFFFC);
     uint8_t hi = memory.read(0xFFFD);
@@ -29,13 +45,11 @@ uint8_t CPU::fetch() {
 }
 
 void CPU::push(uint8_t value) {
-    memory.write(0x0100 | (sp & 0xFF), value);
-    sp--;
+    memory.write(0x0100 | sp--, value);
 }
 
 uint8_t CPU::pop() {
-    sp++;
-    return memory.read(0x0100 | (sp & 0xFF));
+    return memory.read(0x0100 | ++sp);
 }
 
 // --- Addressing Modes ---
@@ -49,12 +63,14 @@ uint16_t CPU::addr_abs() {
 uint16_t CPU::addr_abs_x() {
     uint8_t lo = fetch();
     uint8_t hi = fetch();
+    pageCrossed = lo + x > 0xFF;
     return ((hi << 8) | lo) + x;
 }
 
 uint16_t CPU::addr_abs_y() {
     uint8_t lo = fetch();
     uint8_t hi = fetch();
+    pageCrossed = lo + y > 0xFF;
     return ((hi << 8) | lo) + y;
 }
 
@@ -74,14 +90,15 @@ uint16_t CPU::addr_ind() {
 uint16_t CPU::addr_x_ind() {
     uint8_t zpg_addr = fetch() + x;
     uint8_t lo = memory.read(zpg_addr);
-    uint8_t hi = memory.read(zpg_addr + 1);
+    uint8_t hi = memory.read(static_cast<uint8_t>(zpg_addr + 1));
     return (hi << 8) | lo;
 }
 
 uint16_t CPU::addr_ind_y() {
     uint8_t zpg_addr = fetch();
     uint8_t lo = memory.read(zpg_addr);
-    uint8_t hi = memory.read(zpg_addr + 1);
+    uint8_t hi = memory.read(static_cast<uint8_t>(zpg_addr + 1));
+    pageCrossed = lo + y > 0xFF;
     return ((hi << 8) | lo) + y;
 }
 
@@ -130,7 +147,9 @@ void CPU::asl_acc() {
 void CPU::branch(bool condition) {
     int8_t offset = fetch();
     if (condition) {
-        pc += offset;
+        uint16_t target = pc + offset;
+        extraCycles += ((pc ^ target) & 0xFF00) ? 2 : 1;
+        pc = target;
     }
 }
 
@@ -142,6 +161,7 @@ void CPU::bit(uint16_t addr) {
 }
 
 void CPU::brk() {
+    [[maybe_unused]] uint8_t callerSP = sp;
     pc++;
     push(pc >> 8);
     push(pc & 0xFF);
@@ -150,6 +170,7 @@ void CPU::brk() {
     uint8_t lo = memory.read(0xFFFE);
     uint8_t hi = memory.read(0xFFFF);
     pc = (hi << 8) | lo;
+    CALLGRAPH_EVENT(onInterrupt(pc, callerSP, cycles + 7));
 }
 
 void CPU::clc() { SET_FLAG(AF_CARRY, false); }
@@ -206,10 +227,12 @@ void CPU::jmp(uint16_t addr) {
 }
 
 void CPU::jsr(uint16_t addr) {
+    [[maybe_unused]] uint8_t callerSP = sp;
     pc--;
     push(pc >> 8);
     push(pc & 0xFF);
     pc = addr;
+    CALLGRAPH_EVENT(onCall(addr, callerSP, cycles + 6));
 }
 
 void CPU::lda(uint16_t addr) {
@@ -290,12 +313,14 @@ void CPU::rti() {
     uint8_t lo = pop();
     uint8_t hi = pop();
     pc = (hi << 8) | lo;
+    CALLGRAPH_EVENT(onReturn(sp, cycles + 6));
 }
 
 void CPU::rts() {
     uint8_t lo = pop();
     uint8_t hi = pop();
     pc = ((hi << 8) | lo) + 1;
+    CALLGRAPH_EVENT(onReturn(sp, cycles + 6));
 }
 
 void CPU::sbc(uint16_t addr) {
@@ -317,16 +342,36 @@ void CPU::sty(uint16_t addr) { memory.write(addr, y); }
 
 void CPU::tax() { x = a; SETNZ(x); }
 void CPU::tay() { y = a; SETNZ(y); }
-void CPU::tsx() { x = sp & 0xFF; SETNZ(x); }
+void CPU::tsx() { x = sp; SETNZ(x); }
 void CPU::txa() { a = x; SETNZ(a); }
-void CPU::txs() { sp = 0x0100 | x; }
+void CPU::txs() { sp = x; }
 void CPU::tya() { a = y; SETNZ(a); }
 
 
 void CPU::execute(uint32_t cycles) {
-    uint32_t cycles_to_execute = cycles;
+    int64_t cycles_to_execute = cycles;
+    const uint8_t* pageFlags = memory.pageFlags.data();
     while (cycles_to_execute > 0) {
+        // One flag test per instruction; the bitmaps are only looked at on
+        // flagged pages.
+        if (pageFlags[pc >> 8] & (Memory::PAGE_BREAK | Memory::PAGE_STOP)) [[unlikely]] {
+            if (breakpoints && breakpoints->stopAt(*this)) {
+                break;
+            }
+        }
+        // A trapped RWTS call costs the RTS that returns from it.
+        if (rwts && pc == RwtsTrap::ENTRY && rwts->handle(*this)) {
+            this->cycles += 6;
+            cycles_to_execute -= 6;
+            continue;
+        }
+        PROFILE_BEGIN();
         uint8_t opcode = fetch();
+        if (trace) {
+            trace->push({this->cycles, static_cast<uint16_t>(pc - 1), opcode, a, x, y, ps, sp});
+        }
+        pageCrossed = false;
+        extraCycles = 0;
         switch (opcode) {
             case 0x69: adc(addr_imm()); break;
             case 0x65: adc(addr_zpg()); break;
@@ -514,6 +559,10 @@ void CPU::execute(uint32_t cycles) {
                 // std::cout << "Unknown opcode: " << std::hex << (int)opcode << std::endl;
                 break;
         }
-        cycles_to_execute--;
+        const OpcodeInfo& info = OPCODES[opcode];
+        uint32_t used = info.cycles + extraCycles + (pageCrossed && info.pagePenalty);
+        this->cycles += used;
+        cycles_to_execute -= used;
+        PROFILE_END(opcode, used);
     }
 }
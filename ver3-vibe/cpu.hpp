@@ -2,11 +2,22 @@
 
 #include <cstdint>
 #include "memory.hpp"
+#include "trace.hpp"
+
+class Breakpoints;
+class RwtsTrap;
+
+#ifdef CPU_PROFILER
+#include "callgraph.hpp"
+#include "profiler.hpp"
+#endif
 
 class CPU {
 public:
     CPU(Memory& mem);
     void reset();
+    // Runs whole instructions until at least `cycles` cycles have elapsed,
+    // or until `breakpoints` stops it.
     void execute(uint32_t cycles);
 
     // 6502 Registers
@@ -15,7 +26,18 @@ public:
     uint8_t y;   // index Y
     uint8_t ps;  // processor status
     uint16_t pc;  // program counter
-    uint16_t sp;  // stack pointer
+    uint8_t sp;   // stack pointer, into page 1
+
+    uint64_t cycles = 0; // total cycles executed
+
+    TraceWriter* trace = nullptr; // instruction trace, recorded when set
+    RwtsTrap* rwts = nullptr;     // DOS 3.3 RWTS fast path, when set
+    Breakpoints* breakpoints = nullptr; // asked on pages its memory flags
+
+#ifdef CPU_PROFILER
+    Profiler* profiler = nullptr;
+    CallGraph* callGraph = nullptr;
+#endif
 
     // 6502 Processor Status flags
     enum {
@@ -32,6 +54,10 @@ public:
 private:
     Memory& memory;
 
+    // Per-instruction cycle adjustments, reset before each opcode
+    bool pageCrossed = false; // indexed address crossed a page boundary
+    uint8_t extraCycles = 0;  // taken-branch penalties
+
     uint8_t fetch();
     void push(uint8_t value);
     uint8_t pop();
@@ -0,0 +1,525 @@
+#include "debugger.hpp"
+#include "opcodes.hpp"
+#include <cctype>
+#include <cstdio>
+#include <istream>
+#include <ostream>
+#include <sstream>
+#include <vector>
+
+namespace {
+
+const char* const HELP =
+    "s [N]             step N instructions\n"
+    "n                 step over a JSR\n"
+    "f                 run to return from this subroutine\n"
+    "u ADDR            run until PC = ADDR\n"
+    "c                 continue\n"
+    "rs [N]            step back N instructions\n"
+    "rc                continue backwards\n"
+    "b [ADDR] [if COND]  set a breakpoint / list\n"
+    "bi ADDR N         ignore the next N hits\n"
+    "bc ADDR           clear a breakpoint\n"
+    "w ADDR [END] [r|w|rw]  watch memory (default w)\n"
+    "wc ADDR [END]     clear watchpoints\n"
+    "r [REG VALUE]     registers (A X Y P SP PC)\n"
+    "m ADDR [COUNT]    dump memory\n"
+    "e ADDR BYTE...    edit memory\n"
+    "d [ADDR] [COUNT]  disassemble\n"
+    "q                 quit\n";
+
+constexpr uint8_t JSR = 0x20;
+constexpr int DEFAULT_DUMP = 0x80;
+constexpr int DEFAULT_LINES = 10;
+
+// Hex, with or without a leading $.
+bool parseHex(const std::string& text, uint32_t max, uint32_t& value) {
+    size_t start = (!text.empty() && text[0] == '$') ? 1 : 0;
+    if (start == text.size() || text.size() - start > 8) {
+        return false;
+    }
+    uint32_t result = 0;
+    for (size_t i = start; i < text.size(); ++i) {
+        if (!isxdigit(static_cast<unsigned char>(text[i]))) {
+            return false;
+        }
+        result = result * 16 + (isdigit(static_cast<unsigned char>(text[i])) ? text[i] - '0' : (tolower(text[i]) - 'a' + 10));
+    }
+    if (result > max) {
+        return false;
+    }
+    value = result;
+    return true;
+}
+
+std::string hex(uint32_t value, int digits) {
+    char text[16];
+    snprintf(text, sizeof(text), "$%0*X", digits, value);
+    return text;
+}
+
+} // namespace
+
+Debugger::Debugger(Machine& machine, History* history) : machine(machine), history(history) {}
+
+Debugger::Action Debugger::console(std::istream& in, std::ostream& out) {
+    std::string line;
+    std::string last;
+    while (true) {
+        out << "debug> " << std::flush;
+        if (!std::getline(in, line)) {
+            return Action::Quit;
+        }
+        // An empty line repeats the last command, for stepping.
+        if (line.find_first_not_of(" \t\r") == std::string::npos) {
+            line = last;
+        }
+        last = line;
+        Action action = command(line, out);
+        if (action != Action::Prompt) {
+            return action;
+        }
+    }
+}
+
+Debugger::Action Debugger::command(const std::string& line, std::ostream& out) {
+    std::istringstream words(line);
+    std::string name;
+    std::vector<std::string> args;
+    words >> name;
+    for (std::string word; words >> word;) {
+        args.push_back(word);
+    }
+    for (char& c : name) {
+        c = static_cast<char>(tolower(static_cast<unsigned char>(c)));
+    }
+    if (name.empty()) {
+        return Action::Prompt;
+    }
+
+    CPU& cpu = machine.cpu;
+    Memory& memory = machine.memory;
+    Breakpoints& breakpoints = machine.breakpoints;
+    uint32_t a = 0;
+    uint32_t b = 0;
+    auto address = [&](size_t i, uint32_t& value) {
+        if (i >= args.size() || !parseHex(args[i], 0xFFFF, value)) {
+            out << "Expected an address\n";
+            return false;
+        }
+        return true;
+    };
+    auto optional = [&](size_t i, uint32_t max, uint32_t fallback, uint32_t& value) {
+        value = fallback;
+        if (i < args.size() && !parseHex(args[i], max, value)) {
+            out << "Bad number: " << args[i] << "\n";
+            return false;
+        }
+        return true;
+    };
+
+    if (name == "s") {
+        if (optional(0, 0xFFFFFF, 1, a)) {
+            step(static_cast<int>(a), out);
+        }
+    } else if (name == "n") {
+        if (memory.data[cpu.pc] != JSR) {
+            step(1, out);
+            return Action::Prompt;
+        }
+        runUntil(static_cast<uint16_t>(cpu.pc + 3), true, cpu.sp);
+        return Action::Run;
+    } else if (name == "f") {
+        // The return address is on top of the stack unless the routine has
+        // pushed since its JSR; RTS adds one to it.
+        uint16_t low = memory.data[0x0100 | uint8_t(cpu.sp + 1)];
+        uint16_t high = memory.data[0x0100 | uint8_t(cpu.sp + 2)];
+        runUntil(static_cast<uint16_t>((low | (high << 8)) + 1), cpu.sp <= 0xFD, static_cast<uint8_t>(cpu.sp + 2));
+        return Action::Run;
+    } else if (name == "u") {
+        if (!address(0, a)) {
+            return Action::Prompt;
+        }
+        runUntil(static_cast<uint16_t>(a));
+        return Action::Run;
+    } else if (name == "c") {
+        breakpoints.resume(cpu);
+        return Action::Run;
+    } else if (name == "rs" || name == "rc") {
+        if (!history) {
+            out << "No history is recorded\n";
+            return Action::Prompt;
+        }
+        if (name == "rc" && !args.empty()) {
+            out << "Usage: rc\n";
+            return Action::Prompt;
+        }
+        if (!optional(0, 0xFFFFFF, 1, a)) {
+            return Action::Prompt;
+        }
+        clearUntil();
+        bool found = name == "rs" ? history->stepBack(a) : history->continueBack();
+        if (!found) {
+            out << "Start of history\n";
+        } else if (breakpoints.stopped()) {
+            stopped(out);
+            return Action::Prompt;
+        }
+        showLocation(out);
+    } else if (name == "b") {
+        if (args.empty()) {
+            listBreakpoints(out);
+            return Action::Prompt;
+        }
+        size_t ifAt = 0;
+        while (ifAt < args.size() && args[ifAt] != "if") {
+            ifAt++;
+        }
+        Condition condition;
+        if (ifAt < args.size()) {
+            std::string text;
+            for (size_t i = ifAt + 1; i < args.size(); ++i) {
+                text += (i > ifAt + 1 ? " " : "") + args[i];
+            }
+            std::string error;
+            if (!condition.compile(text, &error)) {
+                out << "Bad condition: " << error << "\n";
+                return Action::Prompt;
+            }
+        }
+        if (ifAt == 0 && condition.pc() >= 0) {
+            a = static_cast<uint32_t>(condition.pc());
+        } else if (ifAt == 0 || ifAt > 1) {
+            out << "Usage: b ADDR [if COND], or b if PC==ADDR && ...\n";
+            return Action::Prompt;
+        } else if (!address(0, a)) {
+            return Action::Prompt;
+        }
+        if (until.active && until.address == a) {
+            until.userBreak = true;
+        }
+        breakpoints.add(static_cast<uint16_t>(a));
+        userRule(static_cast<uint16_t>(a)) = {std::move(condition)};
+        if (history) {
+            history->record(true); // replays start from the new counters
+        }
+    } else if (name == "bi") {
+        if (!address(0, a) || !optional(1, 0xFFFFFFFF, 0, b)) {
+            return Action::Prompt;
+        }
+        if (!breakpoints.has(static_cast<uint16_t>(a)) || (until.active && until.address == a && !until.userBreak)) {
+            out << "No breakpoint at " << hex(a, 4) << "\n";
+            return Action::Prompt;
+        }
+        userRule(static_cast<uint16_t>(a)).ignore = b;
+        if (history) {
+            history->record(true);
+        }
+    } else if (name == "bc") {
+        if (address(0, a)) {
+            if (until.active && until.address == a) {
+                until.userBreak = false; // still needed by the run-until
+                until.saved = {};
+            } else {
+                breakpoints.remove(static_cast<uint16_t>(a));
+            }
+        }
+    } else if (name == "w" || name == "wc") {
+        if (!address(0, a)) {
+            return Action::Prompt;
+        }
+        size_t next = 1;
+        b = a;
+        if (args.size() > 1 && parseHex(args[1], 0xFFFF, b)) {
+            next = 2;
+        }
+        if (b < a) {
+            out << "END is before ADDR\n";
+            return Action::Prompt;
+        }
+        uint8_t access = Breakpoints::WRITE;
+        if (name == "wc") {
+            access = Breakpoints::READ | Breakpoints::WRITE;
+        } else if (next < args.size()) {
+            const std::string& kind = args[next];
+            access = (kind == "r") ? Breakpoints::READ : (kind == "rw") ? Breakpoints::READ | Breakpoints::WRITE : Breakpoints::WRITE;
+        }
+        if (name == "w") {
+            breakpoints.watch(static_cast<uint16_t>(a), static_cast<uint16_t>(b), access);
+        } else {
+            breakpoints.unwatch(static_cast<uint16_t>(a), static_cast<uint16_t>(b), access);
+        }
+    } else if (name == "r") {
+        if (args.empty()) {
+            showRegisters(out);
+            return Action::Prompt;
+        }
+        std::string reg = args[0];
+        for (char& c : reg) {
+            c = static_cast<char>(tolower(static_cast<unsigned char>(c)));
+        }
+        uint32_t max = reg == "pc" ? 0xFFFF : 0xFF;
+        if (args.size() < 2 || !parseHex(args[1], max, a)) {
+            out << "Usage: r REG VALUE\n";
+            return Action::Prompt;
+        }
+        if (reg == "a") {
+            cpu.a = static_cast<uint8_t>(a);
+        } else if (reg == "x") {
+            cpu.x = static_cast<uint8_t>(a);
+        } else if (reg == "y") {
+            cpu.y = static_cast<uint8_t>(a);
+        } else if (reg == "p") {
+            cpu.ps = static_cast<uint8_t>(a);
+        } else if (reg == "sp") {
+            cpu.sp = static_cast<uint8_t>(a);
+        } else if (reg == "pc") {
+            cpu.pc = static_cast<uint16_t>(a);
+        } else {
+            out << "Unknown register: " << args[0] << "\n";
+            return Action::Prompt;
+        }
+        if (history) {
+            history->record(true);
+        }
+        showRegisters(out);
+    } else if (name == "m") {
+        if (!address(0, a) || !optional(1, 0x10000, DEFAULT_DUMP, b)) {
+            return Action::Prompt;
+        }
+        for (uint32_t row = 0; row < b; row += 16) {
+            char text[96];
+            int at = snprintf(text, sizeof(text), "$%04X ", static_cast<unsigned>((a + row) & 0xFFFF));
+            std::string chars;
+            for (uint32_t i = row; i < row + 16 && i < b; ++i) {
+                uint8_t byte = memory.data[(a + i) & 0xFFFF];
+                at += snprintf(text + at, sizeof(text) - at, " %02X", byte);
+                chars += isprint(byte & 0x7F) ? static_cast<char>(byte & 0x7F) : '.';
+            }
+            out << text << "  " << chars << "\n";
+        }
+    } else if (name == "e") {
+        if (!address(0, a)) {
+            return Action::Prompt;
+        }
+        std::vector<uint8_t> bytes;
+        for (size_t i = 1; i < args.size(); ++i) {
+            if (!parseHex(args[i], 0xFF, b)) {
+                out << "Bad byte: " << args[i] << "\n";
+                return Action::Prompt;
+            }
+            bytes.push_back(static_cast<uint8_t>(b));
+        }
+        for (size_t i = 0; i < bytes.size(); ++i) {
+            memory.poke(static_cast<uint16_t>(a + i), bytes[i]);
+        }
+        if (history) {
+            history->record(true);
+        }
+    } else if (name == "d") {
+        if (!optional(0, 0xFFFF, cpu.pc, a) || !optional(1, 0x1000, DEFAULT_LINES, b)) {
+            return Action::Prompt;
+        }
+        uint16_t at = static_cast<uint16_t>(a);
+        for (uint32_t i = 0; i < b; ++i) {
+            uint8_t length = 1;
+            out << disassemble(at, &length) << "\n";
+            at = static_cast<uint16_t>(at + length);
+        }
+    } else if (name == "q") {
+        return Action::Quit;
+    } else if (name == "h" || name == "?") {
+        out << HELP;
+    } else {
+        out << "Unknown command: " << name << " (h for help)\n";
+    }
+    return Action::Prompt;
+}
+
+bool Debugger::stopped(std::ostream& out) {
+    CPU& cpu = machine.cpu;
+    Breakpoints& breakpoints = machine.breakpoints;
+    const Breakpoints::Hit& hit = breakpoints.hit();
+    if (until.active && hit.kind == Breakpoints::Hit::BREAK && hit.address == until.address) {
+        if (until.checkDepth && cpu.sp < until.minSp && !until.userBreak) {
+            breakpoints.resume(cpu); // a deeper call got here first
+            return false;
+        }
+        clearUntil();
+    } else {
+        clearUntil();
+        switch (hit.kind) {
+        case Breakpoints::Hit::BREAK:
+            out << "Breakpoint " << hex(hit.address, 4);
+            if (const Breakpoints::Rule* rule = breakpoints.findRule(hit.address); rule && rule->hits > 1) {
+                out << " (hit " << rule->hits << ")";
+            }
+            out << "\n";
+            break;
+        case Breakpoints::Hit::READ:
+            out << "Read " << hex(hit.address, 4) << " = " << hex(hit.value, 2) << "\n";
+            break;
+        case Breakpoints::Hit::WRITE:
+            out << "Write " << hex(hit.address, 4) << " = " << hex(hit.value, 2) << "\n";
+            break;
+        case Breakpoints::Hit::NONE:
+            break;
+        }
+    }
+    showLocation(out);
+    return true;
+}
+
+void Debugger::breakIn(std::ostream& out) {
+    clearUntil();
+    showLocation(out);
+}
+
+const std::string& Debugger::disassemble(uint16_t address, uint8_t* length) {
+    Memory& memory = machine.memory;
+    auto found = lines.find(address);
+    if (found != lines.end()) {
+        const Line& line = found->second;
+        uint8_t last = static_cast<uint16_t>(address + line.length - 1) >> 8;
+        if (line.generations[0] == memory.writeGeneration[address >> 8] &&
+            line.generations[1] == memory.writeGeneration[last]) {
+            cacheHits++;
+            if (length) {
+                *length = line.length;
+            }
+            return line.text;
+        }
+    }
+    cacheMisses++;
+
+    uint8_t bytes[3];
+    for (int i = 0; i < 3; ++i) {
+        bytes[i] = memory.data[static_cast<uint16_t>(address + i)];
+    }
+    uint8_t size = addrModeLength(OPCODES[bytes[0]].mode);
+    char text[64];
+    int at = snprintf(text, sizeof(text), "$%04X ", address);
+    for (int i = 0; i < 3; ++i) {
+        at += snprintf(text + at, sizeof(text) - at, i < size ? " %02X" : "   ", bytes[i]);
+    }
+    snprintf(text + at, sizeof(text) - at, "  %s", ::disassemble(address, bytes[0], bytes[1], bytes[2]).c_str());
+
+    uint8_t first = address >> 8;
+    uint8_t last = static_cast<uint16_t>(address + size - 1) >> 8;
+    memory.pageFlags[first] |= Memory::PAGE_CODE;
+    memory.pageFlags[last] |= Memory::PAGE_CODE;
+    Line& line = lines[address];
+    line = {text, size, {memory.writeGeneration[first], memory.writeGeneration[last]}};
+    if (length) {
+        *length = size;
+    }
+    return line.text;
+}
+
+void Debugger::step(int count, std::ostream& out) {
+    CPU& cpu = machine.cpu;
+    Breakpoints& breakpoints = machine.breakpoints;
+    for (int i = 0; i < count; ++i) {
+        breakpoints.resume(cpu);
+        cpu.execute(1);
+        if (breakpoints.stopped()) {
+            stopped(out); // a watchpoint
+            return;
+        }
+    }
+    showLocation(out);
+}
+
+Breakpoints::Rule& Debugger::userRule(uint16_t address) {
+    return (until.active && until.address == address) ? until.saved : machine.breakpoints.rule(address);
+}
+
+// A user breakpoint at the target keeps its hit count, but its condition
+// and ignore count must not hold up the run-until: the rule is set aside.
+void Debugger::runUntil(uint16_t address, bool checkDepth, uint8_t minSp) {
+    Breakpoints& breakpoints = machine.breakpoints;
+    clearUntil();
+    until.active = true;
+    until.address = address;
+    until.userBreak = breakpoints.has(address);
+    until.checkDepth = checkDepth;
+    until.minSp = minSp;
+    if (until.userBreak) {
+        if (const Breakpoints::Rule* rule = breakpoints.findRule(address)) {
+            until.saved = *rule;
+        }
+        breakpoints.remove(address);
+    }
+    breakpoints.add(address);
+    breakpoints.resume(machine.cpu);
+}
+
+void Debugger::clearUntil() {
+    if (until.active) {
+        machine.breakpoints.remove(until.address);
+        if (until.userBreak) {
+            machine.breakpoints.add(until.address);
+            machine.breakpoints.rule(until.address) = std::move(until.saved);
+        }
+    }
+    until = {};
+}
+
+void Debugger::showRegisters(std::ostream& out) const {
+    const CPU& cpu = machine.cpu;
+    char flags[9] = "NV-BDIZC";
+    for (int bit = 0; bit < 8; ++bit) {
+        if (!(cpu.ps & (0x80 >> bit))) {
+            flags[bit] = static_cast<char>(tolower(flags[bit]));
+        }
+    }
+    char text[96];
+    snprintf(text, sizeof(text), "A=%02X X=%02X Y=%02X P=%02X SP=%02X PC=%04X  %s  cycle %llu", cpu.a, cpu.x, cpu.y,
+             cpu.ps, cpu.sp, cpu.pc, flags, static_cast<unsigned long long>(cpu.cycles));
+    out << text << "\n";
+}
+
+void Debugger::showLocation(std::ostream& out) {
+    showRegisters(out);
+    out << disassemble(machine.cpu.pc) << "\n";
+}
+
+// Consecutive watched addresses are shown as one range.
+void Debugger::listBreakpoints(std::ostream& out) const {
+    const Breakpoints& breakpoints = machine.breakpoints;
+    for (uint32_t address = 0; address <= 0xFFFF; ++address) {
+        bool target = until.active && until.address == address;
+        if (!breakpoints.has(static_cast<uint16_t>(address)) || (target && !until.userBreak)) {
+            continue;
+        }
+        out << "break " << hex(address, 4);
+        const Breakpoints::Rule* rule = target ? &until.saved : breakpoints.findRule(static_cast<uint16_t>(address));
+        if (rule && !rule->condition.empty()) {
+            out << " if " << rule->condition.text();
+        }
+        if (rule && rule->hits) {
+            out << ", hits " << rule->hits;
+        }
+        if (rule && rule->ignore) {
+            out << ", ignore " << rule->ignore;
+        }
+        out << "\n";
+    }
+    for (Breakpoints::Access access : {Breakpoints::READ, Breakpoints::WRITE}) {
+        for (uint32_t address = 0; address <= 0xFFFF; ++address) {
+            if (!breakpoints.watched(static_cast<uint16_t>(address), access)) {
+                continue;
+            }
+            uint32_t end = address;
+            while (end < 0xFFFF && breakpoints.watched(static_cast<uint16_t>(end + 1), access)) {
+                end++;
+            }
+            out << (access == Breakpoints::READ ? "read  " : "write ") << hex(address, 4);
+            if (end != address) {
+                out << "-" << hex(end, 4);
+            }
+            out << "\n";
+            address = end;
+        }
+    }
+}
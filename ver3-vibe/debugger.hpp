@@ -0,0 +1,98 @@
+#pragma once
+
+#include "history.hpp"
+#include "machine.hpp"
+#include <cstdint>
+#include <iosfwd>
+#include <string>
+#include <unordered_map>
+
+// Console debugger for a Machine.
+//
+//   s [N]             step N instructions (default 1)
+//   n                 step over: a JSR runs to its return
+//   f                 run to return from the current subroutine
+//   u ADDR            run until PC reaches ADDR
+//   c                 continue
+//   rs [N]            step back N instructions
+//   rc                continue backwards to the previous stop
+//   b [ADDR] [if COND]  set a breakpoint, or list breakpoints and watchpoints
+//   bi ADDR N         run past the breakpoint's next N hits
+//   bc ADDR           clear a breakpoint
+//   w ADDR [END] [r|w|rw]  watch reads and/or writes (default w)
+//   wc ADDR [END]     clear watchpoints
+//   r [REG VALUE]     show registers, or set A X Y P SP PC
+//   m ADDR [COUNT]    dump memory
+//   e ADDR BYTE...    edit memory
+//   d [ADDR] [COUNT]  disassemble (default from PC)
+//   q                 quit
+//
+// Numbers are hex, with or without a leading $; conditions have their own
+// syntax (see Condition), and "b if PC==ADDR && ..." takes the address
+// from the condition. Stepping runs here; the
+// commands that run on (n, f, u, c) only set temporary breakpoints and
+// return Action::Run, and the caller runs the machine at full speed -- its
+// own frame loop, or Machine::run() -- until Breakpoints stops it, then
+// calls stopped(). Stepping back needs a History recording the machine;
+// editing registers or memory takes a snapshot there, so no replay runs
+// across the edit.
+class Debugger {
+public:
+    enum class Action { Prompt, Run, Quit };
+
+    explicit Debugger(Machine& machine, History* history = nullptr);
+
+    Action command(const std::string& line, std::ostream& out);
+    // Reads commands until one runs the machine on or quits; Quit at the
+    // end of input.
+    Action console(std::istream& in, std::ostream& out);
+
+    // Called once the machine has stopped on a breakpoint or watchpoint.
+    // Returns false if the stop belongs to a run-until command that is not
+    // done (e.g. a recursive call reached the step-over address); the
+    // machine has then been resumed. Otherwise reports where it stopped.
+    bool stopped(std::ostream& out);
+
+    // For stops that are not breakpoints (a break-in key, the machine
+    // waiting for a key): cancels any run-until and shows where it is.
+    void breakIn(std::ostream& out);
+
+    // "$FD1B  E6 4E     INC $4E"; `length` gets the instruction's size.
+    // Lines are cached until a byte they were decoded from is written.
+    const std::string& disassemble(uint16_t address, uint8_t* length = nullptr);
+
+    size_t cacheHits = 0;
+    size_t cacheMisses = 0;
+
+private:
+    struct Line {
+        std::string text;
+        uint8_t length;
+        uint32_t generations[2]; // of the pages holding the first and last byte
+    };
+
+    // A run-until target, removed when reached.
+    struct Until {
+        bool active = false;
+        uint16_t address = 0;
+        bool userBreak = false; // a breakpoint the user set is there too
+        Breakpoints::Rule saved; // its rule, set aside until the target is reached
+        bool checkDepth = false;
+        uint8_t minSp = 0;      // reached only with SP >= minSp
+    };
+
+    void step(int count, std::ostream& out);
+    // The rule the user set for `address`: the one set aside while a
+    // run-until targets it.
+    Breakpoints::Rule& userRule(uint16_t address);
+    void runUntil(uint16_t address, bool checkDepth = false, uint8_t minSp = 0);
+    void clearUntil();
+    void showRegisters(std::ostream& out) const;
+    void showLocation(std::ostream& out);
+    void listBreakpoints(std::ostream& out) const;
+
+    Machine& machine;
+    History* history;
+    Until until;
+    std::unordered_map<uint16_t, Line> lines;
+};
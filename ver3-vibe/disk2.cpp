@@ -0,0 +1,446 @@
+#include "disk2.hpp"
+#include <algorithm>
+#include <cctype>
+#include <iostream>
+
+const uint8_t Disk2::BOOT_ROM[256] = {
+    0xA2, 0x20, 0xA0, 0x00, 0xA2, 0x03, 0x86, 0x3C, 0x8A, 0x0A, 0x24, 0x3C, 0xF0, 0x10, 0x05, 0x3C,
+    0x49, 0xFF, 0x29, 0x7E, 0xB0, 0x08, 0x4A, 0xD0, 0xFB, 0x98, 0x9D, 0x56, 0x03, 0xC8, 0xE8, 0x10,
+    0xE5, 0x20, 0x58, 0xFF, 0xBA, 0xBD, 0x00, 0x01, 0x0A, 0x0A, 0x0A, 0x0A, 0x85, 0x2B, 0xAA, 0xBD,
+    0x8E, 0xC0, 0xBD, 0x8C, 0xC0, 0xBD, 0x8A, 0xC0, 0xBD, 0x89, 0xC0, 0xA0, 0x50, 0xBD, 0x80, 0xC0,
+    0x98, 0x29, 0x03, 0x0A, 0x05, 0x2B, 0xAA, 0xBD, 0x81, 0xC0, 0xA9, 0x56, 0x20, 0xA8, 0xFC, 0x88,
+    0x10, 0xEB, 0x85, 0x26, 0x85, 0x3D, 0x85, 0x41, 0xA9, 0x08, 0x85, 0x27, 0x18, 0x08, 0xBD, 0x8C,
+    0xC0, 0x10, 0xFB, 0x49, 0xD5, 0xD0, 0xF7, 0xBD, 0x8C, 0xC0, 0x10, 0xFB, 0xC9, 0xAA, 0xD0, 0xF3,
+    0xEA, 0xBD, 0x8C, 0xC0, 0x10, 0xFB, 0xC9, 0x96, 0xF0, 0x09, 0x28, 0x90, 0xDF, 0x49, 0xAD, 0xF0,
+    0x25, 0xD0, 0xD9, 0xA0, 0x03, 0x85, 0x40, 0xBD, 0x8C, 0xC0, 0x10, 0xFB, 0x2A, 0x85, 0x3C, 0xBD,
+    0x8C, 0xC0, 0x10, 0xFB, 0x25, 0x3C, 0x88, 0xD0, 0xEC, 0x28, 0xC5, 0x3D, 0xD0, 0xBE, 0xA5, 0x40,
+    0xC5, 0x41, 0xD0, 0xB8, 0xB0, 0xB7, 0xA0, 0x56, 0x84, 0x3C, 0xBC, 0x8C, 0xC0, 0x10, 0xFB, 0x59,
+    0xD6, 0x02, 0xA4, 0x3C, 0x88, 0x99, 0x00, 0x03, 0xD0, 0xEE, 0x84, 0x3C, 0xBC, 0x8C, 0xC0, 0x10,
+    0xFB, 0x59, 0xD6, 0x02, 0xA4, 0x3C, 0x91, 0x26, 0xC8, 0xD0, 0xEF, 0xBC, 0x8C, 0xC0, 0x10, 0xFB,
+    0x59, 0xD6, 0x02, 0xD0, 0x87, 0xA0, 0x00, 0xA2, 0x56, 0xCA, 0x30, 0xFB, 0xB1, 0x26, 0x5E, 0x00,
+    0x03, 0x2A, 0x5E, 0x00, 0x03, 0x2A, 0x91, 0x26, 0xC8, 0xD0, 0xEE, 0xE6, 0x27, 0xE6, 0x3D, 0xA5,
+    0x3D, 0xCD, 0x00, 0x08, 0xA6, 0x2B, 0x90, 0xDB, 0x4C, 0x01, 0x08, 0x00, 0x00, 0x00, 0x00, 0x00,
+};
+
+namespace {
+
+bool hasExtension(const std::string& filename, const char* ext) {
+    size_t dot = filename.find_last_of('.');
+    if (dot == std::string::npos) {
+        return false;
+    }
+    std::string suffix = filename.substr(dot + 1);
+    for (char& c : suffix) {
+        c = static_cast<char>(tolower(static_cast<unsigned char>(c)));
+    }
+    return suffix == ext;
+}
+
+} // namespace
+
+Disk2::Disk2(const uint64_t& clock) : clock(clock) {}
+
+Disk2::~Disk2() {
+    {
+        std::lock_guard<std::mutex> lock(flushMutex);
+        stopping = true;
+    }
+    flushWake.notify_one();
+    if (flusher.joinable()) {
+        flusher.join();
+    }
+    for (int d = 0; d < DRIVES; ++d) {
+        eject(d);
+    }
+}
+
+bool Disk2::insert(int drive, const std::string& filename, bool writeProtected) {
+    eject(drive);
+    if (hasExtension(filename, "woz") || hasExtension(filename, "nib")) {
+        Drive& d = drives[drive];
+        std::string error;
+        if (!d.bitstream.open(filename, &error)) {
+            std::cerr << "Error: " << error << ": " << filename << std::endl;
+            return false;
+        }
+        if (!d.bitstream.verify()) {
+            std::cerr << "Warning: CRC mismatch in " << filename << std::endl;
+        }
+        d.filename = filename;
+        d.writeProtected = true;
+        d.bitPosition = 0;
+        return true;
+    }
+    MappedFile file;
+    if (!file.open(filename, !writeProtected)) {
+        std::cerr << "Error: Could not open disk image: " << filename << std::endl;
+        return false;
+    }
+    if (file.size() != gcr::IMAGE_SIZE) {
+        std::cerr << "Error: Unsupported disk image size (" << file.size() << " bytes): " << filename << std::endl;
+        return false;
+    }
+    if (!writeProtected && !file.writable()) {
+        std::cerr << "Warning: " << filename << " is read-only; inserting it write-protected" << std::endl;
+    }
+
+    Drive& d = drives[drive];
+    d.order = hasExtension(filename, "po") ? gcr::PRODOS_ORDER : gcr::DOS_ORDER;
+    d.writeProtected = !file.writable();
+    for (int t = 0; t < gcr::TRACKS; ++t) {
+        d.tracks[t] = gcr::nibblizeTrack(file.data() + t * gcr::TRACK_SIZE, t, d.order);
+        d.trackDirty[t] = false;
+        d.dirtySectors[t] = 0;
+    }
+    std::lock_guard<std::mutex> lock(fileMutex);
+    d.filename = filename;
+    d.file = std::move(file);
+    // Started with the first writable image, so read-only machines (e.g.
+    // hundreds in a farm) cost no thread.
+    if (!d.writeProtected && !flusher.joinable()) {
+        flusher = std::thread(&Disk2::flusherLoop, this);
+    }
+    return true;
+}
+
+void Disk2::eject(int drive) {
+    flush(drive);
+    Drive& d = drives[drive];
+    std::lock_guard<std::mutex> lock(fileMutex);
+    d.filename.clear();
+    d.file.close();
+    d.bitstream.close();
+    for (std::vector<uint8_t>& track : d.tracks) {
+        track.clear();
+    }
+}
+
+bool Disk2::flush(int drive) {
+    Drive& d = drives[drive];
+    for (int t = 0; t < gcr::TRACKS; ++t) {
+        commitTrack(d, t);
+    }
+    std::lock_guard<std::mutex> lock(fileMutex);
+    syncDirty(d);
+    return true;
+}
+
+// Decodes nibble-level writes on `track` into the mapped image, marking the
+// sectors that changed.
+void Disk2::commitTrack(Drive& d, int track) {
+    if (!d.trackDirty[track]) {
+        return;
+    }
+    d.trackDirty[track] = false;
+    uint8_t* image = d.file.data() + track * gcr::TRACK_SIZE;
+    uint8_t decoded[gcr::TRACK_SIZE];
+    std::copy(image, image + gcr::TRACK_SIZE, decoded);
+    gcr::denibblizeTrack(d.tracks[track], track, d.order, decoded);
+    uint16_t changed = 0;
+    for (int s = 0; s < gcr::SECTORS; ++s) {
+        size_t offset = s * gcr::SECTOR_SIZE;
+        if (!std::equal(decoded + offset, decoded + offset + gcr::SECTOR_SIZE, image + offset)) {
+            std::copy(decoded + offset, decoded + offset + gcr::SECTOR_SIZE, image + offset);
+            changed |= 1 << s;
+        }
+    }
+    d.dirtySectors[track] |= changed;
+}
+
+// Returns the image bytes of a DOS logical sector, first folding any
+// nibble-level writes to that track back into the image.
+uint8_t* Disk2::sectorData(int drive, int track, int sector) {
+    Drive& d = drives[drive];
+    if (!d.file.isOpen() || track < 0 || track >= gcr::TRACKS || sector < 0 || sector >= gcr::SECTORS) {
+        return nullptr;
+    }
+    commitTrack(d, track);
+    int physical = 0;
+    while (gcr::DOS_ORDER[physical] != sector) {
+        physical++;
+    }
+    return d.file.data() + track * gcr::TRACK_SIZE + d.order[physical] * gcr::SECTOR_SIZE;
+}
+
+bool Disk2::readSector(int drive, int track, int sector, uint8_t* data) {
+    const uint8_t* src = sectorData(drive, track, sector);
+    if (!src) {
+        return false;
+    }
+    std::copy(src, src + gcr::SECTOR_SIZE, data);
+    return true;
+}
+
+bool Disk2::writeSector(int drive, int track, int sector, const uint8_t* data) {
+    Drive& d = drives[drive];
+    uint8_t* dst = sectorData(drive, track, sector);
+    if (!dst || d.writeProtected) {
+        return false;
+    }
+    if (speculative) {
+        return true;
+    }
+    std::copy(data, data + gcr::SECTOR_SIZE, dst);
+    uint8_t* image = d.file.data() + track * gcr::TRACK_SIZE;
+    d.tracks[track] = gcr::nibblizeTrack(image, track, d.order);
+    d.dirtySectors[track] |= 1 << ((dst - image) / gcr::SECTOR_SIZE);
+    return true;
+}
+
+// Called on the CPU thread; never waits for a sync in progress.
+void Disk2::requestFlush() {
+    {
+        std::lock_guard<std::mutex> lock(flushMutex);
+        flushRequested = true;
+    }
+    flushWake.notify_one();
+}
+
+void Disk2::flusherLoop() {
+    std::unique_lock<std::mutex> wake(flushMutex);
+    while (!stopping) {
+        flushWake.wait_for(wake, FLUSH_INTERVAL, [this] { return flushRequested || stopping; });
+        flushRequested = false;
+        // Released while syncing, so requestFlush() does not block on msync.
+        wake.unlock();
+        {
+            std::lock_guard<std::mutex> lock(fileMutex);
+            for (Drive& d : drives) {
+                syncDirty(d);
+            }
+        }
+        wake.lock();
+    }
+}
+
+// msyncs the tracks holding dirty sectors. Callers hold fileMutex, so the
+// mapping is not closed under the sync; the dirty bits are atomic and need
+// no lock.
+void Disk2::syncDirty(Drive& d) {
+    if (!d.file.isOpen()) {
+        return;
+    }
+    for (int t = 0; t < gcr::TRACKS; ++t) {
+        if (d.dirtySectors[t].exchange(0)) {
+            d.file.sync(t * gcr::TRACK_SIZE, gcr::TRACK_SIZE);
+        }
+    }
+}
+
+Disk2::State Disk2::saveState() const {
+    State state{};
+    state.spinDownAt = spinDownAt;
+    state.lastClock = lastClock;
+    for (int d = 0; d < DRIVES; ++d) {
+        state.position[d] = static_cast<uint32_t>(drives[d].position);
+        state.bitPosition[d] = drives[d].bitPosition;
+        state.halfTrack[d] = static_cast<int8_t>(drives[d].halfTrack);
+    }
+    state.phases = phases;
+    state.motor = motor;
+    state.selected = static_cast<uint8_t>(selected);
+    state.q6 = q6;
+    state.q7 = q7;
+    state.latch = latch;
+    state.fresh = fresh;
+    state.shifter = shifter;
+    return state;
+}
+
+void Disk2::loadState(const State& state) {
+    spinDownAt = state.spinDownAt;
+    lastClock = state.lastClock;
+    for (int d = 0; d < DRIVES; ++d) {
+        Drive& drive = drives[d];
+        drive.halfTrack = std::clamp<int>(state.halfTrack[d], 0, 79);
+        size_t nibbles = drive.halfTrack / 2 < gcr::TRACKS ? drive.tracks[drive.halfTrack / 2].size() : 0;
+        drive.position = nibbles ? state.position[d] % nibbles : 0;
+        uint32_t bits = drive.bitstream.isOpen() ? drive.bitstream.track(drive.halfTrack * 2).bitCount : 0;
+        drive.bitPosition = bits ? state.bitPosition[d] % bits : 0;
+    }
+    phases = state.phases & 0xF;
+    motor = state.motor;
+    selected = state.selected & 1;
+    q6 = state.q6;
+    q7 = state.q7;
+    latch = state.latch;
+    fresh = state.fresh;
+    shifter = state.shifter;
+}
+
+const std::vector<uint8_t>* Disk2::currentTrack() {
+    Drive& d = drive();
+    int track = d.halfTrack / 2;
+    if (track >= gcr::TRACKS || d.tracks[track].empty()) {
+        return nullptr;
+    }
+    return &d.tracks[track];
+}
+
+// Moves the head half a track toward an energized neighbouring magnet.
+void Disk2::step() {
+    Drive& d = drive();
+    int direction = 0;
+    if (phases & (1 << ((d.halfTrack + 1) & 3))) {
+        direction++;
+    }
+    if (phases & (1 << ((d.halfTrack + 3) & 3))) {
+        direction--;
+    }
+    int previous = d.halfTrack / 2;
+    uint32_t previousBits = d.bitstream.isOpen() ? d.bitstream.track(d.halfTrack * 2).bitCount : 0;
+    d.halfTrack += direction;
+    if (d.halfTrack < 0) {
+        d.halfTrack = 0;
+    } else if (d.halfTrack > 79) {
+        d.halfTrack = 79;
+    }
+    // Tracks differ in length; keep the head at the same angle.
+    if (d.bitstream.isOpen() && previousBits) {
+        uint32_t bits = d.bitstream.track(d.halfTrack * 2).bitCount;
+        d.bitPosition = static_cast<uint32_t>(uint64_t(d.bitPosition) * bits / previousBits);
+    }
+    // Leaving a track is a natural point to persist what was written to it.
+    if (d.halfTrack / 2 != previous && previous < gcr::TRACKS && d.trackDirty[previous]) {
+        commitTrack(d, previous);
+        requestFlush();
+    }
+}
+
+// Advances the selected drive's head by the nibbles that passed since the
+// last access.
+void Disk2::spin() {
+    uint64_t now = clock;
+    if (!spinning()) {
+        lastClock = now;
+        return;
+    }
+    if (drive().bitstream.isOpen()) {
+        uint64_t bits = (now - lastClock) / CYCLES_PER_BIT;
+        lastClock += bits * CYCLES_PER_BIT;
+        spinBits(bits);
+        return;
+    }
+    uint64_t passed = (now - lastClock) / CYCLES_PER_NIBBLE;
+    if (passed == 0) {
+        return;
+    }
+    lastClock += passed * CYCLES_PER_NIBBLE;
+    const std::vector<uint8_t>* track = currentTrack();
+    if (!track) {
+        return;
+    }
+    Drive& d = drive();
+    d.position = (d.position + passed) % track->size();
+    if (!q7) {
+        latch = (*track)[d.position];
+        fresh = true;
+    }
+}
+
+// Shifts `bits` bits from the bitstream under the head into the data
+// register. A nibble is complete once a 1 reaches bit 7; leading zeros are
+// what let the controller find sync after FF40 gaps.
+void Disk2::spinBits(uint64_t bits) {
+    Drive& d = drive();
+    const woz::Track& track = d.bitstream.track(d.halfTrack * 2);
+    if (bits == 0 || track.empty()) {
+        return;
+    }
+    if (d.bitPosition >= track.bitCount) {
+        d.bitPosition %= track.bitCount;
+    }
+    // Only the last revolution can affect the register; skip the rest.
+    if (bits > track.bitCount) {
+        d.bitPosition = static_cast<uint32_t>((d.bitPosition + bits - track.bitCount) % track.bitCount);
+        bits = track.bitCount;
+    }
+    for (uint64_t i = 0; i < bits; ++i) {
+        shifter = static_cast<uint8_t>((shifter << 1) | track.bit(d.bitPosition));
+        if (++d.bitPosition == track.bitCount) {
+            d.bitPosition = 0;
+        }
+        if (shifter & 0x80) {
+            if (!q7) {
+                latch = shifter;
+                fresh = true;
+            }
+            shifter = 0;
+        }
+    }
+}
+
+uint8_t Disk2::io(uint8_t reg, bool write, uint8_t value) {
+    spin();
+
+    switch (reg) {
+    case 0x0: case 0x1: case 0x2: case 0x3:
+    case 0x4: case 0x5: case 0x6: case 0x7: {
+        int phase = reg >> 1;
+        if (reg & 1) {
+            phases |= 1 << phase;
+            if (spinning()) {
+                step();
+            }
+        } else {
+            phases &= ~(1 << phase);
+        }
+        break;
+    }
+    case 0x8:
+        if (motor) {
+            motor = false;
+            spinDownAt = clock + SPIN_DOWN_CYCLES;
+            // So is the end of a disk operation.
+            if (hasDisk(selected) && drive().halfTrack / 2 < gcr::TRACKS) {
+                commitTrack(drive(), drive().halfTrack / 2);
+            }
+            requestFlush();
+        }
+        break;
+    case 0x9:
+        motor = true;
+        break;
+    case 0xA:
+    case 0xB:
+        selected = reg & 1;
+        break;
+    case 0xC:
+    case 0xD:
+        q6 = reg & 1;
+        break;
+    case 0xE:
+    case 0xF:
+        q7 = reg & 1;
+        break;
+    }
+
+    if (q7) {
+        // Write mode: Q6H loads the latch, Q6L shifts it onto the disk.
+        if (write && q6) {
+            latch = value;
+        }
+        if (reg == 0xC && spinning()) {
+            Drive& d = drive();
+            const std::vector<uint8_t>* track = currentTrack();
+            if (track && !d.writeProtected && !speculative) {
+                int t = d.halfTrack / 2;
+                d.tracks[t][d.position] = latch;
+                d.trackDirty[t] = true;
+            }
+        }
+        return 0;
+    }
+    if (write || (reg & 1)) {
+        return 0;
+    }
+    if (q6) {
+        // Q6H + Q7L: sense write protect
+        return drive().writeProtected || !hasDisk(selected) ? 0x80 : 0x00;
+    }
+    if (fresh) {
+        fresh = false;
+        return latch;
+    }
+    return latch & 0x7F;
+}
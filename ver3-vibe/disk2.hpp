@@ -0,0 +1,150 @@
+#pragma once
+
+#include "card.hpp"
+#include "gcr.hpp"
+#include "mapped_file.hpp"
+#include "woz.hpp"
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+// Disk II controller (normally in slot 6) with two 5.25" drives.
+//
+// When an image is inserted every track is nibblized once into a cached
+// 6-and-2 GCR stream, so reading is a walk over that array. The head position
+// is derived from the CPU clock: one nibble passes every 32 cycles while the
+// disk spins. A nibble is returned once with bit 7 set, and with bit 7 clear
+// on further reads until the next one arrives, which is what the read loops
+// (LDA $C08C,X / BPL) rely on.
+//
+// Images are memory-mapped (MAP_SHARED). Nibble writes go to the track cache
+// and are decoded into the mapped image when the head leaves the track or the
+// motor stops; sector writes (RWTS trap) go to the mapping directly. Either
+// way the changed sectors are marked in a per-track bitmap, and a background
+// thread (started with the first writable image) msyncs them at those points
+// and at least every FLUSH_INTERVAL.
+//
+// WOZ 2.0 and .nib images are read-only bitstreams instead: the head position
+// is a bit offset (4 cycles per bit) and nibbles are formed by shifting bits
+// into the data register, so timing- and sync-based copy protection reads as
+// it does on the real drive.
+class Disk2 : public Card {
+public:
+    static constexpr int DRIVES = 2;
+    static constexpr uint64_t CYCLES_PER_NIBBLE = 32;
+    static constexpr uint64_t CYCLES_PER_BIT = 4;
+    static constexpr uint64_t SPIN_DOWN_CYCLES = 1023000; // motor runs ~1 s after $C088
+    static constexpr std::chrono::milliseconds FLUSH_INTERVAL{500};
+
+    explicit Disk2(const uint64_t& clock);
+    ~Disk2() override;
+
+    // Accepts 143,360-byte .dsk/.do (DOS order) or .po (ProDOS order) images,
+    // and .woz/.nib bitstream images (always write-protected).
+    bool insert(int drive, const std::string& filename, bool writeProtected = false);
+    void eject(int drive);
+    // Folds pending nibble writes into the image and msyncs every dirty
+    // sector before returning.
+    bool flush(int drive);
+    // Sectors of `track` written but not yet synced (bit = image sector).
+    uint16_t dirtySectors(int drive, int track) const { return drives[drive].dirtySectors[track]; }
+
+    // Sector access that bypasses the nibble stream (used by the RWTS trap).
+    // `sector` is a DOS 3.3 logical sector number. Both fail on bitstream
+    // images; writeSector also fails on a write-protected disk.
+    bool readSector(int drive, int track, int sector, uint8_t* data);
+    bool writeSector(int drive, int track, int sector, const uint8_t* data);
+    bool writeProtected(int drive) const { return drives[drive].writeProtected; }
+
+    const std::string& filename(int drive) const { return drives[drive].filename; }
+    bool hasDisk(int drive) const { return drives[drive].file.isOpen() || drives[drive].bitstream.isOpen(); }
+    bool isBitstream(int drive) const { return drives[drive].bitstream.isOpen(); }
+    bool spinning() const { return motor || clock < spinDownAt; }
+    int selectedDrive() const { return selected; }
+    int halfTrack(int drive) const { return drives[drive].halfTrack; }
+
+    // Controller registers and head positions, for save states. Disk
+    // contents are not included: flush() and keep the image files instead.
+    struct State {
+        uint64_t spinDownAt;
+        uint64_t lastClock;
+        uint32_t position[DRIVES];
+        uint32_t bitPosition[DRIVES];
+        int8_t halfTrack[DRIVES];
+        uint8_t phases;
+        uint8_t motor;
+        uint8_t selected;
+        uint8_t q6;
+        uint8_t q7;
+        uint8_t latch;
+        uint8_t fresh;
+        uint8_t shifter;
+        uint8_t reserved[6];
+    };
+    static_assert(sizeof(State) == 48, "State is stored as is in save states");
+    State saveState() const;
+    // Disks must already be inserted; head positions are clamped to them.
+    void loadState(const State& state);
+
+    // While set, writes (nibbles and sectors) are accepted but dropped, so
+    // frames run speculatively and then rewound leave the disks alone.
+    bool speculative = false;
+
+    uint8_t io(uint8_t reg, bool write, uint8_t value) override;
+    const uint8_t* rom() const override { return BOOT_ROM; }
+
+    // 16-sector P5 boot PROM
+    static const uint8_t BOOT_ROM[256];
+
+private:
+    struct Drive {
+        std::string filename;
+        const uint8_t* order = gcr::DOS_ORDER;
+        MappedFile file; // the image
+        std::array<std::vector<uint8_t>, gcr::TRACKS> tracks; // nibble cache
+        std::array<bool, gcr::TRACKS> trackDirty{};           // nibble writes not yet in the image
+        std::array<std::atomic<uint16_t>, gcr::TRACKS> dirtySectors{}; // image sectors not yet synced
+        bool writeProtected = false;
+        int halfTrack = 0;
+        size_t position = 0; // nibble under the head
+        woz::Image bitstream;     // .woz/.nib instead of a sector image
+        uint32_t bitPosition = 0; // bit under the head
+    };
+
+    Drive& drive() { return drives[selected]; }
+    const std::vector<uint8_t>* currentTrack();
+    uint8_t* sectorData(int drive, int track, int sector);
+    void commitTrack(Drive& d, int track);
+    void step();
+    void spin();
+    void spinBits(uint64_t bits);
+    void requestFlush();
+    void flusherLoop();
+    void syncDirty(Drive& d);
+
+    const uint64_t& clock;
+    std::array<Drive, DRIVES> drives;
+    uint8_t phases = 0;
+    bool motor = false;
+    uint64_t spinDownAt = 0;
+    uint64_t lastClock = 0;
+    int selected = 0;
+    bool q6 = false;
+    bool q7 = false;
+    uint8_t latch = 0;
+    bool fresh = false; // latch holds a nibble not yet read
+    uint8_t shifter = 0; // bitstream read shift register
+
+    std::mutex fileMutex;  // guards the mappings against the flusher
+    std::mutex flushMutex; // guards flushRequested and stopping
+    std::condition_variable flushWake;
+    bool flushRequested = false;
+    bool stopping = false;
+    std::thread flusher;
+};
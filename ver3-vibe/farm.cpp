@@ -0,0 +1,113 @@
+#include "farm.hpp"
+#include <algorithm>
+#include <atomic>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <time.h>
+
+namespace {
+
+double threadCpuSeconds() {
+    timespec now;
+    clock_gettime(CLOCK_THREAD_CPUTIME_ID, &now);
+    return now.tv_sec + now.tv_nsec * 1e-9;
+}
+
+struct alignas(64) WorkQueue {
+    std::mutex mutex;
+    std::deque<size_t> jobs;
+
+    bool popFront(size_t& job) {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (jobs.empty()) {
+            return false;
+        }
+        job = jobs.front();
+        jobs.pop_front();
+        return true;
+    }
+
+    bool popBack(size_t& job) {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (jobs.empty()) {
+            return false;
+        }
+        job = jobs.back();
+        jobs.pop_back();
+        return true;
+    }
+};
+
+} // namespace
+
+Farm::Farm(std::vector<uint8_t> rom, unsigned threads)
+    : rom(std::move(rom)), workers(threads ? threads : std::max(1u, std::thread::hardware_concurrency())) {}
+
+std::vector<FarmResult> Farm::run(const std::vector<FarmJob>& jobs) {
+    std::vector<FarmResult> results(jobs.size());
+    const unsigned count = static_cast<unsigned>(std::min<size_t>(workers, std::max<size_t>(1, jobs.size())));
+    std::unique_ptr<WorkQueue[]> queues(new WorkQueue[count]);
+    for (size_t i = 0; i < jobs.size(); ++i) {
+        queues[i * count / jobs.size()].jobs.push_back(i);
+    }
+
+    // No job spawns more work, so once every deque is empty the run is over.
+    std::atomic<uint64_t> steals{0};
+    auto work = [&](unsigned self) {
+        size_t job;
+        for (;;) {
+            if (!queues[self].popFront(job)) {
+                bool found = false;
+                for (unsigned k = 1; k < count && !found; ++k) {
+                    found = queues[(self + k) % count].popBack(job);
+                }
+                if (!found) {
+                    return;
+                }
+                steals.fetch_add(1, std::memory_order_relaxed);
+            }
+            results[job] = runJob(jobs[job]);
+        }
+    };
+    std::vector<std::thread> pool;
+    for (unsigned t = 1; t < count; ++t) {
+        pool.emplace_back(work, t);
+    }
+    work(0);
+    for (std::thread& thread : pool) {
+        thread.join();
+    }
+    stolen = steals.load();
+    return results;
+}
+
+bool Farm::useBootCache(const std::string& directory, std::string* error) {
+    auto cache = std::make_unique<BootCache>(rom, directory);
+    if (!cache->prepare(error)) {
+        boot.reset();
+        return false;
+    }
+    boot = std::move(cache);
+    return true;
+}
+
+FarmResult Farm::runJob(const FarmJob& job) const {
+    double start = threadCpuSeconds();
+    FarmResult result;
+    Machine machine(rom, job.rwtsTrap);
+    if (boot) {
+        boot->start(machine, job.disk.empty() ? BootCache::Point::Prompt : BootCache::Point::DiskBoot);
+    }
+    result.booted = job.disk.empty() || machine.insertDisk(0, job.disk);
+    if (result.booted) {
+        machine.type(job.keys);
+        result.exit = machine.run(job.cycles - std::min(job.cycles, machine.cpu.cycles));
+    }
+    result.cycles = machine.cpu.cycles;
+    result.screenHash = machine.screenHash();
+    result.pc = machine.cpu.pc;
+    result.cpuSeconds = threadCpuSeconds() - start;
+    return result;
+}
@@ -0,0 +1,57 @@
+#pragma once
+
+#include "boot_cache.hpp"
+#include "machine.hpp"
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+// One machine run: boot `disk` (if any), type `keys`, stop once the machine
+// has run `cycles` in all (boot included) or when it goes idle or hangs.
+struct FarmJob {
+    std::string disk;
+    std::string keys;
+    uint64_t cycles = 100000000;
+    bool rwtsTrap = true;
+};
+
+struct FarmResult {
+    bool booted = false; // the disk could be inserted
+    Machine::Exit exit = Machine::Exit::Budget;
+    uint64_t cycles = 0;
+    uint64_t screenHash = 0;
+    uint16_t pc = 0;
+    double cpuSeconds = 0; // thread CPU time of this job
+};
+
+// Runs jobs on a pool of threads, each building a fresh Machine per job.
+// Jobs are dealt out in contiguous blocks, one deque per worker; a worker
+// takes from the front of its own deque and, once that is empty, steals
+// from the back of the others', so a few long boots do not leave cores
+// idle at the end.
+class Farm {
+public:
+    explicit Farm(std::vector<uint8_t> rom, unsigned threads = 0); // 0 = all cores
+
+    // Starts every machine from a cached post-reset snapshot (see
+    // BootCache) instead of cold: jobs with a disk at the jump into the boot
+    // PROM, which gives the same run as a cold boot, and jobs without one at
+    // the Applesoft prompt. False, with `error` set, if no snapshot could be
+    // made; jobs then boot cold.
+    bool useBootCache(const std::string& directory, std::string* error = nullptr);
+
+    // Results are in job order.
+    std::vector<FarmResult> run(const std::vector<FarmJob>& jobs);
+
+    unsigned threads() const { return workers; }
+    uint64_t steals() const { return stolen; } // during the last run()
+
+private:
+    FarmResult runJob(const FarmJob& job) const;
+
+    std::vector<uint8_t> rom;
+    std::unique_ptr<BootCache> boot;
+    unsigned workers;
+    uint64_t stolen = 0;
+};
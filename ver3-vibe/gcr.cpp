@@ -0,0 +1,162 @@
+#include "gcr.hpp"
+
+namespace gcr {
+
+const uint8_t DOS_ORDER[SECTORS] = {0, 7, 14, 6, 13, 5, 12, 4, 11, 3, 10, 2, 9, 1, 8, 15};
+const uint8_t PRODOS_ORDER[SECTORS] = {0, 8, 1, 9, 2, 10, 3, 11, 4, 12, 5, 13, 6, 14, 7, 15};
+
+namespace {
+
+constexpr size_t DATA_NIBBLES = 343; // 86 + 256 + checksum
+constexpr int GAP1 = 48;
+constexpr int GAP2 = 6;
+constexpr int GAP3 = 27;
+
+const uint8_t WRITE_TABLE[64] = {
+    0x96, 0x97, 0x9A, 0x9B, 0x9D, 0x9E, 0x9F, 0xA6, 0xA7, 0xAB, 0xAC, 0xAD, 0xAE, 0xAF, 0xB2, 0xB3,
+    0xB4, 0xB5, 0xB6, 0xB7, 0xB9, 0xBA, 0xBB, 0xBC, 0xBD, 0xBE, 0xBF, 0xCB, 0xCD, 0xCE, 0xCF, 0xD3,
+    0xD6, 0xD7, 0xD9, 0xDA, 0xDB, 0xDC, 0xDD, 0xDE, 0xDF, 0xE5, 0xE6, 0xE7, 0xE9, 0xEA, 0xEB, 0xEC,
+    0xED, 0xEE, 0xEF, 0xF2, 0xF3, 0xF4, 0xF5, 0xF6, 0xF7, 0xF9, 0xFA, 0xFB, 0xFC, 0xFD, 0xFE, 0xFF,
+};
+
+struct ReadTable {
+    uint8_t value[256];
+    ReadTable() {
+        for (uint8_t& v : value) {
+            v = 0xFF;
+        }
+        for (uint8_t i = 0; i < 64; ++i) {
+            value[WRITE_TABLE[i]] = i;
+        }
+    }
+};
+const ReadTable READ_TABLE;
+
+void put44(std::vector<uint8_t>& out, uint8_t value) {
+    out.push_back((value >> 1) | 0xAA);
+    out.push_back(value | 0xAA);
+}
+
+uint8_t get44(uint8_t odd, uint8_t even) {
+    return ((odd << 1) | 1) & even;
+}
+
+void putSync(std::vector<uint8_t>& out, int count) {
+    out.insert(out.end(), count, 0xFF);
+}
+
+} // namespace
+
+void encodeSector(const uint8_t* data, uint8_t* nibbles) {
+    // 86 bytes of low-bit pairs (bit order swapped), then the top six bits of
+    // each data byte. Each nibble carries the XOR with its predecessor.
+    uint8_t buffer[DATA_NIBBLES - 1];
+    for (int i = 0; i < 86; ++i) {
+        uint8_t v = 0;
+        for (int part = 0; part < 3; ++part) {
+            int index = i + part * 86;
+            if (index < 256) {
+                uint8_t b = data[index];
+                v |= (((b & 1) << 1) | ((b & 2) >> 1)) << (part * 2);
+            }
+        }
+        buffer[i] = v;
+    }
+    for (int i = 0; i < 256; ++i) {
+        buffer[86 + i] = data[i] >> 2;
+    }
+    uint8_t last = 0;
+    for (size_t i = 0; i < DATA_NIBBLES - 1; ++i) {
+        nibbles[i] = WRITE_TABLE[buffer[i] ^ last];
+        last = buffer[i];
+    }
+    nibbles[DATA_NIBBLES - 1] = WRITE_TABLE[last];
+}
+
+bool decodeSector(const uint8_t* nibbles, uint8_t* data) {
+    uint8_t buffer[DATA_NIBBLES - 1];
+    uint8_t last = 0;
+    for (size_t i = 0; i < DATA_NIBBLES; ++i) {
+        uint8_t v = READ_TABLE.value[nibbles[i]];
+        if (v == 0xFF) {
+            return false;
+        }
+        last ^= v;
+        if (i < DATA_NIBBLES - 1) {
+            buffer[i] = last;
+        }
+    }
+    if (last != 0) {
+        return false;
+    }
+    for (int i = 0; i < 256; ++i) {
+        uint8_t low = buffer[i % 86] >> ((i / 86) * 2);
+        data[i] = (buffer[86 + i] << 2) | ((low & 1) << 1) | ((low & 2) >> 1);
+    }
+    return true;
+}
+
+std::vector<uint8_t> nibblizeTrack(const uint8_t* sectors, uint8_t track, const uint8_t* order, uint8_t volume) {
+    std::vector<uint8_t> out;
+    out.reserve(GAP1 + SECTORS * (14 + GAP2 + 3 + DATA_NIBBLES + 3 + GAP3));
+    putSync(out, GAP1);
+    for (uint8_t sector = 0; sector < SECTORS; ++sector) {
+        out.insert(out.end(), {0xD5, 0xAA, 0x96});
+        put44(out, volume);
+        put44(out, track);
+        put44(out, sector);
+        put44(out, volume ^ track ^ sector);
+        out.insert(out.end(), {0xDE, 0xAA, 0xEB});
+        putSync(out, GAP2);
+
+        out.insert(out.end(), {0xD5, 0xAA, 0xAD});
+        size_t at = out.size();
+        out.resize(at + DATA_NIBBLES);
+        encodeSector(sectors + order[sector] * SECTOR_SIZE, &out[at]);
+        out.insert(out.end(), {0xDE, 0xAA, 0xEB});
+        putSync(out, GAP3);
+    }
+    return out;
+}
+
+uint16_t denibblizeTrack(const std::vector<uint8_t>& nibbles, uint8_t track, const uint8_t* order,
+                         uint8_t* sectors) {
+    size_t n = nibbles.size();
+    if (n == 0) {
+        return 0;
+    }
+    auto at = [&](size_t i) { return nibbles[i % n]; };
+
+    uint16_t found = 0;
+    uint8_t data[DATA_NIBBLES];
+    // The track is circular; scan one revolution plus enough to finish a
+    // sector that straddles the end.
+    for (size_t i = 0; i < n; ++i) {
+        if (at(i) != 0xD5 || at(i + 1) != 0xAA || at(i + 2) != 0x96) {
+            continue;
+        }
+        uint8_t vol = get44(at(i + 3), at(i + 4));
+        uint8_t trk = get44(at(i + 5), at(i + 6));
+        uint8_t sec = get44(at(i + 7), at(i + 8));
+        uint8_t sum = get44(at(i + 9), at(i + 10));
+        if ((vol ^ trk ^ sec) != sum || trk != track || sec >= SECTORS) {
+            continue;
+        }
+        // The data prologue follows within a short gap.
+        for (size_t j = i + 11; j < i + 11 + 64; ++j) {
+            if (at(j) != 0xD5 || at(j + 1) != 0xAA || at(j + 2) != 0xAD) {
+                continue;
+            }
+            for (size_t k = 0; k < DATA_NIBBLES; ++k) {
+                data[k] = at(j + 3 + k);
+            }
+            if (decodeSector(data, sectors + order[sec] * SECTOR_SIZE)) {
+                found |= 1 << sec;
+            }
+            break;
+        }
+    }
+    return found;
+}
+
+} // namespace gcr
@@ -0,0 +1,37 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// 6-and-2 GCR encoding of 16-sector Apple II disks (DOS 3.3 / ProDOS).
+namespace gcr {
+
+constexpr int TRACKS = 35;
+constexpr int SECTORS = 16;
+constexpr size_t SECTOR_SIZE = 256;
+constexpr size_t TRACK_SIZE = SECTORS * SECTOR_SIZE;
+constexpr size_t IMAGE_SIZE = TRACKS * TRACK_SIZE; // 143,360 bytes
+constexpr uint8_t DEFAULT_VOLUME = 254;
+
+// Image sector stored in each physical sector, for .dsk/.do and .po files.
+extern const uint8_t DOS_ORDER[SECTORS];
+extern const uint8_t PRODOS_ORDER[SECTORS];
+
+// Encodes one track of an image (16 sectors in image order) into the nibble
+// stream the drive head sees: sync gaps, address fields and 6-and-2 data.
+std::vector<uint8_t> nibblizeTrack(const uint8_t* sectors, uint8_t track, const uint8_t* order,
+                                   uint8_t volume = DEFAULT_VOLUME);
+
+// Decodes every readable sector of a nibble track back into image order.
+// Returns a bitmask of the physical sectors that were found with valid
+// checksums; sectors not found are left untouched.
+uint16_t denibblizeTrack(const std::vector<uint8_t>& nibbles, uint8_t track, const uint8_t* order,
+                         uint8_t* sectors);
+
+// Encodes a 256-byte sector into its 343 data-field nibbles (with checksum),
+// and decodes them back. decodeSector returns false on a bad nibble or checksum.
+void encodeSector(const uint8_t* data, uint8_t* nibbles);
+bool decodeSector(const uint8_t* nibbles, uint8_t* data);
+
+} // namespace gcr
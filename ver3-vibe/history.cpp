@@ -0,0 +1,179 @@
+#include "history.hpp"
+#include <algorithm>
+#include <utility>
+
+History::History(Machine& machine) : machine(machine) {
+    machine.history = this;
+    record(true);
+}
+
+History::~History() {
+    if (machine.history == this) {
+        machine.history = nullptr;
+    }
+}
+
+void History::record(bool force) {
+    uint64_t now = machine.cpu.cycles;
+    // One per SNAPSHOT_CYCLES multiple, so a call that comes a few cycles
+    // early does not shift the rest.
+    if (!force && !history.empty() && now / SNAPSHOT_CYCLES == history.back().state->cycles / SNAPSHOT_CYCLES) {
+        return;
+    }
+    if (history.empty() || history.back().state->cycles != now) {
+        std::unique_ptr<MachineState> state;
+        if (history.size() >= MAX_SNAPSHOTS) {
+            state = std::move(history.front().state); // reuse the oldest
+            history.pop_front();
+            size_t drop = history.front().firstKey - keyBase;
+            keys.erase(keys.begin(), keys.begin() + drop);
+            keyBase += drop;
+        } else {
+            state = std::make_unique<MachineState>();
+        }
+        history.emplace_back().state = std::move(state);
+    }
+    Snapshot& snapshot = history.back();
+    machine.save(*snapshot.state);
+    snapshot.disk = machine.disk.saveState();
+    snapshot.keys = machine.pendingKeys();
+    snapshot.firstKey = keyBase + keys.size();
+    snapshot.counts = machine.breakpoints.counts();
+    snapshot.stop = machine.breakpoints.hit();
+}
+
+void History::keyPressed(uint8_t key, bool scripted) {
+    keys.push_back({machine.cpu.cycles, key, scripted});
+}
+
+void History::clear() {
+    history.clear();
+    keyBase += keys.size();
+    keys.clear();
+    record(true);
+}
+
+uint64_t History::start() const {
+    return history.front().state->cycles;
+}
+
+size_t History::snapshotBefore(uint64_t cycle) const {
+    size_t index = history.size() - 1;
+    while (index > 0 && history[index].state->cycles >= cycle) {
+        index--;
+    }
+    return index;
+}
+
+void History::replay(size_t index, uint64_t target, std::vector<Stop>* stops, std::vector<uint64_t>* boundaries) {
+    const Snapshot& snapshot = history[index];
+    CPU& cpu = machine.cpu;
+    Breakpoints& breakpoints = machine.breakpoints;
+    breakpoints.cancel();
+    // Hits after the snapshot were counted the first time round.
+    breakpoints.setCounts(searchCounts);
+    breakpoints.setCounts(snapshot.counts);
+    Machine::Speculative speculative(machine, stops != nullptr);
+    machine.load(*snapshot.state);
+    machine.disk.loadState(snapshot.disk);
+    uint64_t from = cpu.cycles;
+    // A snapshot taken at a stop goes on as the debugger did: past the
+    // stop, whose hit is already in the counts.
+    if (snapshot.stop.kind != Breakpoints::Hit::NONE) {
+        breakpoints.resume(cpu);
+        if (stops && from < target) {
+            stops->push_back({from, snapshot.stop, snapshot.counts});
+        }
+    }
+
+    size_t next = snapshot.firstKey - keyBase;
+    while (true) {
+        // Keys were latched between instructions, so replay reaches their
+        // cycles exactly.
+        while (next < keys.size() && keys[next].cycle <= cpu.cycles && keys[next].cycle < target) {
+            machine.memory.keyPress(keys[next++].key);
+        }
+        if (cpu.cycles >= target) {
+            break;
+        }
+        if (boundaries) {
+            boundaries->push_back(cpu.cycles);
+            cpu.execute(1);
+            continue;
+        }
+        uint64_t until = next < keys.size() ? std::min(target, keys[next].cycle) : target;
+        cpu.execute(static_cast<uint32_t>(std::min<uint64_t>(until - cpu.cycles, UINT32_MAX)));
+        if (breakpoints.stopped()) {
+            if (cpu.cycles < target) {
+                stops->push_back({cpu.cycles, breakpoints.hit(), breakpoints.counts()});
+            }
+            breakpoints.resume(cpu);
+        }
+    }
+    replayedCycles += cpu.cycles - from;
+}
+
+void History::moveTo(size_t index, uint64_t target) {
+    std::vector<Stop> passed;
+    replay(index, target, &passed);
+    uint64_t now = machine.cpu.cycles;
+    // Keys latched from the queue since the snapshot are no longer pending.
+    const Snapshot& snapshot = history[index];
+    size_t scripted = 0;
+    for (size_t i = snapshot.firstKey - keyBase; i < keys.size() && keys[i].cycle < now; ++i) {
+        scripted += keys[i].scripted;
+    }
+    machine.setPendingKeys(snapshot.keys.substr(std::min(scripted, snapshot.keys.size())));
+
+    while (history.size() > index + 1 && history.back().state->cycles > now) {
+        history.pop_back();
+    }
+    while (!keys.empty() && keys.back().cycle >= now) {
+        keys.pop_back();
+    }
+    // A snapshot left at `now` may hold keys that were just dropped.
+    record(true);
+}
+
+bool History::stepBack(uint32_t count) {
+    uint64_t now = machine.cpu.cycles;
+    searchCounts = machine.breakpoints.counts();
+    std::vector<uint64_t> boundaries;
+    while (now > start()) {
+        size_t index = snapshotBefore(now);
+        boundaries.clear();
+        replay(index, now, nullptr, &boundaries);
+        if (boundaries.size() >= count) {
+            moveTo(index, boundaries[boundaries.size() - count]);
+            return true;
+        }
+        count -= static_cast<uint32_t>(boundaries.size());
+        now = history[index].state->cycles;
+    }
+    moveTo(0, start());
+    return false;
+}
+
+// Replays the stretches between snapshots, newest first, until one holds a
+// stop; then goes to the last stop in it.
+bool History::continueBack() {
+    uint64_t now = machine.cpu.cycles;
+    searchCounts = machine.breakpoints.counts();
+    std::vector<Stop> stops;
+    while (now > start()) {
+        size_t index = snapshotBefore(now);
+        stops.clear();
+        replay(index, now, &stops);
+        if (!stops.empty()) {
+            const Stop& stop = stops.back();
+            moveTo(index, stop.cycle);
+            // The stopping arrival itself was counted before the stop.
+            machine.breakpoints.setCounts(stop.counts);
+            machine.breakpoints.report(stop.hit);
+            return true;
+        }
+        now = history[index].state->cycles;
+    }
+    moveTo(0, start());
+    return false;
+}
@@ -0,0 +1,98 @@
+#pragma once
+
+#include "machine.hpp"
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <string>
+#include <vector>
+
+// Execution history of a Machine, for stepping backwards: a full snapshot
+// about once a second of emulated time and a log of every key latched,
+// with its cycle. Emulation is deterministic given those, so any earlier
+// instruction boundary is reached by loading the snapshot before it and
+// replaying forward with the logged keys fed back at their cycles.
+//
+// Moving back drops the history after the new position: running on from
+// there is a new future, and keys typed in the old one are not replayed.
+// Disk images are not rewound (as with Machine::checkpoint()); replays
+// leave them alone.
+class History {
+public:
+    static constexpr uint64_t SNAPSHOT_CYCLES = 60 * Machine::SLICE_CYCLES; // 60 video frames
+    static constexpr size_t MAX_SNAPSHOTS = 120; // about two minutes, 8 MB
+
+    // Starts recording from the machine's current state; the machine calls
+    // keyPressed() and record() (from run()) while this is alive.
+    explicit History(Machine& machine);
+    ~History();
+    History(const History&) = delete;
+    History& operator=(const History&) = delete;
+
+    // Takes a snapshot if a multiple of SNAPSHOT_CYCLES has passed since
+    // the last one.
+    // Frontends that call CPU::execute themselves call this between calls.
+    // `force` takes one now, e.g. after the debugger edits memory, so that
+    // no replay runs across the edit.
+    void record(bool force = false);
+    void keyPressed(uint8_t key, bool scripted);
+    // Forgets everything and starts again from the current state (after a
+    // save state is loaded).
+    void clear();
+
+    // The earliest cycle that can be reached.
+    uint64_t start() const;
+    size_t snapshots() const { return history.size(); }
+
+    // Goes back `count` instructions. False if history runs out first; the
+    // machine is then at start().
+    bool stepBack(uint32_t count = 1);
+    // Goes back to the most recent breakpoint or watchpoint stop before the
+    // current cycle and leaves it in Breakpoints::hit(). False, at start(),
+    // if there is none. Conditions and ignore counts apply to the replayed
+    // stops as they did the first time round: each snapshot keeps the rule
+    // counters, and replays start from them. A rule added since a snapshot
+    // replays from the counters it had when the search began.
+    bool continueBack();
+
+    uint64_t replayedCycles = 0; // for measuring
+
+private:
+    struct Snapshot {
+        std::unique_ptr<MachineState> state;
+        Disk2::State disk{};
+        std::string keys;      // typed keys not yet latched
+        uint64_t firstKey = 0; // first log entry after the snapshot
+        std::vector<Breakpoints::Count> counts;
+        Breakpoints::Hit stop; // taken at a stop, e.g. by a debugger edit
+    };
+    struct KeyEvent {
+        uint64_t cycle;
+        uint8_t key;
+        bool scripted; // from Machine::type(), i.e. taken from the key queue
+    };
+    struct Stop {
+        uint64_t cycle;
+        Breakpoints::Hit hit;
+        std::vector<Breakpoints::Count> counts; // after the hit
+    };
+
+    // The last snapshot strictly before `cycle` (or at it, if it is the
+    // first).
+    size_t snapshotBefore(uint64_t cycle) const;
+    // Loads snapshot `index`, with its rule counters, and runs to
+    // instruction boundary `target`. Stops are recorded in `stops` if given;
+    // otherwise breakpoints are off. Each boundary is appended to
+    // `boundaries` if given, stepping one instruction at a time.
+    void replay(size_t index, uint64_t target, std::vector<Stop>* stops = nullptr,
+                std::vector<uint64_t>* boundaries = nullptr);
+    // Replays to `target`, counting hits on the way, and drops what comes
+    // after it.
+    void moveTo(size_t index, uint64_t target);
+
+    Machine& machine;
+    std::deque<Snapshot> history;
+    std::deque<KeyEvent> keys;
+    uint64_t keyBase = 0; // log index of keys.front()
+    std::vector<Breakpoints::Count> searchCounts; // when the search began
+};
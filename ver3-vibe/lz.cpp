@@ -0,0 +1,130 @@
+#include "lz.hpp"
+#include <cstring>
+
+namespace {
+
+constexpr size_t MIN_MATCH = 4;
+constexpr size_t MAX_OFFSET = 0xFFFF;
+constexpr int HASH_BITS = 14;
+constexpr uint32_t NO_MATCH = 0xFFFFFFFF;
+
+uint32_t load32(const uint8_t* p) {
+    uint32_t v;
+    memcpy(&v, p, sizeof(v));
+    return v;
+}
+
+uint32_t hash(uint32_t seq) {
+    return (seq * 2654435761u) >> (32 - HASH_BITS);
+}
+
+void writeLength(std::vector<uint8_t>& out, size_t length) {
+    while (length >= 255) {
+        out.push_back(255);
+        length -= 255;
+    }
+    out.push_back(static_cast<uint8_t>(length));
+}
+
+void emit(std::vector<uint8_t>& out, const uint8_t* literals, size_t literalLength, size_t offset, size_t matchLength) {
+    size_t matchCode = matchLength ? matchLength - MIN_MATCH : 0;
+    uint8_t token = static_cast<uint8_t>((literalLength < 15 ? literalLength : 15) << 4);
+    token |= matchCode < 15 ? matchCode : 15;
+    out.push_back(token);
+    if (literalLength >= 15) {
+        writeLength(out, literalLength - 15);
+    }
+    out.insert(out.end(), literals, literals + literalLength);
+    if (matchLength == 0) {
+        return;
+    }
+    out.push_back(static_cast<uint8_t>(offset));
+    out.push_back(static_cast<uint8_t>(offset >> 8));
+    if (matchCode >= 15) {
+        writeLength(out, matchCode - 15);
+    }
+}
+
+bool readLength(const uint8_t*& src, const uint8_t* end, size_t& length) {
+    uint8_t b;
+    do {
+        if (src == end) {
+            return false;
+        }
+        b = *src++;
+        length += b;
+    } while (b == 255);
+    return true;
+}
+
+} // namespace
+
+std::vector<uint8_t> lzCompress(const uint8_t* src, size_t size) {
+    std::vector<uint8_t> out;
+    out.reserve(size + size / 255 + 16);
+    std::vector<uint32_t> table(size_t(1) << HASH_BITS, NO_MATCH);
+
+    size_t anchor = 0;
+    size_t i = 0;
+    while (i + MIN_MATCH <= size) {
+        uint32_t seq = load32(src + i);
+        uint32_t& slot = table[hash(seq)];
+        size_t candidate = slot;
+        slot = static_cast<uint32_t>(i);
+
+        if (candidate == NO_MATCH || i - candidate > MAX_OFFSET || load32(src + candidate) != seq) {
+            i++;
+            continue;
+        }
+
+        size_t length = MIN_MATCH;
+        while (i + length < size && src[candidate + length] == src[i + length]) {
+            length++;
+        }
+        emit(out, src + anchor, i - anchor, i - candidate, length);
+        i += length;
+        anchor = i;
+    }
+    emit(out, src + anchor, size - anchor, 0, 0);
+    return out;
+}
+
+bool lzDecompress(const uint8_t* src, size_t srcSize, uint8_t* dst, size_t dstSize) {
+    const uint8_t* end = src + srcSize;
+    size_t pos = 0;
+    while (src < end) {
+        uint8_t token = *src++;
+        size_t literalLength = token >> 4;
+        if (literalLength == 15 && !readLength(src, end, literalLength)) {
+            return false;
+        }
+        if (literalLength > size_t(end - src) || literalLength > dstSize - pos) {
+            return false;
+        }
+        memcpy(dst + pos, src, literalLength);
+        src += literalLength;
+        pos += literalLength;
+        if (src == end) {
+            break;
+        }
+
+        if (end - src < 2) {
+            return false;
+        }
+        size_t offset = src[0] | (src[1] << 8);
+        src += 2;
+        size_t matchLength = token & 0x0F;
+        if (matchLength == 15 && !readLength(src, end, matchLength)) {
+            return false;
+        }
+        matchLength += MIN_MATCH;
+        if (offset == 0 || offset > pos || matchLength > dstSize - pos) {
+            return false;
+        }
+        // Byte-wise copy: matches may overlap their own output.
+        for (size_t k = 0; k < matchLength; ++k, ++pos) {
+            dst[pos] = dst[pos - offset];
+        }
+    }
+    return pos == dstSize;
+}
@@ -0,0 +1,13 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// Small LZ77 block compressor (LZ4-style sequences: token, literals, 16-bit
+// offset, match length). No external dependencies; used for trace files and
+// save states where speed matters more than ratio.
+std::vector<uint8_t> lzCompress(const uint8_t* src, size_t size);
+
+// Decompresses exactly `dstSize` bytes. Returns false on malformed input.
+bool lzDecompress(const uint8_t* src, size_t srcSize, uint8_t* dst, size_t dstSize);
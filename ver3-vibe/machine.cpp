@@ -0,0 +1,342 @@
+#include "machine.hpp"
+#include "history.hpp"
+#include "savestate.hpp"
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include <utility>
+
+static_assert(sizeof(MachineState::memory) == Memory::ADDRESS_SPACE_SIZE);
+
+namespace {
+
+// Monitor KEYIN polling loop ($FD1B-$FD25): INC RNDL / BNE / INC RNDH /
+// BIT KBD / BPL KEYIN.
+constexpr uint16_t KEYIN_START = 0xFD1B;
+constexpr uint16_t KEYIN_END = 0xFD25;
+
+// Save-state chunks and their layout versions
+constexpr char CPU_CHUNK[4] = {'C', 'P', 'U', ' '};
+constexpr char MEMORY_CHUNK[4] = {'M', 'E', 'M', ' '};
+constexpr char DISK2_CHUNK[4] = {'D', 'S', 'K', '2'};
+constexpr char DRIVE_CHUNKS[Disk2::DRIVES][4] = {{'D', 'R', 'V', '1'}, {'D', 'R', 'V', '2'}};
+constexpr char KEYS_CHUNK[4] = {'K', 'E', 'Y', 'S'};
+constexpr uint16_t CHUNK_VERSION = 1;
+
+struct CpuChunk {
+    uint8_t a, x, y, ps, sp, reserved;
+    uint16_t pc;
+    uint64_t cycles;
+};
+static_assert(sizeof(CpuChunk) == 16);
+
+uint16_t textAddress(int row, int column) {
+    return 0x0400 + (row % 8) * 0x80 + (row / 8) * 40 + column;
+}
+
+} // namespace
+
+Machine::Machine(const std::vector<uint8_t>& rom, bool rwtsTrap)
+    : cpu(memory), disk(cpu.cycles), rwts(memory, disk), breakpoints(memory) {
+    std::copy_n(rom.begin(), std::min(rom.size(), ROM_SIZE), memory.data.begin() + ROM_START);
+    memory.romWriteProtect = true;
+    memory.insertCard(6, &disk);
+    if (rwtsTrap) {
+        cpu.rwts = &rwts;
+    }
+    cpu.breakpoints = &breakpoints;
+    cpu.reset();
+}
+
+bool Machine::insertDisk(int drive, const std::string& filename, bool writeProtected) {
+    return disk.insert(drive, filename, writeProtected);
+}
+
+void Machine::type(const std::string& text) {
+    keys.erase(0, nextKey);
+    nextKey = 0;
+    keys += text;
+}
+
+void Machine::keyPress(uint8_t key) {
+    latch(key, false);
+}
+
+void Machine::setPendingKeys(const std::string& pending) {
+    keys = pending;
+    nextKey = 0;
+}
+
+Machine::Exit Machine::run(uint64_t cycles) {
+    const uint64_t end = cpu.cycles + cycles;
+    while (cpu.cycles < end) {
+        if (history) {
+            history->record();
+        }
+        feedKey();
+        // Slices end on multiples of SLICE_CYCLES, so where keys are fed and
+        // checks made depends only on the cycle count, not on where this
+        // run() started (e.g. from a snapshot).
+        uint64_t sliceEnd = std::min(end, (cpu.cycles / SLICE_CYCLES + 1) * SLICE_CYCLES);
+        cpu.execute(static_cast<uint32_t>(sliceEnd - cpu.cycles));
+        if (breakpoints.stopped()) {
+            return Exit::Break;
+        }
+        if (hung()) {
+            return Exit::Hung;
+        }
+        if (idle()) {
+            return Exit::Idle;
+        }
+    }
+    return Exit::Budget;
+}
+
+void Machine::save(MachineState& state) const {
+    state.magic = MachineState::MAGIC;
+    state.version = MachineState::VERSION;
+    state.size = sizeof(MachineState);
+    state.a = cpu.a;
+    state.x = cpu.x;
+    state.y = cpu.y;
+    state.ps = cpu.ps;
+    state.sp = cpu.sp;
+    state.pc = cpu.pc;
+    state.cycles = cpu.cycles;
+    memcpy(state.memory.data(), memory.data.data(), Memory::ADDRESS_SPACE_SIZE);
+}
+
+void Machine::load(const MachineState& state) {
+    loadRegisters(state);
+    memcpy(memory.data.data(), state.memory.data(), Memory::ADDRESS_SPACE_SIZE);
+    memory.contentsChanged();
+    tracked = false;
+}
+
+void Machine::checkpoint() {
+    if (!saved) {
+        saved = std::make_unique<MachineState>();
+    }
+    save(*saved);
+    memory.clearDirty();
+    tracked = true;
+    savedDisk = disk.saveState();
+    savedKeys.assign(keys, nextKey);
+}
+
+void Machine::rewind() {
+    if (!saved) {
+        return;
+    }
+    if (tracked) {
+        memory.restoreDirtyPages(saved->memory.data());
+        loadRegisters(*saved);
+    } else {
+        load(*saved);
+        memory.clearDirty();
+        tracked = true;
+    }
+    disk.loadState(savedDisk);
+    keys = savedKeys;
+    nextKey = 0;
+}
+
+void Machine::runAhead(int frames, const std::function<void()>& show) {
+    checkpoint();
+    {
+        Speculative speculative(*this);
+        for (int i = 0; i < frames; ++i) {
+            feedKey();
+            cpu.execute(SLICE_CYCLES);
+        }
+        show();
+    }
+    rewind();
+}
+
+Machine::Speculative::Speculative(Machine& machine, bool stops)
+    : machine(machine),
+      speaker(std::exchange(machine.memory.speaker, nullptr)),
+      trace(std::exchange(machine.cpu.trace, nullptr)),
+      breakpoints(std::exchange(machine.cpu.breakpoints, stops ? machine.cpu.breakpoints : nullptr)),
+      watcher(std::exchange(machine.memory.watcher, stops ? machine.memory.watcher : nullptr)),
+      history(std::exchange(machine.history, nullptr)) {
+    machine.disk.speculative = true;
+}
+
+Machine::Speculative::~Speculative() {
+    machine.disk.speculative = false;
+    machine.memory.speaker = speaker;
+    machine.cpu.trace = trace;
+    machine.cpu.breakpoints = breakpoints;
+    machine.memory.watcher = watcher;
+    machine.history = history;
+}
+
+void Machine::loadRegisters(const MachineState& state) {
+    cpu.a = state.a;
+    cpu.x = state.x;
+    cpu.y = state.y;
+    cpu.ps = state.ps;
+    cpu.sp = state.sp;
+    cpu.pc = state.pc;
+    cpu.cycles = state.cycles;
+}
+
+bool Machine::saveState(const std::string& filename, bool compress) {
+    savestate::Writer writer;
+    CpuChunk registers{cpu.a, cpu.x, cpu.y, cpu.ps, cpu.sp, 0, cpu.pc, cpu.cycles};
+    writer.add(CPU_CHUNK, CHUNK_VERSION, &registers, sizeof(registers));
+    writer.add(MEMORY_CHUNK, CHUNK_VERSION, memory.data.data(), Memory::ADDRESS_SPACE_SIZE, compress);
+    Disk2::State controller = disk.saveState();
+    writer.add(DISK2_CHUNK, CHUNK_VERSION, &controller, sizeof(controller));
+    for (int drive = 0; drive < Disk2::DRIVES; ++drive) {
+        if (disk.hasDisk(drive)) {
+            disk.flush(drive);
+            std::string entry = char(disk.writeProtected(drive)) + disk.filename(drive);
+            writer.add(DRIVE_CHUNKS[drive], CHUNK_VERSION, entry.data(), entry.size());
+        }
+    }
+    std::string pending = keys.substr(nextKey);
+    writer.add(KEYS_CHUNK, CHUNK_VERSION, pending.data(), pending.size());
+    return writer.write(filename);
+}
+
+bool Machine::loadState(const std::string& filename, std::string* error) {
+    auto fail = [&](const std::string& message) {
+        if (error) {
+            *error = message;
+        }
+        return false;
+    };
+    savestate::Reader reader;
+    std::string readError;
+    if (!reader.open(filename, &readError)) {
+        return fail(readError);
+    }
+
+    // Read everything before changing anything.
+    CpuChunk registers;
+    Disk2::State controller;
+    std::vector<uint8_t> image(Memory::ADDRESS_SPACE_SIZE);
+    std::string pending(reader.size(KEYS_CHUNK), '\0');
+    if (!reader.read(CPU_CHUNK, CHUNK_VERSION, &registers, sizeof(registers)) ||
+        !reader.read(MEMORY_CHUNK, CHUNK_VERSION, image.data(), image.size()) ||
+        !reader.read(DISK2_CHUNK, CHUNK_VERSION, &controller, sizeof(controller)) ||
+        !reader.read(KEYS_CHUNK, CHUNK_VERSION, pending.data(), pending.size())) {
+        return fail("missing or corrupt chunk");
+    }
+    std::string drives[Disk2::DRIVES];
+    for (int drive = 0; drive < Disk2::DRIVES; ++drive) {
+        drives[drive].resize(reader.size(DRIVE_CHUNKS[drive]));
+        if (!drives[drive].empty() &&
+            !reader.read(DRIVE_CHUNKS[drive], CHUNK_VERSION, drives[drive].data(), drives[drive].size())) {
+            return fail("missing or corrupt chunk");
+        }
+    }
+
+    for (int drive = 0; drive < Disk2::DRIVES; ++drive) {
+        if (drives[drive].size() < 2) {
+            disk.eject(drive);
+            continue;
+        }
+        bool writeProtected = drives[drive][0] != 0;
+        std::string name = drives[drive].substr(1);
+        if ((!disk.hasDisk(drive) || disk.filename(drive) != name || disk.writeProtected(drive) != writeProtected) &&
+            !disk.insert(drive, name, writeProtected)) {
+            return fail("cannot insert " + name);
+        }
+    }
+    disk.loadState(controller);
+
+    memcpy(memory.data.data(), image.data(), image.size());
+    memory.contentsChanged();
+    cpu.a = registers.a;
+    cpu.x = registers.x;
+    cpu.y = registers.y;
+    cpu.ps = registers.ps;
+    cpu.sp = registers.sp;
+    cpu.pc = registers.pc;
+    cpu.cycles = registers.cycles;
+    keys = pending;
+    nextKey = 0;
+    tracked = false;
+    if (history) {
+        history->clear();
+    }
+    return true;
+}
+
+bool Machine::waitingForKey() const {
+    return !(memory.data[0xC000] & 0x80) && cpu.pc >= KEYIN_START && cpu.pc <= KEYIN_END;
+}
+
+void Machine::feedKey() {
+    if (nextKey < keys.size() && waitingForKey()) {
+        char key = keys[nextKey++];
+        latch(key == '\n' ? 0x0D : static_cast<uint8_t>(key), true);
+    }
+}
+
+void Machine::latch(uint8_t key, bool scripted) {
+    memory.keyPress(key);
+    if (history) {
+        history->keyPressed(key, scripted);
+    }
+}
+
+bool Machine::idle() const {
+    return nextKey == keys.size() && waitingForKey();
+}
+
+bool Machine::hung() const {
+    const auto& data = memory.data;
+    return data[cpu.pc] == 0x4C && data[uint16_t(cpu.pc + 1)] == (cpu.pc & 0xFF) &&
+           data[uint16_t(cpu.pc + 2)] == (cpu.pc >> 8);
+}
+
+uint64_t Machine::screenHash() const {
+    uint64_t hash = 0xCBF29CE484222325ULL;
+    for (int row = 0; row < 24; ++row) {
+        for (int column = 0; column < 40; ++column) {
+            hash = (hash ^ memory.data[textAddress(row, column)]) * 0x100000001B3ULL;
+        }
+    }
+    return hash;
+}
+
+std::string Machine::screenText() const {
+    std::string text;
+    for (int row = 0; row < 24; ++row) {
+        for (int column = 0; column < 40; ++column) {
+            uint8_t c = memory.data[textAddress(row, column)] & 0x7F;
+            text += c < 0x20 ? char(c + 0x40) : c == 0x7F ? ' ' : char(c); // inverse/flash as normal
+        }
+        text += '\n';
+    }
+    return text;
+}
+
+bool Machine::loadRom(const std::string& filename, std::vector<uint8_t>& rom) {
+    std::ifstream file(filename, std::ios::binary);
+    if (!file) {
+        return false;
+    }
+    rom.assign(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+    return !rom.empty();
+}
+
+const char* Machine::exitName(Exit exit) {
+    switch (exit) {
+    case Exit::Budget:
+        return "budget";
+    case Exit::Idle:
+        return "idle";
+    case Exit::Hung:
+        return "hung";
+    case Exit::Break:
+        return "break";
+    }
+    return "?";
+}
@@ -0,0 +1,136 @@
+#pragma once
+
+#include "breakpoints.hpp"
+#include "cpu.hpp"
+#include "disk2.hpp"
+#include "machine_state.hpp"
+#include "memory.hpp"
+#include "rwts.hpp"
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <string>
+#include <vector>
+
+class History;
+
+// A complete Apple II+ -- memory, CPU, and a Disk II in slot 6 -- with no
+// state shared with any other instance, so machines can run side by side on
+// different threads. Nothing is drawn or played; the text screen is read
+// back through screenHash() and screenText().
+class Machine {
+public:
+    static constexpr uint16_t ROM_START = 0xD000;
+    static constexpr size_t ROM_SIZE = 0x3000;
+    static constexpr uint32_t SLICE_CYCLES = 17030; // one video frame
+
+    enum class Exit {
+        Budget, // ran the whole cycle budget
+        Idle,   // every scripted key was read and the ROM is waiting for another
+        Hung,   // jumped to itself
+        Break,  // stopped by a breakpoint or watchpoint (see breakpoints.hit())
+    };
+
+    // `rom` is the 12K image for $D000-$FFFF; it is copied, so one loaded
+    // ROM can seed any number of machines.
+    explicit Machine(const std::vector<uint8_t>& rom, bool rwtsTrap = true);
+    Machine(const Machine&) = delete;
+    Machine& operator=(const Machine&) = delete;
+
+    bool insertDisk(int drive, const std::string& filename, bool writeProtected = true);
+
+    // Queues keys ('\n' is Return) for prompt-driven programs: each one is
+    // latched when the previous one has been read and the ROM is back in its
+    // KEYIN loop, so a whole script can be typed ahead of time.
+    void type(const std::string& keys);
+    // Latches a key typed now. Frontends use this rather than
+    // Memory::keyPress(), so that the key reaches the history.
+    void keyPress(uint8_t key);
+    // The typed keys not yet latched. setPendingKeys() replaces them
+    // (History, when it moves back).
+    std::string pendingKeys() const { return keys.substr(nextKey); }
+    void setPendingKeys(const std::string& pending);
+
+    // Runs until `cycles` more cycles have elapsed or the machine goes idle
+    // or hangs; conditions are checked once per slice. Breakpoints stop it
+    // at once.
+    Exit run(uint64_t cycles);
+
+    // CPU and memory state (see machine_state.hpp). save() and load() copy
+    // all of it, so load() of another machine's state clones it. The disk
+    // controller keeps its own state and is not included.
+    void save(MachineState& state) const;
+    void load(const MachineState& state);
+
+    // Cheap reset to a fixed point: checkpoint() saves the state (disk
+    // controller and typed keys included), and each rewind() returns to it
+    // copying back only the memory pages written since, usually a handful
+    // per frame.
+    void checkpoint();
+    void rewind();
+
+    // Run-ahead: runs `frames` video frames beyond the current one with the
+    // speaker and trace detached and disk writes dropped, calls `show`
+    // there (e.g. to copy out the screen), then rewinds. Breakpoints and
+    // the history are ignored. Replaces the checkpoint.
+    void runAhead(int frames, const std::function<void()>& show);
+
+    // While alive, detaches what reaches outside the machine -- speaker,
+    // trace, history and, unless `stops`, breakpoints and watchpoints -- and
+    // drops disk writes. Run-ahead frames and History replays run under one.
+    class Speculative {
+    public:
+        explicit Speculative(Machine& machine, bool stops = false);
+        ~Speculative();
+        Speculative(const Speculative&) = delete;
+        Speculative& operator=(const Speculative&) = delete;
+
+    private:
+        Machine& machine;
+        Speaker* speaker;
+        TraceWriter* trace;
+        Breakpoints* breakpoints;
+        AccessWatcher* watcher;
+        History* history;
+    };
+
+    // Save-state files (see savestate.hpp) holding the CPU, memory (the
+    // keyboard and other soft switches live in the $C0 page), disk
+    // controller and the typed-key queue. Disk images are flushed and
+    // referenced by name, not copied. `compress` LZ-packs the memory.
+    bool saveState(const std::string& filename, bool compress = true);
+    // Re-inserts the disks the state names. Returns false, with `error` set
+    // if given, for an unusable file or a disk that cannot be inserted.
+    // The history, if any, starts again from the loaded state.
+    bool loadState(const std::string& filename, std::string* error = nullptr);
+
+    // FNV-1a of the 40x24 visible text screen (screen holes excluded).
+    uint64_t screenHash() const;
+    std::string screenText() const;
+
+    static bool loadRom(const std::string& filename, std::vector<uint8_t>& rom);
+    static const char* exitName(Exit exit);
+
+    Memory memory;
+    CPU cpu;
+    Disk2 disk;
+    RwtsTrap rwts;
+    Breakpoints breakpoints; // wired to cpu and memory; none set at first
+    History* history = nullptr; // set by a History recording this machine
+
+private:
+    void loadRegisters(const MachineState& state);
+    bool waitingForKey() const;
+    void feedKey();
+    void latch(uint8_t key, bool scripted);
+    bool idle() const;
+    bool hung() const;
+
+    std::string keys;
+    size_t nextKey = 0;
+
+    std::unique_ptr<MachineState> saved; // checkpoint()
+    Disk2::State savedDisk{};
+    std::string savedKeys;
+    bool tracked = false; // dirty pages are relative to `saved`
+};
@@ -0,0 +1,40 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <type_traits>
+
+// Everything a Machine needs to resume -- CPU registers and the whole 64K
+// address space, soft-switch and keyboard bytes included -- in one flat,
+// trivially-copyable block, so copying a state is a single memcpy and a
+// state can be written to or mapped from a file as is.
+//
+// The header makes a stale or foreign block detectable: bump VERSION
+// whenever a field is added, removed or reordered.
+struct alignas(64) MachineState {
+    static constexpr uint32_t MAGIC = 0x53324141; // "AA2S"
+    static constexpr uint16_t VERSION = 1;
+
+    uint32_t magic = MAGIC;
+    uint16_t version = VERSION;
+    uint16_t reserved = 0;
+    uint32_t size = sizeof(MachineState);
+
+    // CPU
+    uint8_t a = 0;
+    uint8_t x = 0;
+    uint8_t y = 0;
+    uint8_t ps = 0x20;
+    uint8_t sp = 0xFF;
+    uint16_t pc = 0;
+    uint64_t cycles = 0;
+
+    alignas(64) std::array<uint8_t, 0x10000> memory{};
+
+    bool valid() const { return magic == MAGIC && version == VERSION && size == sizeof(MachineState); }
+};
+
+static_assert(std::is_trivially_copyable_v<MachineState>, "MachineState must copy with memcpy");
+static_assert(std::is_standard_layout_v<MachineState>, "MachineState must have a fixed layout");
+static_assert(offsetof(MachineState, memory) == 64, "registers must fit in the first cache line");
@@ -1,32 +1,75 @@
 #include <SDL.h>
 #include <SDL_ttf.h>
+#include <algorithm>
+#include <array>
+#include <atomic>
 #include <iostream>
 #include <cctype>
-#include "memory.hpp"
-#include "cpu.hpp"
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+#ifdef __linux__
+#include <pthread.h>
+#include <sched.h>
+#endif
+#include "debugger.hpp"
+#include "machine.hpp"
+#include "pacer.hpp"
+#include "speaker.hpp"
+#include "spsc_queue.hpp"
+#include "triple_buffer.hpp"
 
 // Screen dimensions
 const int SCREEN_WIDTH = 560; // Apple II text screen is 40 characters * 14 pixels, let's use a larger window
 const int SCREEN_HEIGHT = 384; // 24 lines * 16 pixels
 const int FONT_SIZE = 16;
 
-// CPU speed and target frame rate
-const uint32_t CPU_CLOCK_HZ = 1023000; // Apple II 6502 clock speed
-const uint32_t TARGET_FPS = 60;
-const uint32_t CYCLES_PER_FRAME = CPU_CLOCK_HZ / TARGET_FPS;
 
-void renderScreen(SDL_Renderer* renderer, TTF_Font* font, Memory& mem, SDL_Color& textColor) {
+// What the emulation thread hands to the display thread for each shown frame.
+struct Frame {
+    std::array<uint8_t, 0x400> text{}; // $0400-$07FF
+    char hud[64] = "";
+    char title[128] = "";
+};
+
+// Input from the display thread, stamped with SDL_GetPerformanceCounter().
+struct InputEvent {
+    enum Type : uint8_t { KEY, TOGGLE_TURBO, SAVE_STATE, DEBUG };
+    Type type = KEY;
+    uint8_t key = 0;
+    uint64_t timestamp = 0;
+};
+
+// Keeps the emulation thread on one core so its caches stay warm (Linux only).
+void pinToCore(std::thread& thread, unsigned core) {
+#ifdef __linux__
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    CPU_SET(core, &set);
+    pthread_setaffinity_np(thread.native_handle(), sizeof(set), &set);
+#else
+    (void)thread;
+    (void)core;
+#endif
+}
+
+void renderScreen(SDL_Renderer* renderer, TTF_Font* font, const uint8_t* text, SDL_Color& textColor,
+                  const char* hud = nullptr) {
     SDL_SetRenderDrawColor(renderer, 0, 0, 0, 255);
     SDL_RenderClear(renderer);
 
     for (int y = 0; y < 24; ++y) {
         for (int x = 0; x < 40; ++x) {
-            uint16_t mem_addr = 0x0400 + y * 40 + x;
-            uint8_t char_code = mem.read(mem_addr) & 0x7F; // Mask out high bit for ASCII
-            
+            uint8_t char_code = text[y * 40 + x] & 0x7F; // Mask out high bit for ASCII
+
             if (char_code != 0) {
-                char text[2] = { (char)char_code, '\0' };
-                SDL_Surface* textSurface = TTF_RenderText_Solid(font, text, textColor);
+                char glyph[2] = { (char)char_code, '\0' };
+                SDL_Surface* textSurface = TTF_RenderText_Solid(font, glyph, textColor);
                 if (textSurface != nullptr) {
                     SDL_Texture* textTexture = SDL_CreateTextureFromSurface(renderer, textSurface);
                     if (textTexture != nullptr) {
@@ -40,10 +83,86 @@ void renderScreen(SDL_Renderer* renderer, TTF_Font* font, Memory& mem, SDL_Color
         }
     }
 
+    // Status overlay in the top-right corner
+    if (hud) {
+        SDL_Surface* hudSurface = TTF_RenderText_Solid(font, hud, textColor);
+        if (hudSurface != nullptr) {
+            SDL_Texture* hudTexture = SDL_CreateTextureFromSurface(renderer, hudSurface);
+            if (hudTexture != nullptr) {
+                SDL_Rect box = {SCREEN_WIDTH - hudSurface->w - 8, 0, hudSurface->w + 8, hudSurface->h + 4};
+                SDL_SetRenderDrawColor(renderer, 0, 0, 128, 255);
+                SDL_RenderFillRect(renderer, &box);
+                SDL_Rect quad = {box.x + 4, 2, hudSurface->w, hudSurface->h};
+                SDL_RenderCopy(renderer, hudTexture, NULL, &quad);
+                SDL_DestroyTexture(hudTexture);
+            }
+            SDL_FreeSurface(hudSurface);
+        }
+    }
+
     SDL_RenderPresent(renderer);
 }
 
+// SDL audio thread: pulls band-limited samples from the speaker's toggle log.
+void audioCallback(void* userdata, Uint8* stream, int len) {
+    static_cast<Speaker*>(userdata)->render(reinterpret_cast<int16_t*>(stream), len / sizeof(int16_t));
+}
+
 int main(int argc, char* args[]) {
+    std::string profilePath;
+    std::string callGraphPath;
+    std::string labelsPath;
+    std::string tracePath;
+    std::string diskPaths[Disk2::DRIVES];
+    std::string wavPath;
+    std::string statePath; // restored at startup if it exists; F5 saves
+    std::string syncName; // timer, audio or vsync; default audio when a device opens
+    bool diskWarp = true;
+    bool rwtsTrap = false;
+    bool turbo = false; // unthrottled with frameskip; F9 toggles
+    bool debug = false; // start in the debugger console; F12 breaks in
+    int runAhead = 0;   // frames shown ahead of the emulated present
+    for (int i = 1; i < argc; ++i) {
+        if (strcmp(args[i], "--profile") == 0 && i + 1 < argc) {
+            profilePath = args[++i];
+        } else if (strcmp(args[i], "--callgraph") == 0 && i + 1 < argc) {
+            callGraphPath = args[++i];
+        } else if (strcmp(args[i], "--labels") == 0 && i + 1 < argc) {
+            labelsPath = args[++i];
+        } else if (strcmp(args[i], "--trace") == 0 && i + 1 < argc) {
+            tracePath = args[++i];
+        } else if (strcmp(args[i], "--disk1") == 0 && i + 1 < argc) {
+            diskPaths[0] = args[++i];
+        } else if (strcmp(args[i], "--disk2") == 0 && i + 1 < argc) {
+            diskPaths[1] = args[++i];
+        } else if (strcmp(args[i], "--no-disk-warp") == 0) {
+            diskWarp = false;
+        } else if (strcmp(args[i], "--rwts-trap") == 0) {
+            rwtsTrap = true;
+        } else if (strcmp(args[i], "--state") == 0 && i + 1 < argc) {
+            statePath = args[++i];
+        } else if (strcmp(args[i], "--run-ahead") == 0 && i + 1 < argc) {
+            runAhead = std::clamp(atoi(args[++i]), 0, 4);
+        } else if (strcmp(args[i], "--warp") == 0) {
+            turbo = true;
+        } else if (strcmp(args[i], "--debug") == 0) {
+            debug = true;
+        } else if (strcmp(args[i], "--wav") == 0 && i + 1 < argc) {
+            wavPath = args[++i];
+        } else if (strcmp(args[i], "--sync") == 0 && i + 1 < argc &&
+                   (strcmp(args[i + 1], "timer") == 0 || strcmp(args[i + 1], "audio") == 0 ||
+                    strcmp(args[i + 1], "vsync") == 0)) {
+            syncName = args[++i];
+        } else {
+            std::cerr << "Usage: " << args[0]
+                      << " [--profile out.txt|out.csv] [--callgraph out.folded [--labels file.sym]] [--trace out.trace]"
+                      << " [--disk1 image] [--disk2 image] [--no-disk-warp] [--rwts-trap] [--state file] [--run-ahead 0-4] [--warp]"
+                      << " [--debug] [--wav out.wav]"
+                      << " [--sync timer|audio|vsync]" << std::endl;
+            return 1;
+        }
+    }
+
     if (SDL_Init(SDL_INIT_VIDEO) < 0) {
         std::cerr << "SDL could not initialize! SDL_Error: " << SDL_GetError() << std::endl;
         return 1;
@@ -63,7 +182,11 @@ int main(int argc, char* args[]) {
         return 1;
     }
 
-    SDL_Renderer* renderer = SDL_CreateRenderer(window, -1, SDL_RENDERER_ACCELERATED);
+    Uint32 rendererFlags = SDL_RENDERER_ACCELERATED;
+    if (syncName == "vsync") {
+        rendererFlags |= SDL_RENDERER_PRESENTVSYNC;
+    }
+    SDL_Renderer* renderer = SDL_CreateRenderer(window, -1, rendererFlags);
     if (renderer == nullptr) {
         std::cerr << "Renderer could not be created! SDL Error: " << SDL_GetError() << std::endl;
         SDL_DestroyWindow(window);
@@ -82,8 +205,9 @@ int main(int argc, char* args[]) {
         return 1;
     }
 
-    Memory mem;
-    if (!mem.loadROM("Apple2_Plus.rom", 0xD000)) {
+    std::vector<uint8_t> rom;
+    if (!Machine::loadRom("Apple2_Plus.rom", rom)) {
+        std::cerr << "Error: Could not open ROM file: Apple2_Plus.rom" << std::endl;
         TTF_CloseFont(font);
         SDL_DestroyRenderer(renderer);
         SDL_DestroyWindow(window);
@@ -91,36 +215,302 @@ int main(int argc, char* args[]) {
         SDL_Quit();
         return 1;
     }
+    Machine machine(rom, rwtsTrap);
+    Memory& mem = machine.memory;
+    CPU& cpu = machine.cpu;
+    Disk2& disk2 = machine.disk;
+    for (int drive = 0; drive < Disk2::DRIVES; ++drive) {
+        if (!diskPaths[drive].empty()) {
+            machine.insertDisk(drive, diskPaths[drive], false);
+        }
+    }
+    // Before the speaker is created, so it starts from the restored clock.
+    if (!statePath.empty() && std::ifstream(statePath)) {
+        std::string error;
+        if (!machine.loadState(statePath, &error)) {
+            std::cerr << "Warning: could not restore " << statePath << ": " << error << std::endl;
+        }
+    }
 
-    CPU cpu(mem);
+    // Sound goes to the audio device, or to a WAV file instead when --wav is given.
+    Speaker speaker(cpu.cycles, Speaker::DEFAULT_SAMPLE_RATE, FramePacer::CPU_CLOCK_HZ);
+    mem.speaker = &speaker;
+    WavWriter wav;
+    std::vector<int16_t> wavSamples;
+    SDL_AudioDeviceID audio = 0;
+    if (!wavPath.empty()) {
+        if (!wav.open(wavPath, speaker.sampleRate())) {
+            std::cerr << "Error: Could not create " << wavPath << std::endl;
+        }
+    } else if (SDL_InitSubSystem(SDL_INIT_AUDIO) == 0) {
+        SDL_AudioSpec want = {};
+        want.freq = speaker.sampleRate();
+        want.format = AUDIO_S16SYS;
+        want.channels = 1;
+        want.samples = 512;
+        want.callback = audioCallback;
+        want.userdata = &speaker;
+        audio = SDL_OpenAudioDevice(nullptr, 0, &want, nullptr, 0);
+        if (audio == 0) {
+            std::cerr << "Warning: no audio device: " << SDL_GetError() << std::endl;
+        } else {
+            SDL_PauseAudioDevice(audio, 0);
+        }
+    } else {
+        std::cerr << "Warning: SDL audio unavailable: " << SDL_GetError() << std::endl;
+    }
+
+    TraceWriter trace;
+    if (!tracePath.empty() && trace.open(tracePath)) {
+        cpu.trace = &trace;
+    }
+
+#ifdef CPU_PROFILER
+    auto profiler = std::make_unique<Profiler>();
+    if (!profilePath.empty()) {
+        cpu.profiler = profiler.get();
+    }
+    CallGraph callGraph;
+    if (!callGraphPath.empty()) {
+        if (!labelsPath.empty()) {
+            callGraph.loadLabels(labelsPath);
+        }
+        cpu.callGraph = &callGraph;
+    }
+#else
+    if (!profilePath.empty() || !callGraphPath.empty()) {
+        std::cerr << "Warning: profiling options ignored; rebuild with -DENABLE_PROFILER=ON" << std::endl;
+    }
+#endif
+
+    FramePacer::Sync sync = audio ? FramePacer::Sync::Audio : FramePacer::Sync::Timer;
+    double refreshHz = FramePacer::FRAME_HZ;
+    if (syncName == "timer") {
+        sync = FramePacer::Sync::Timer;
+    } else if (syncName == "audio" && !audio) {
+        std::cerr << "Warning: --sync audio needs an audio device; using the timer" << std::endl;
+    } else if (syncName == "vsync") {
+        sync = FramePacer::Sync::Vsync;
+        SDL_DisplayMode mode;
+        if (SDL_GetCurrentDisplayMode(SDL_GetWindowDisplayIndex(window), &mode) == 0 && mode.refresh_rate > 0) {
+            refreshHz = mode.refresh_rate;
+        }
+    }
+    const uint64_t ticksPerSecond = SDL_GetPerformanceFrequency();
+
+    // The emulation thread owns the machine. It publishes finished frames
+    // through a triple buffer and takes input from an SPSC queue, so a slow
+    // present never stalls the CPU and a busy CPU never stalls the window.
+    std::atomic<bool> quit{false};
+    std::atomic<uint64_t> presented{0}; // frames shown so far, for vsync pacing
+    TripleBuffer<Frame> frames;
+    SpscQueue<InputEvent, 256> input;
 
-    bool quit = false;
+    std::thread emulation([&] {
+        FramePacer pacer(sync, ticksPerSecond, refreshHz);
+        History history(machine); // for stepping back in the debugger
+        Debugger debugger(machine, &history);
+        bool breakIn = debug;
+        const double samplesPerFrame = speaker.sampleRate() / FramePacer::FRAME_HZ;
+        Frameskip frameskip(ticksPerSecond);
+        SpeedMeter speed(ticksPerSecond);
+        char title[128] = "Apple II+ Emulator";
+        double inputLatency = 0; // worst in the current stats window, in ticks
+        uint64_t aheadTicks = 0;  // spent running ahead in the current stats window
+        uint64_t aheadFrames = 0;
+        uint64_t lastPresented = 0;
+
+        auto publish = [&](const char* hud) {
+            Frame& frame = frames.back();
+            std::copy(&mem.data[0x0400], &mem.data[0x0800], frame.text.begin());
+            snprintf(frame.hud, sizeof(frame.hud), "%s", hud);
+            memcpy(frame.title, title, sizeof(title));
+            frames.publish();
+        };
+
+        while (!quit.load(std::memory_order_relaxed)) {
+            InputEvent event;
+            while (input.pop(event)) {
+                if (event.type == InputEvent::TOGGLE_TURBO) {
+                    turbo = !turbo;
+                } else if (event.type == InputEvent::SAVE_STATE) {
+                    if (statePath.empty() || !machine.saveState(statePath)) {
+                        std::cerr << "Warning: state not saved (use --state file)" << std::endl;
+                    }
+                } else if (event.type == InputEvent::DEBUG) {
+                    breakIn = true;
+                } else {
+                    machine.keyPress(event.key);
+                }
+                inputLatency = std::max(inputLatency, double(SDL_GetPerformanceCounter() - event.timestamp));
+            }
+
+            // The console reads stdin on this thread; the window keeps the
+            // last frame until the machine runs on.
+            if (breakIn || machine.breakpoints.stopped()) {
+                bool prompt = true;
+                if (breakIn) {
+                    debugger.breakIn(std::cout);
+                } else {
+                    prompt = debugger.stopped(std::cout);
+                }
+                breakIn = false;
+                if (prompt) {
+                    publish("DEBUG");
+                    if (debugger.console(std::cin, std::cout) == Debugger::Action::Quit) {
+                        quit.store(true, std::memory_order_relaxed);
+                        break;
+                    }
+                    pacer.resync(SDL_GetPerformanceCounter(), cpu.cycles);
+                }
+            }
+
+            history.record();
+            cpu.execute(pacer.cyclesThisFrame(cpu.cycles));
+            speaker.endFrame();
+            if (!wavPath.empty()) {
+                wavSamples.resize(speaker.available());
+                speaker.render(wavSamples.data(), wavSamples.size());
+                wav.write(wavSamples.data(), wavSamples.size());
+            }
+            uint64_t now = SDL_GetPerformanceCounter();
+            speed.update(cpu.cycles, now);
+
+            // Turbo, or while the drive spins: run unthrottled and show only
+            // every Nth frame (~30 per second in turbo, a few while loading).
+            // Emulated timing is unchanged; only the wall-clock pacing is.
+            if (turbo || (diskWarp && disk2.spinning())) {
+                if (frameskip.frameDone(now, turbo ? 30 : 4)) {
+                    char hud[64] = "";
+                    if (turbo) {
+                        snprintf(hud, sizeof(hud), "%.1fx %.2f MHz 1/%d", speed.multiple(), speed.mhz(),
+                                 frameskip.skip());
+                    }
+                    publish(hud);
+                }
+                pacer.resync(now, cpu.cycles);
+                continue;
+            }
+
+            // Sleep coarsely until ~2 ms before the deadline, then poll. With
+            // vsync, wait for the display thread to show the previous frame.
+            while (pacer.shouldWait(now, speaker.available() / samplesPerFrame)) {
+                uint64_t ms = 1;
+                if (pacer.sync() == FramePacer::Sync::Timer) {
+                    ms = pacer.ticksUntilDeadline(now) * 1000 / ticksPerSecond;
+                }
+                SDL_Delay(ms > 2 ? static_cast<Uint32>(ms - 2) : 0);
+                now = SDL_GetPerformanceCounter();
+            }
+            const uint64_t waitStart = now; // bounded in case the window stops presenting
+            while (sync == FramePacer::Sync::Vsync && presented.load(std::memory_order_acquire) == lastPresented &&
+                   now - waitStart < ticksPerSecond / 10 && !quit.load(std::memory_order_relaxed)) {
+                SDL_Delay(0);
+                now = SDL_GetPerformanceCounter();
+            }
+            lastPresented = presented.load(std::memory_order_acquire);
+            // Run-ahead: show the frame `runAhead` frames from now and rewind,
+            // so input shows up that many frames sooner.
+            if (runAhead > 0) {
+                uint64_t before = SDL_GetPerformanceCounter();
+                machine.runAhead(runAhead, [&] { publish(""); });
+                aheadTicks += SDL_GetPerformanceCounter() - before;
+                aheadFrames++;
+            } else {
+                publish("");
+            }
+            pacer.frameDone(now);
+
+            if (pacer.statsReady(now)) {
+                FramePacer::Stats stats = pacer.takeStats(now);
+                char ahead[32] = "";
+                if (aheadFrames) {
+                    snprintf(ahead, sizeof(ahead), ", ahead %d: %.2f ms", runAhead,
+                             aheadTicks * 1000.0 / ticksPerSecond / aheadFrames);
+                }
+                snprintf(title, sizeof(title), "Apple II+ Emulator - %.2f fps, frame %.1f ms (%.1f-%.1f), input %.1f ms%s%s",
+                         stats.fps, stats.avgMs, stats.minMs, stats.maxMs, inputLatency * 1000 / ticksPerSecond, ahead,
+                         stats.slips ? " [slipped]" : "");
+                inputLatency = 0;
+                aheadTicks = 0;
+                aheadFrames = 0;
+            }
+        }
+    });
+    unsigned cores = std::thread::hardware_concurrency();
+    if (cores > 1) {
+        pinToCore(emulation, cores - 1);
+    }
+
+    // Display thread: input in, frames out; never waits on the emulation.
     SDL_Event e;
     SDL_Color textColor = {255, 255, 255, 255};
-
-    while (!quit) {
+    std::string title;
+    while (!quit.load(std::memory_order_relaxed)) {
         while (SDL_PollEvent(&e) != 0) {
             if (e.type == SDL_QUIT) {
-                quit = true;
+                quit.store(true, std::memory_order_relaxed);
             } else if (e.type == SDL_KEYDOWN) {
+                InputEvent event;
+                event.timestamp = SDL_GetPerformanceCounter();
                 SDL_Keycode keycode = e.key.keysym.sym;
-                if (keycode >= 'a' && keycode <= 'z') {
-                    keycode = toupper(keycode);
-                }
-                if (keycode == SDLK_RETURN) {
-                    keycode = 0x0D;
+                if (keycode == SDLK_F9) {
+                    event.type = InputEvent::TOGGLE_TURBO;
+                } else if (keycode == SDLK_F5) {
+                    event.type = InputEvent::SAVE_STATE;
+                } else if (keycode == SDLK_F12) {
+                    event.type = InputEvent::DEBUG;
+                } else {
+                    if (keycode >= 'a' && keycode <= 'z') {
+                        keycode = toupper(keycode);
+                    }
+                    if (keycode == SDLK_RETURN) {
+                        keycode = 0x0D;
+                    }
+                    event.key = static_cast<uint8_t>(keycode);
                 }
-                mem.keyPress(static_cast<uint8_t>(keycode));
+                input.push(event); // dropped if 256 keys are already pending
             }
         }
 
-        cpu.execute(CYCLES_PER_FRAME);
+        if (!frames.update()) {
+            SDL_Delay(1);
+            continue;
+        }
+        const Frame& frame = frames.front();
+        renderScreen(renderer, font, frame.text.data(), textColor, frame.hud[0] ? frame.hud : nullptr);
+        presented.fetch_add(1, std::memory_order_release);
+        if (title != frame.title) {
+            title = frame.title;
+            SDL_SetWindowTitle(window, title.c_str());
+        }
+    }
+    emulation.join();
 
-        SDL_PumpEvents();
-        
-        renderScreen(renderer, font, mem, textColor);
-        SDL_Delay(16); // Aim for ~60 FPS
+    if (audio) {
+        SDL_CloseAudioDevice(audio);
+    }
+    wav.close();
+    if (speaker.dropped()) {
+        std::cerr << "Warning: " << speaker.dropped() << " speaker toggles dropped (audio ring full)" << std::endl;
+    }
+
+    if (cpu.trace) {
+        trace.close();
+        std::cout << "Wrote " << trace.recordsWritten() << " trace records to " << tracePath << std::endl;
+    }
+
+#ifdef CPU_PROFILER
+    if (cpu.profiler) {
+        profiler->write(profilePath);
+    }
+    if (cpu.callGraph) {
+        callGraph.finish(cpu.cycles);
+        std::ofstream folded(callGraphPath);
+        callGraph.writeFolded(folded);
+        callGraph.writeSummary(std::cout);
     }
+#endif
 
     TTF_CloseFont(font);
     SDL_DestroyRenderer(renderer);
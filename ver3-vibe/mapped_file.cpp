@@ -0,0 +1,70 @@
+#include "mapped_file.hpp"
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <utility>
+
+MappedFile::~MappedFile() {
+    close();
+}
+
+MappedFile::MappedFile(MappedFile&& other) noexcept {
+    *this = std::move(other);
+}
+
+MappedFile& MappedFile::operator=(MappedFile&& other) noexcept {
+    if (this != &other) {
+        close();
+        base = std::exchange(other.base, nullptr);
+        length = std::exchange(other.length, 0);
+        canWrite = std::exchange(other.canWrite, false);
+    }
+    return *this;
+}
+
+bool MappedFile::open(const std::string& filename, bool writable) {
+    close();
+    int fd = writable ? ::open(filename.c_str(), O_RDWR) : -1;
+    canWrite = fd >= 0;
+    if (fd < 0) {
+        fd = ::open(filename.c_str(), O_RDONLY);
+    }
+    if (fd < 0) {
+        return false;
+    }
+    struct stat st;
+    if (fstat(fd, &st) != 0 || st.st_size <= 0) {
+        ::close(fd);
+        return false;
+    }
+    int prot = canWrite ? PROT_READ | PROT_WRITE : PROT_READ;
+    void* p = mmap(nullptr, st.st_size, prot, MAP_SHARED, fd, 0);
+    ::close(fd); // the mapping keeps the file referenced
+    if (p == MAP_FAILED) {
+        canWrite = false;
+        return false;
+    }
+    base = static_cast<uint8_t*>(p);
+    length = st.st_size;
+    return true;
+}
+
+void MappedFile::close() {
+    if (base) {
+        munmap(base, length);
+    }
+    base = nullptr;
+    length = 0;
+    canWrite = false;
+}
+
+bool MappedFile::sync(size_t offset, size_t count) {
+    if (!base || !canWrite || offset >= length) {
+        return false;
+    }
+    static const size_t page = sysconf(_SC_PAGESIZE);
+    size_t start = offset / page * page;
+    size_t end = offset + count < length ? offset + count : length;
+    return msync(base + start, end - start, MS_SYNC) == 0;
+}
@@ -0,0 +1,37 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+// Whole-file memory mapping. Writable mappings are MAP_SHARED, so stores go
+// straight to the page cache and sync() makes them durable.
+class MappedFile {
+public:
+    MappedFile() = default;
+    ~MappedFile();
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+    MappedFile(MappedFile&& other) noexcept;
+    MappedFile& operator=(MappedFile&& other) noexcept;
+
+    // Maps `filename`. With `writable` the file is opened read-write; if
+    // that is not permitted the mapping falls back to read-only (check
+    // writable() afterwards). Empty files cannot be mapped.
+    bool open(const std::string& filename, bool writable);
+    void close();
+
+    bool isOpen() const { return base != nullptr; }
+    bool writable() const { return canWrite; }
+    uint8_t* data() { return base; }
+    const uint8_t* data() const { return base; }
+    size_t size() const { return length; }
+
+    // Writes back the pages covering [offset, offset + count).
+    bool sync(size_t offset, size_t count);
+
+private:
+    uint8_t* base = nullptr;
+    size_t length = 0;
+    bool canWrite = false;
+};
@@ -1,58 +1,104 @@
 #include "memory.hpp"
+#include "speaker.hpp"
 #include <iostream>
 #include <fstream>
+#include <cstring>
 
-Memory::Memory() : data(ADDRESS_SPACE_SIZE) {
-    // Initialize memory with zeros
-    for (uint32_t i = 0; i < ADDRESS_SPACE_SIZE; ++i) {
-        data[i] = 0;
+Memory::Memory() {
+    // The $C0 page is soft switches; ROM writes depend on romWriteProtect.
+    pageFlags[IO_START >> 8] = PAGE_IO;
+    for (uint32_t page = ROM_START >> 8; page <= (ROM_END >> 8); ++page) {
+        pageFlags[page] = PAGE_ROM;
     }
 }
 
 uint8_t Memory::read(uint16_t address) {
+    if (pageFlags[address >> 8] & (PAGE_IO | PAGE_WATCH_READ)) [[unlikely]] {
+        return readSlow(address);
+    }
+    // RAM, slot ROM and ROM
+    return data[address];
+}
+
+void Memory::write(uint16_t address, uint8_t value) {
+    if (pageFlags[address >> 8] & (PAGE_IO | PAGE_ROM | PAGE_WATCH_WRITE | PAGE_CODE)) [[unlikely]] {
+        writeSlow(address, value);
+        return;
+    }
+    markDirty(address);
+    data[address] = value;
+}
+
+uint8_t Memory::readSlow(uint16_t address) {
+    uint8_t flags = pageFlags[address >> 8];
+    uint8_t value = (flags & PAGE_IO) ? readIo(address) : data[address];
+    if ((flags & PAGE_WATCH_READ) && watcher) {
+        watcher->access(address, value, false);
+    }
+    return value;
+}
+
+void Memory::writeSlow(uint16_t address, uint8_t value) {
+    uint8_t flags = pageFlags[address >> 8];
+    if (flags & PAGE_CODE) {
+        writeGeneration[address >> 8]++;
+        pageFlags[address >> 8] &= ~PAGE_CODE;
+    }
+    markDirty(address);
+    if (flags & PAGE_IO) {
+        writeIo(address, value);
+    } else if (!(flags & PAGE_ROM) || !romWriteProtect) {
+        // ROM is writable unless romWriteProtect is set, for testing
+        data[address] = value;
+    }
+    if ((flags & PAGE_WATCH_WRITE) && watcher) {
+        watcher->access(address, value, true);
+    }
+}
+
+uint8_t Memory::readIo(uint16_t address) {
     // Keyboard controller
     if (address == 0xC000) {
         // Clear keyboard strobe when KBD is read
+        markDirty(0xC010);
         data[0xC010] &= 0x7F;
         return data[0xC000];
     }
-
-    if (address >= RAM_START && address <= RAM_END) {
-        // RAM access
-        return data[address];
-    } else if (address >= IO_START && address <= IO_END) {
-        // I/O Soft Switches access (future implementation)
-        // For now, just return data from the corresponding memory location
-        // std::cout << "Reading from I/O address: 0x" << std::hex << address << std::endl;
-        return data[address];
-    } else if (address >= ROM_START && address <= ROM_END) {
-        // ROM access (future implementation)
-        // For now, just return data from the corresponding memory location
-        // std::cout << "Reading from ROM address: 0x" << std::hex << address << std::endl;
-        return data[address];
+    if (address == 0xC010) {
+        // Any access to KBDSTRB clears the key-available bit
+        markDirty(0xC000);
+        data[0xC000] &= 0x7F;
+        data[0xC010] &= 0x7F;
+        return data[0xC010];
+    }
+    // Slot soft switches $C080-$C0FF
+    if (address >= 0xC080 && cards[(address >> 4) & 7]) {
+        return cards[(address >> 4) & 7]->io(address & 0x0F, false, 0);
+    }
+    if ((address & 0xFFF0) == 0xC030 && speaker) {
+        speaker->toggle();
     }
-    return 0; // Should not happen with a 64KB address space
+    // Other I/O Soft Switches (future implementation)
+    // For now, just return data from the corresponding memory location
+    return data[address];
 }
 
-void Memory::write(uint16_t address, uint8_t value) {
+void Memory::writeIo(uint16_t address, uint8_t value) {
     // Keyboard strobe clear
     if (address == 0xC010) {
+        data[0xC000] &= 0x7F;
         data[0xC010] &= 0x7F;
         return;
     }
-
-    if (address >= RAM_START && address <= RAM_END) {
-        // RAM access
-        data[address] = value;
-    } else if (address >= IO_START && address <= IO_END) {
-        // I/O Soft Switches access (future implementation)
-        // std::cout << "Writing to I/O address: 0x" << std::hex << address << " value: 0x" << std::hex << (int)value << std::endl;
-        data[address] = value; // For now, write to corresponding memory location
-    } else if (address >= ROM_START && address <= ROM_END) {
-        // ROM access (ROM is usually read-only, but for now, allow writes for testing)
-        // std::cout << "Writing to ROM address: 0x" << std::hex << address << " value: 0x" << std::hex << (int)value << std::endl;
-        data[address] = value; // For now, write to corresponding memory location
+    if (address >= 0xC080 && cards[(address >> 4) & 7]) {
+        cards[(address >> 4) & 7]->io(address & 0x0F, true, value);
+        return;
+    }
+    if ((address & 0xFFF0) == 0xC030 && speaker) {
+        speaker->toggle();
     }
+    // I/O Soft Switches access (future implementation)
+    data[address] = value; // For now, write to corresponding memory location
 }
 
 bool Memory::loadROM(const std::string& filename, uint16_t start_address) {
@@ -75,6 +121,59 @@ bool Memory::loadROM(const std::string& filename, uint16_t start_address) {
 
 void Memory::keyPress(uint8_t key) {
     // Apple II ROM expects the high bit of the ASCII code to be set
+    markDirty(0xC000);
     data[0xC000] = key | 0x80;
     data[0xC010] |= 0x80; // Set keyboard strobe
-}
\ No newline at end of file
+}
+
+void Memory::poke(uint16_t address, uint8_t value) {
+    markDirty(address);
+    data[address] = value;
+    writeGeneration[address >> 8]++;
+}
+
+void Memory::contentsChanged() {
+    for (uint32_t& generation : writeGeneration) {
+        generation++;
+    }
+}
+
+void Memory::insertCard(int slot, Card* card) {
+    if (slot < 1 || slot > 7) {
+        return;
+    }
+    cards[slot] = card;
+    const uint8_t* rom = card ? card->rom() : nullptr;
+    for (int i = 0; i < 0x100; ++i) {
+        data[0xC000 + slot * 0x100 + i] = rom ? rom[i] : 0;
+    }
+    writeGeneration[0xC0 + slot]++;
+}
+
+void Memory::takeSnapshot() {
+    snapshot.assign(data.begin(), data.end());
+    clearDirty();
+}
+
+void Memory::restoreSnapshot() {
+    if (!snapshot.empty()) {
+        restoreDirtyPages(snapshot.data());
+    }
+}
+
+void Memory::clearDirty() {
+    for (size_t i = 0; i < dirtyCount; ++i) {
+        dirty[dirtyPages[i]] = false;
+    }
+    dirtyCount = 0;
+}
+
+void Memory::restoreDirtyPages(const uint8_t* image) {
+    for (size_t i = 0; i < dirtyCount; ++i) {
+        size_t offset = size_t(dirtyPages[i]) << 8;
+        memcpy(&data[offset], &image[offset], 0x100);
+        dirty[dirtyPages[i]] = false;
+        writeGeneration[dirtyPages[i]]++;
+    }
+    dirtyCount = 0;
+}
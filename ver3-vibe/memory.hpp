@@ -4,6 +4,18 @@
 #include <vector>
 #include <cstdint>
 #include <string>
+#include <array>
+#include "card.hpp"
+
+class Speaker;
+
+// Told about each access to a watched page (see Memory::pageFlags); for a
+// write, after the value is stored.
+class AccessWatcher {
+public:
+    virtual ~AccessWatcher() = default;
+    virtual void access(uint16_t address, uint8_t value, bool write) = 0;
+};
 
 class Memory {
 public:
@@ -16,7 +28,34 @@ public:
     static constexpr uint16_t IO_END = 0xCFFF;
     static constexpr uint16_t ROM_START = 0xD000;
     static constexpr uint16_t ROM_END = 0xFFFF;
-    std::vector<uint8_t> data;
+    std::array<uint8_t, ADDRESS_SPACE_SIZE> data{}; // inline, so a Memory is one flat block
+    bool romWriteProtect = false; // ignore CPU writes to $D000-$FFFF, as on real hardware
+    Speaker* speaker = nullptr;   // toggled by any access to $C030-$C03F, when set
+
+    // Flags per 256-byte page. Accesses to RAM pages with none of the
+    // access flags go straight to `data`; the rest take the slow path, which
+    // handles soft switches, ROM write protection and tells `watcher` about
+    // watched pages. CPU::execute asks its breakpoints about an instruction
+    // only when its page is flagged PAGE_BREAK or PAGE_STOP.
+    enum : uint8_t {
+        PAGE_IO = 0x01,          // $C0xx soft switches
+        PAGE_ROM = 0x02,         // $D000-$FFFF, for writes
+        PAGE_WATCH_READ = 0x04,
+        PAGE_WATCH_WRITE = 0x08,
+        PAGE_BREAK = 0x10,
+        PAGE_STOP = 0x20,        // set on every page to stop before the next instruction
+        PAGE_CODE = 0x40,        // the next write bumps writeGeneration (and clears this)
+    };
+    std::array<uint8_t, 256> pageFlags{};
+    AccessWatcher* watcher = nullptr;
+
+    // Per-page counters for caches of memory contents (e.g. disassembly):
+    // a cache flags the pages it read PAGE_CODE and notes their generation,
+    // and stays valid while the generation is unchanged. Only the first
+    // write after flagging takes the slow path.
+    std::array<uint32_t, 256> writeGeneration{};
+    // Bumps every page's generation, after stores straight into `data`.
+    void contentsChanged();
 
     Memory();
 
@@ -24,6 +63,45 @@ public:
     void write(uint16_t address, uint8_t value);
     bool loadROM(const std::string& filename, uint16_t start_address);
     void keyPress(uint8_t key);
+    // Stores without soft-switch side effects, ROM protection or watchpoints
+    // (debugger edits). Tracked like a write.
+    void poke(uint16_t address, uint8_t value);
+
+    // Plugs a card into slot 1-7 (nullptr removes it) and copies its ROM to $Cn00.
+    void insertCard(int slot, Card* card);
+
+    // Snapshot of the address space. Writes record which 256-byte pages they
+    // touched, so restoreSnapshot() only copies those pages back. Direct
+    // stores into `data` are not tracked.
+    void takeSnapshot();
+    void restoreSnapshot();
+
+    // The same tracking against an image kept elsewhere: clearDirty() marks
+    // the current contents as matching it, and restoreDirtyPages() copies
+    // back only what was written since.
+    void clearDirty();
+    void restoreDirtyPages(const uint8_t* image);
+    size_t dirtyPageCount() const { return dirtyCount; }
+
+private:
+    uint8_t readSlow(uint16_t address);
+    void writeSlow(uint16_t address, uint8_t value);
+    uint8_t readIo(uint16_t address);
+    void writeIo(uint16_t address, uint8_t value);
+
+    void markDirty(uint16_t address) {
+        uint8_t page = address >> 8;
+        if (!dirty[page]) {
+            dirty[page] = true;
+            dirtyPages[dirtyCount++] = page;
+        }
+    }
+
+    std::array<Card*, 8> cards{};
+    std::vector<uint8_t> snapshot;
+    std::array<bool, 256> dirty{};
+    std::array<uint8_t, 256> dirtyPages{};
+    size_t dirtyCount = 0;
 };
 
 #endif // RAY_MEMORY_HPP
@@ -0,0 +1,195 @@
+#include "opcodes.hpp"
+#include <cstdio>
+
+namespace {
+
+struct Entry {
+    uint8_t opcode;
+    OpcodeInfo info;
+};
+
+using M = AddrMode;
+
+constexpr Entry DOCUMENTED[] = {
+    {0x69, {"ADC", M::IMM, 2, false}}, {0x65, {"ADC", M::ZPG, 3, false}},
+    {0x75, {"ADC", M::ZPX, 4, false}}, {0x6D, {"ADC", M::ABS, 4, false}},
+    {0x7D, {"ADC", M::ABX, 4, true}},  {0x79, {"ADC", M::ABY, 4, true}},
+    {0x61, {"ADC", M::IZX, 6, false}}, {0x71, {"ADC", M::IZY, 5, true}},
+
+    {0x29, {"AND", M::IMM, 2, false}}, {0x25, {"AND", M::ZPG, 3, false}},
+    {0x35, {"AND", M::ZPX, 4, false}}, {0x2D, {"AND", M::ABS, 4, false}},
+    {0x3D, {"AND", M::ABX, 4, true}},  {0x39, {"AND", M::ABY, 4, true}},
+    {0x21, {"AND", M::IZX, 6, false}}, {0x31, {"AND", M::IZY, 5, true}},
+
+    {0x0A, {"ASL", M::ACC, 2, false}}, {0x06, {"ASL", M::ZPG, 5, false}},
+    {0x16, {"ASL", M::ZPX, 6, false}}, {0x0E, {"ASL", M::ABS, 6, false}},
+    {0x1E, {"ASL", M::ABX, 7, false}},
+
+    {0x90, {"BCC", M::REL, 2, false}}, {0xB0, {"BCS", M::REL, 2, false}},
+    {0xF0, {"BEQ", M::REL, 2, false}}, {0xD0, {"BNE", M::REL, 2, false}},
+    {0x30, {"BMI", M::REL, 2, false}}, {0x10, {"BPL", M::REL, 2, false}},
+    {0x50, {"BVC", M::REL, 2, false}}, {0x70, {"BVS", M::REL, 2, false}},
+
+    {0x24, {"BIT", M::ZPG, 3, false}}, {0x2C, {"BIT", M::ABS, 4, false}},
+
+    {0x00, {"BRK", M::IMP, 7, false}},
+
+    {0x18, {"CLC", M::IMP, 2, false}}, {0xD8, {"CLD", M::IMP, 2, false}},
+    {0x58, {"CLI", M::IMP, 2, false}}, {0xB8, {"CLV", M::IMP, 2, false}},
+
+    {0xC9, {"CMP", M::IMM, 2, false}}, {0xC5, {"CMP", M::ZPG, 3, false}},
+    {0xD5, {"CMP", M::ZPX, 4, false}}, {0xCD, {"CMP", M::ABS, 4, false}},
+    {0xDD, {"CMP", M::ABX, 4, true}},  {0xD9, {"CMP", M::ABY, 4, true}},
+    {0xC1, {"CMP", M::IZX, 6, false}}, {0xD1, {"CMP", M::IZY, 5, true}},
+
+    {0xE0, {"CPX", M::IMM, 2, false}}, {0xE4, {"CPX", M::ZPG, 3, false}},
+    {0xEC, {"CPX", M::ABS, 4, false}},
+    {0xC0, {"CPY", M::IMM, 2, false}}, {0xC4, {"CPY", M::ZPG, 3, false}},
+    {0xCC, {"CPY", M::ABS, 4, false}},
+
+    {0xC6, {"DEC", M::ZPG, 5, false}}, {0xD6, {"DEC", M::ZPX, 6, false}},
+    {0xCE, {"DEC", M::ABS, 6, false}}, {0xDE, {"DEC", M::ABX, 7, false}},
+    {0xCA, {"DEX", M::IMP, 2, false}}, {0x88, {"DEY", M::IMP, 2, false}},
+
+    {0x49, {"EOR", M::IMM, 2, false}}, {0x45, {"EOR", M::ZPG, 3, false}},
+    {0x55, {"EOR", M::ZPX, 4, false}}, {0x4D, {"EOR", M::ABS, 4, false}},
+    {0x5D, {"EOR", M::ABX, 4, true}},  {0x59, {"EOR", M::ABY, 4, true}},
+    {0x41, {"EOR", M::IZX, 6, false}}, {0x51, {"EOR", M::IZY, 5, true}},
+
+    {0xE6, {"INC", M::ZPG, 5, false}}, {0xF6, {"INC", M::ZPX, 6, false}},
+    {0xEE, {"INC", M::ABS, 6, false}}, {0xFE, {"INC", M::ABX, 7, false}},
+    {0xE8, {"INX", M::IMP, 2, false}}, {0xC8, {"INY", M::IMP, 2, false}},
+
+    {0x4C, {"JMP", M::ABS, 3, false}}, {0x6C, {"JMP", M::IND, 5, false}},
+    {0x20, {"JSR", M::ABS, 6, false}},
+
+    {0xA9, {"LDA", M::IMM, 2, false}}, {0xA5, {"LDA", M::ZPG, 3, false}},
+    {0xB5, {"LDA", M::ZPX, 4, false}}, {0xAD, {"LDA", M::ABS, 4, false}},
+    {0xBD, {"LDA", M::ABX, 4, true}},  {0xB9, {"LDA", M::ABY, 4, true}},
+    {0xA1, {"LDA", M::IZX, 6, false}}, {0xB1, {"LDA", M::IZY, 5, true}},
+
+    {0xA2, {"LDX", M::IMM, 2, false}}, {0xA6, {"LDX", M::ZPG, 3, false}},
+    {0xB6, {"LDX", M::ZPY, 4, false}}, {0xAE, {"LDX", M::ABS, 4, false}},
+    {0xBE, {"LDX", M::ABY, 4, true}},
+
+    {0xA0, {"LDY", M::IMM, 2, false}}, {0xA4, {"LDY", M::ZPG, 3, false}},
+    {0xB4, {"LDY", M::ZPX, 4, false}}, {0xAC, {"LDY", M::ABS, 4, false}},
+    {0xBC, {"LDY", M::ABX, 4, true}},
+
+    {0x4A, {"LSR", M::ACC, 2, false}}, {0x46, {"LSR", M::ZPG, 5, false}},
+    {0x56, {"LSR", M::ZPX, 6, false}}, {0x4E, {"LSR", M::ABS, 6, false}},
+    {0x5E, {"LSR", M::ABX, 7, false}},
+
+    {0xEA, {"NOP", M::IMP, 2, false}},
+
+    {0x09, {"ORA", M::IMM, 2, false}}, {0x05, {"ORA", M::ZPG, 3, false}},
+    {0x15, {"ORA", M::ZPX, 4, false}}, {0x0D, {"ORA", M::ABS, 4, false}},
+    {0x1D, {"ORA", M::ABX, 4, true}},  {0x19, {"ORA", M::ABY, 4, true}},
+    {0x01, {"ORA", M::IZX, 6, false}}, {0x11, {"ORA", M::IZY, 5, true}},
+
+    {0x48, {"PHA", M::IMP, 3, false}}, {0x08, {"PHP", M::IMP, 3, false}},
+    {0x68, {"PLA", M::IMP, 4, false}}, {0x28, {"PLP", M::IMP, 4, false}},
+
+    {0x2A, {"ROL", M::ACC, 2, false}}, {0x26, {"ROL", M::ZPG, 5, false}},
+    {0x36, {"ROL", M::ZPX, 6, false}}, {0x2E, {"ROL", M::ABS, 6, false}},
+    {0x3E, {"ROL", M::ABX, 7, false}},
+
+    {0x6A, {"ROR", M::ACC, 2, false}}, {0x66, {"ROR", M::ZPG, 5, false}},
+    {0x76, {"ROR", M::ZPX, 6, false}}, {0x6E, {"ROR", M::ABS, 6, false}},
+    {0x7E, {"ROR", M::ABX, 7, false}},
+
+    {0x40, {"RTI", M::IMP, 6, false}}, {0x60, {"RTS", M::IMP, 6, false}},
+
+    {0xE9, {"SBC", M::IMM, 2, false}}, {0xE5, {"SBC", M::ZPG, 3, false}},
+    {0xF5, {"SBC", M::ZPX, 4, false}}, {0xED, {"SBC", M::ABS, 4, false}},
+    {0xFD, {"SBC", M::ABX, 4, true}},  {0xF9, {"SBC", M::ABY, 4, true}},
+    {0xE1, {"SBC", M::IZX, 6, false}}, {0xF1, {"SBC", M::IZY, 5, true}},
+
+    {0x38, {"SEC", M::IMP, 2, false}}, {0xF8, {"SED", M::IMP, 2, false}},
+    {0x78, {"SEI", M::IMP, 2, false}},
+
+    {0x85, {"STA", M::ZPG, 3, false}}, {0x95, {"STA", M::ZPX, 4, false}},
+    {0x8D, {"STA", M::ABS, 4, false}}, {0x9D, {"STA", M::ABX, 5, false}},
+    {0x99, {"STA", M::ABY, 5, false}}, {0x81, {"STA", M::IZX, 6, false}},
+    {0x91, {"STA", M::IZY, 6, false}},
+
+    {0x86, {"STX", M::ZPG, 3, false}}, {0x96, {"STX", M::ZPY, 4, false}},
+    {0x8E, {"STX", M::ABS, 4, false}},
+    {0x84, {"STY", M::ZPG, 3, false}}, {0x94, {"STY", M::ZPX, 4, false}},
+    {0x8C, {"STY", M::ABS, 4, false}},
+
+    {0xAA, {"TAX", M::IMP, 2, false}}, {0xA8, {"TAY", M::IMP, 2, false}},
+    {0xBA, {"TSX", M::IMP, 2, false}}, {0x8A, {"TXA", M::IMP, 2, false}},
+    {0x9A, {"TXS", M::IMP, 2, false}}, {0x98, {"TYA", M::IMP, 2, false}},
+};
+
+} // namespace
+
+// Undocumented opcodes execute as 1-byte, 2-cycle NOPs in CPU::execute.
+const std::array<OpcodeInfo, 256> OPCODES = [] {
+    std::array<OpcodeInfo, 256> table{};
+    table.fill({"???", AddrMode::IMP, 2, false});
+    for (const Entry& e : DOCUMENTED) {
+        table[e.opcode] = e.info;
+    }
+    return table;
+}();
+
+const char* addrModeName(AddrMode mode) {
+    switch (mode) {
+        case AddrMode::IMP: return "implied";
+        case AddrMode::ACC: return "accumulator";
+        case AddrMode::IMM: return "immediate";
+        case AddrMode::ZPG: return "zeropage";
+        case AddrMode::ZPX: return "zeropage,X";
+        case AddrMode::ZPY: return "zeropage,Y";
+        case AddrMode::ABS: return "absolute";
+        case AddrMode::ABX: return "absolute,X";
+        case AddrMode::ABY: return "absolute,Y";
+        case AddrMode::IND: return "indirect";
+        case AddrMode::IZX: return "(indirect,X)";
+        case AddrMode::IZY: return "(indirect),Y";
+        case AddrMode::REL: return "relative";
+        default: return "?";
+    }
+}
+
+uint8_t addrModeLength(AddrMode mode) {
+    switch (mode) {
+        case AddrMode::IMP:
+        case AddrMode::ACC:
+            return 1;
+        case AddrMode::ABS:
+        case AddrMode::ABX:
+        case AddrMode::ABY:
+        case AddrMode::IND:
+            return 3;
+        default:
+            return 2;
+    }
+}
+
+std::string disassemble(uint16_t pc, uint8_t opcode, uint8_t op1, uint8_t op2) {
+    const OpcodeInfo& info = OPCODES[opcode];
+    uint16_t word = op1 | (op2 << 8);
+    char text[24];
+    switch (info.mode) {
+        case AddrMode::IMP: snprintf(text, sizeof(text), "%s", info.mnemonic); break;
+        case AddrMode::ACC: snprintf(text, sizeof(text), "%s A", info.mnemonic); break;
+        case AddrMode::IMM: snprintf(text, sizeof(text), "%s #$%02X", info.mnemonic, op1); break;
+        case AddrMode::ZPG: snprintf(text, sizeof(text), "%s $%02X", info.mnemonic, op1); break;
+        case AddrMode::ZPX: snprintf(text, sizeof(text), "%s $%02X,X", info.mnemonic, op1); break;
+        case AddrMode::ZPY: snprintf(text, sizeof(text), "%s $%02X,Y", info.mnemonic, op1); break;
+        case AddrMode::ABS: snprintf(text, sizeof(text), "%s $%04X", info.mnemonic, word); break;
+        case AddrMode::ABX: snprintf(text, sizeof(text), "%s $%04X,X", info.mnemonic, word); break;
+        case AddrMode::ABY: snprintf(text, sizeof(text), "%s $%04X,Y", info.mnemonic, word); break;
+        case AddrMode::IND: snprintf(text, sizeof(text), "%s ($%04X)", info.mnemonic, word); break;
+        case AddrMode::IZX: snprintf(text, sizeof(text), "%s ($%02X,X)", info.mnemonic, op1); break;
+        case AddrMode::IZY: snprintf(text, sizeof(text), "%s ($%02X),Y", info.mnemonic, op1); break;
+        case AddrMode::REL:
+            snprintf(text, sizeof(text), "%s $%04X", info.mnemonic, uint16_t(pc + 2 + int8_t(op1)));
+            break;
+        default: snprintf(text, sizeof(text), "%s", info.mnemonic); break;
+    }
+    return text;
+}
@@ -0,0 +1,43 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <string>
+
+// 6502 addressing modes
+enum class AddrMode : uint8_t {
+    IMP,  // implied
+    ACC,  // accumulator
+    IMM,  // #$nn
+    ZPG,  // $nn
+    ZPX,  // $nn,X
+    ZPY,  // $nn,Y
+    ABS,  // $nnnn
+    ABX,  // $nnnn,X
+    ABY,  // $nnnn,Y
+    IND,  // ($nnnn)
+    IZX,  // ($nn,X)
+    IZY,  // ($nn),Y
+    REL,  // branch offset
+    COUNT
+};
+
+struct OpcodeInfo {
+    const char* mnemonic; // "???" for undocumented opcodes
+    AddrMode mode;
+    uint8_t cycles;       // base cycle count
+    bool pagePenalty;     // +1 cycle when the effective address crosses a page
+};
+
+// Decode table for all 256 opcodes, indexed by opcode byte.
+extern const std::array<OpcodeInfo, 256> OPCODES;
+
+const char* addrModeName(AddrMode mode);
+
+// Instruction length in bytes, including the opcode.
+uint8_t addrModeLength(AddrMode mode);
+
+// One instruction in assembler syntax, e.g. "LDA ($24),Y" or "BNE $FD1B".
+// `pc` is the opcode's address (for branch targets); op1 and op2 are the
+// bytes after it, whether or not the instruction uses them.
+std::string disassemble(uint16_t pc, uint8_t opcode, uint8_t op1, uint8_t op2);
@@ -0,0 +1,127 @@
+#include "pacer.hpp"
+#include <algorithm>
+#include <cmath>
+
+FramePacer::FramePacer(Sync sync, uint64_t ticksPerSecond, double refreshHz)
+    : mode(sync), frequency(ticksPerSecond),
+      nominalPeriod(ticksPerSecond / (sync == Sync::Vsync ? refreshHz : FRAME_HZ)), period(nominalPeriod),
+      cyclesPerFrame(sync == Sync::Vsync ? CPU_CLOCK_HZ / refreshHz : CYCLES_PER_FRAME) {}
+
+uint32_t FramePacer::cyclesThisFrame(uint64_t cpuCycles) {
+    if (targetCycles < 0) {
+        targetCycles = static_cast<double>(cpuCycles);
+    }
+    targetCycles += cyclesPerFrame;
+    double budget = targetCycles - static_cast<double>(cpuCycles);
+    return budget > 0 ? static_cast<uint32_t>(std::llround(budget)) : 0;
+}
+
+bool FramePacer::shouldWait(uint64_t now, double bufferedFrames) const {
+    if (!started) {
+        return false;
+    }
+    switch (mode) {
+    case Sync::Timer:
+        return ticksUntilDeadline(now) > 0;
+    case Sync::Audio:
+        // Bounded in case the device stops pulling.
+        return bufferedFrames > AUDIO_FRAMES_BUFFERED && now - lastFrame < 2 * period;
+    case Sync::Vsync:
+        break;
+    }
+    return false;
+}
+
+uint64_t FramePacer::ticksUntilDeadline(uint64_t now) const {
+    double deadline = base + (frames + 1) * period;
+    return deadline > now ? static_cast<uint64_t>(deadline - now) : 0;
+}
+
+void FramePacer::frameDone(uint64_t now) {
+    if (!started) {
+        restart(now);
+        statsStart = now;
+        return;
+    }
+    double ticks = static_cast<double>(now - lastFrame);
+    if (statsFrames == 0) {
+        minTicks = maxTicks = ticks;
+    }
+    minTicks = std::min(minTicks, ticks);
+    maxTicks = std::max(maxTicks, ticks);
+    sumTicks += ticks;
+    statsFrames++;
+    lastFrame = now;
+    frames++;
+
+    if (mode == Sync::Timer && now > base + (frames + MAX_BEHIND) * period) {
+        slipCount++;
+        base = now;
+        frames = 0;
+    } else if (mode == Sync::Vsync && std::abs(ticks - nominalPeriod) < nominalPeriod * 0.1) {
+        // Track the display's real rate rather than what it reports.
+        period = 0.95 * period + 0.05 * ticks;
+        cyclesPerFrame = CPU_CLOCK_HZ * period / frequency;
+    }
+}
+
+void FramePacer::resync(uint64_t now, uint64_t cpuCycles) {
+    restart(now);
+    targetCycles = static_cast<double>(cpuCycles);
+}
+
+void FramePacer::restart(uint64_t now) {
+    started = true;
+    base = now;
+    frames = 0;
+    lastFrame = now;
+}
+
+FramePacer::Stats FramePacer::takeStats(uint64_t now) {
+    Stats stats;
+    double seconds = static_cast<double>(now - statsStart) / frequency;
+    double toMs = 1000.0 / frequency;
+    if (statsFrames > 0 && seconds > 0) {
+        stats.fps = statsFrames / seconds;
+        stats.avgMs = sumTicks / statsFrames * toMs;
+        stats.minMs = minTicks * toMs;
+        stats.maxMs = maxTicks * toMs;
+    }
+    stats.slips = slipCount;
+    statsStart = now;
+    statsFrames = 0;
+    sumTicks = 0;
+    return stats;
+}
+
+bool Frameskip::frameDone(uint64_t now, double presentsPerSecond) {
+    if (last == 0 || now - last > frequency) { // first frame, or resuming
+        last = now;
+        count = 0;
+        return true;
+    }
+    double ticks = static_cast<double>(now - last);
+    averageTicks = averageTicks == 0 ? ticks : 0.9 * averageTicks + 0.1 * ticks;
+    last = now;
+    if (++count < n) {
+        return false;
+    }
+    count = 0;
+    double frames = frequency / presentsPerSecond / std::max(averageTicks, 1.0);
+    n = static_cast<int>(std::clamp(std::round(frames), 1.0, 10000.0));
+    return true;
+}
+
+void SpeedMeter::update(uint64_t cpuCycles, uint64_t now) {
+    if (startTicks == 0 || cpuCycles < startCycles) {
+        startCycles = cpuCycles;
+        startTicks = now;
+        return;
+    }
+    uint64_t ticks = now - startTicks;
+    if (ticks * 2 >= frequency) {
+        hz = static_cast<double>(cpuCycles - startCycles) * frequency / ticks;
+        startCycles = cpuCycles;
+        startTicks = now;
+    }
+}
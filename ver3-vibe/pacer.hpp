@@ -0,0 +1,121 @@
+#pragma once
+
+#include <cstdint>
+
+// Frame pacing for the NTSC Apple II: 17,030 CPU cycles per video frame
+// (65 cycles x 262 lines) at a 1.0205 MHz clock, i.e. ~59.92 Hz.
+//
+// Cycle budgets come from a fractional accumulator over the whole run, so
+// instruction overshoot and non-integer cycles per frame never drift. Wall
+// time is measured in performance-counter ticks (SDL_GetPerformanceCounter)
+// and the pacer is independent of SDL so it can be tested with a fake clock.
+//
+//   Timer  sleep until an absolute deadline (base + n * period); falling
+//          more than MAX_BEHIND frames behind resyncs instead of bursting.
+//   Audio  wait while more than AUDIO_FRAMES_BUFFERED frames of sound are
+//          still unplayed, so the sound card's clock drives emulation.
+//   Vsync  presenting blocks on the display; each frame runs the cycles for
+//          one measured refresh period, so 60 Hz or 144 Hz both run at 1x.
+class FramePacer {
+public:
+    enum class Sync { Timer, Audio, Vsync };
+
+    static constexpr uint32_t CYCLES_PER_FRAME = 17030;
+    static constexpr double CPU_CLOCK_HZ = 14318181.8 * 65 / 912; // 1,020,484 Hz
+    static constexpr double FRAME_HZ = CPU_CLOCK_HZ / CYCLES_PER_FRAME; // 59.92 Hz
+    static constexpr int MAX_BEHIND = 4;
+    static constexpr double AUDIO_FRAMES_BUFFERED = 3;
+
+    struct Stats {
+        double fps = 0;
+        double avgMs = 0;
+        double minMs = 0;
+        double maxMs = 0;
+        uint64_t slips = 0; // resyncs after falling behind, total
+    };
+
+    FramePacer(Sync sync, uint64_t ticksPerSecond, double refreshHz = FRAME_HZ);
+
+    Sync sync() const { return mode; }
+
+    // Cycles to run for the next frame. Overshoot of the previous frame is
+    // taken off this one.
+    uint32_t cyclesThisFrame(uint64_t cpuCycles);
+
+    // Whether to hold off the next frame. `bufferedFrames` is emulated sound
+    // not yet played, in frames (only used by Audio).
+    bool shouldWait(uint64_t now, double bufferedFrames) const;
+    // Ticks until the Timer deadline (0 if it has passed).
+    uint64_t ticksUntilDeadline(uint64_t now) const;
+
+    // Call once per displayed frame: records the frame time and advances
+    // the deadline.
+    void frameDone(uint64_t now);
+    // Restarts the schedule from `now` and the cycle budgets from
+    // `cpuCycles`, e.g. after running unthrottled or after the debugger
+    // moved the machine back in time.
+    void resync(uint64_t now, uint64_t cpuCycles);
+
+    // True about once a second; takeStats() then returns and resets the
+    // window.
+    bool statsReady(uint64_t now) const { return started && now - statsStart >= frequency; }
+    Stats takeStats(uint64_t now);
+
+private:
+    void restart(uint64_t now);
+
+    Sync mode;
+    uint64_t frequency;
+    double nominalPeriod; // ticks per frame
+    double period;
+    double cyclesPerFrame;
+    double targetCycles = -1;
+
+    bool started = false;
+    uint64_t base = 0;   // next deadline = base + (frames + 1) * period
+    uint64_t frames = 0;
+    uint64_t lastFrame = 0;
+
+    uint64_t statsStart = 0;
+    uint64_t statsFrames = 0;
+    double sumTicks = 0;
+    double minTicks = 0;
+    double maxTicks = 0;
+    uint64_t slipCount = 0;
+};
+
+// Adaptive frameskip for unthrottled running: shows one of every N emulated
+// frames, with N re-estimated from how long frames (including the renders)
+// actually take, so the window keeps presenting at about the requested rate
+// whatever the emulation speed.
+class Frameskip {
+public:
+    explicit Frameskip(uint64_t ticksPerSecond) : frequency(ticksPerSecond) {}
+
+    // Call after each emulated frame; true when this one should be shown.
+    bool frameDone(uint64_t now, double presentsPerSecond);
+    int skip() const { return n; }
+
+private:
+    uint64_t frequency;
+    uint64_t last = 0;
+    double averageTicks = 0;
+    int n = 1;
+    int count = 0;
+};
+
+// Emulated CPU speed, averaged over about half a second.
+class SpeedMeter {
+public:
+    explicit SpeedMeter(uint64_t ticksPerSecond) : frequency(ticksPerSecond) {}
+
+    void update(uint64_t cpuCycles, uint64_t now);
+    double mhz() const { return hz / 1e6; }
+    double multiple() const { return hz / FramePacer::CPU_CLOCK_HZ; }
+
+private:
+    uint64_t frequency;
+    uint64_t startCycles = 0;
+    uint64_t startTicks = 0;
+    double hz = 0;
+};
@@ -0,0 +1,137 @@
+#include "profiler.hpp"
+#include "opcodes.hpp"
+#include <algorithm>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <vector>
+
+void Profiler::clear() {
+    opcodeCount.fill(0);
+    opcodeCycles.fill(0);
+    pcCount.fill(0);
+    pcCycles.fill(0);
+}
+
+bool Profiler::write(const std::string& filename, size_t topN) const {
+    std::ofstream file(filename);
+    if (!file.is_open()) {
+        std::cerr << "Error: Could not open profile output: " << filename << std::endl;
+        return false;
+    }
+
+    bool csv = filename.size() >= 4 && filename.compare(filename.size() - 4, 4, ".csv") == 0;
+    if (csv) {
+        writeCSV(file);
+    } else {
+        writeReport(file, topN);
+    }
+    return true;
+}
+
+namespace {
+
+struct Row {
+    uint32_t key;
+    uint64_t count;
+    uint64_t cycles;
+};
+
+// Sorts by cycles, highest first, and drops rows that never executed.
+void sortRows(std::vector<Row>& rows) {
+    rows.erase(std::remove_if(rows.begin(), rows.end(), [](const Row& r) { return r.count == 0; }), rows.end());
+    std::sort(rows.begin(), rows.end(), [](const Row& l, const Row& r) {
+        return l.cycles != r.cycles ? l.cycles > r.cycles : l.key < r.key;
+    });
+}
+
+double percent(uint64_t part, uint64_t total) {
+    return total ? 100.0 * part / total : 0.0;
+}
+
+} // namespace
+
+void Profiler::writeReport(std::ostream& out, size_t topN) const {
+    uint64_t totalCount = 0;
+    uint64_t totalCycles = 0;
+    for (int i = 0; i < 256; ++i) {
+        totalCount += opcodeCount[i];
+        totalCycles += opcodeCycles[i];
+    }
+
+    out << "Instructions: " << totalCount << "  Cycles: " << totalCycles << "\n\n";
+
+    std::vector<Row> opcodes;
+    std::array<Row, static_cast<size_t>(AddrMode::COUNT)> modes{};
+    for (uint32_t op = 0; op < 256; ++op) {
+        opcodes.push_back({op, opcodeCount[op], opcodeCycles[op]});
+        Row& mode = modes[static_cast<size_t>(OPCODES[op].mode)];
+        mode.key = static_cast<uint32_t>(OPCODES[op].mode);
+        mode.count += opcodeCount[op];
+        mode.cycles += opcodeCycles[op];
+    }
+    sortRows(opcodes);
+    std::vector<Row> modeRows(modes.begin(), modes.end());
+    sortRows(modeRows);
+
+    std::vector<Row> pcs;
+    for (uint32_t pc = 0; pc < 0x10000; ++pc) {
+        if (pcCount[pc]) {
+            pcs.push_back({pc, pcCount[pc], pcCycles[pc]});
+        }
+    }
+    sortRows(pcs);
+
+    out << std::fixed << std::setprecision(2);
+
+    out << "== Opcodes (by cycles) ==\n";
+    out << "  op  mnem  mode          count        cycles      %\n";
+    for (const Row& r : opcodes) {
+        const OpcodeInfo& info = OPCODES[r.key];
+        out << "  " << std::hex << std::uppercase << std::setw(2) << std::setfill('0') << r.key
+            << std::dec << std::setfill(' ') << "  " << info.mnemonic << "   "
+            << std::left << std::setw(13) << addrModeName(info.mode) << std::right
+            << std::setw(12) << r.count << std::setw(14) << r.cycles
+            << std::setw(7) << percent(r.cycles, totalCycles) << "\n";
+    }
+
+    out << "\n== Addressing modes (by cycles) ==\n";
+    for (const Row& r : modeRows) {
+        out << "  " << std::left << std::setw(14) << addrModeName(static_cast<AddrMode>(r.key)) << std::right
+            << std::setw(12) << r.count << std::setw(14) << r.cycles
+            << std::setw(7) << percent(r.cycles, totalCycles) << "\n";
+    }
+
+    out << "\n== Hot addresses (top " << topN << " by cycles) ==\n";
+    for (size_t i = 0; i < pcs.size() && i < topN; ++i) {
+        const Row& r = pcs[i];
+        out << "  $" << std::hex << std::uppercase << std::setw(4) << std::setfill('0') << r.key
+            << std::dec << std::setfill(' ') << std::setw(12) << r.count << std::setw(14) << r.cycles
+            << std::setw(7) << percent(r.cycles, totalCycles) << "\n";
+    }
+}
+
+void Profiler::writeCSV(std::ostream& out) const {
+    std::array<Row, static_cast<size_t>(AddrMode::COUNT)> modes{};
+    out << "kind,key,mnemonic,mode,count,cycles\n";
+    for (int op = 0; op < 256; ++op) {
+        Row& mode = modes[static_cast<size_t>(OPCODES[op].mode)];
+        mode.count += opcodeCount[op];
+        mode.cycles += opcodeCycles[op];
+        if (opcodeCount[op]) {
+            out << "opcode," << op << "," << OPCODES[op].mnemonic << "," << addrModeName(OPCODES[op].mode)
+                << "," << opcodeCount[op] << "," << opcodeCycles[op] << "\n";
+        }
+    }
+    for (size_t m = 0; m < modes.size(); ++m) {
+        if (modes[m].count) {
+            out << "mode," << m << ",," << addrModeName(static_cast<AddrMode>(m))
+                << "," << modes[m].count << "," << modes[m].cycles << "\n";
+        }
+    }
+    for (uint32_t pc = 0; pc < 0x10000; ++pc) {
+        if (pcCount[pc]) {
+            out << "pc," << pc << ",,," << pcCount[pc] << "," << pcCycles[pc] << "\n";
+        }
+    }
+}
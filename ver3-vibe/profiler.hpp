@@ -0,0 +1,33 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <string>
+
+// Flat execution profiler. CPU::execute feeds it one record per instruction
+// when the emulator is built with -DCPU_PROFILER (cmake -DENABLE_PROFILER=ON);
+// otherwise the hook macros in cpu.cpp expand to nothing.
+class Profiler {
+public:
+    void record(uint16_t pc, uint8_t opcode, uint32_t cycles) {
+        opcodeCount[opcode]++;
+        opcodeCycles[opcode] += cycles;
+        pcCount[pc]++;
+        pcCycles[pc] += cycles;
+    }
+
+    void clear();
+
+    // Writes a CSV dump if the filename ends in ".csv", a sorted text report
+    // otherwise. Returns false if the file cannot be opened.
+    bool write(const std::string& filename, size_t topN = 50) const;
+
+    std::array<uint64_t, 256> opcodeCount{};
+    std::array<uint64_t, 256> opcodeCycles{};
+    std::array<uint64_t, 0x10000> pcCount{};
+    std::array<uint64_t, 0x10000> pcCycles{};
+
+private:
+    void writeReport(std::ostream& out, size_t topN) const;
+    void writeCSV(std::ostream& out) const;
+};
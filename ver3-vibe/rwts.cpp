@@ -0,0 +1,108 @@
+#include "rwts.hpp"
+#include "cpu.hpp"
+#include "disk2.hpp"
+#include "memory.hpp"
+
+namespace {
+
+// RWTS code that is identical across DOS 3.3 copies: the nibble routines at
+// $B800-$BAFF and the RWTS body at $BD00-$BEAE. The buffers in between and
+// the tables above vary.
+constexpr uint16_t CODE_RANGES[][2] = {{0xB800, 0xBAFF}, {0xBD00, 0xBEAE}};
+
+// IOB offsets
+constexpr int IOB_TYPE = 0x00;
+constexpr int IOB_SLOT = 0x01;
+constexpr int IOB_DRIVE = 0x02;
+constexpr int IOB_VOLUME = 0x03;
+constexpr int IOB_TRACK = 0x04;
+constexpr int IOB_SECTOR = 0x05;
+constexpr int IOB_BUFFER = 0x08;
+constexpr int IOB_COMMAND = 0x0C;
+constexpr int IOB_STATUS = 0x0D;
+constexpr int IOB_VOLUME_FOUND = 0x0E;
+constexpr int IOB_PREV_SLOT = 0x0F;
+constexpr int IOB_PREV_DRIVE = 0x10;
+
+constexpr uint8_t CMD_SEEK = 0;
+constexpr uint8_t CMD_READ = 1;
+constexpr uint8_t CMD_WRITE = 2;
+
+} // namespace
+
+const uint32_t RwtsTrap::STOCK_CHECKSUM = 0x7268DFF5;
+
+RwtsTrap::RwtsTrap(Memory& mem, Disk2& disk, int slot) : memory(mem), disk(disk), slot(slot) {}
+
+// FNV-1a over the code ranges.
+uint32_t RwtsTrap::checksum() const {
+    uint32_t hash = 2166136261u;
+    for (const auto& range : CODE_RANGES) {
+        for (uint32_t addr = range[0]; addr <= range[1]; ++addr) {
+            hash = (hash ^ memory.data[addr]) * 16777619u;
+        }
+    }
+    return hash;
+}
+
+bool RwtsTrap::handle(CPU& cpu) {
+    if (checksum() != expectedChecksum || !perform(cpu.y | (cpu.a << 8))) {
+        fallbacks++;
+        return false;
+    }
+    handled++;
+
+    uint16_t iob = cpu.y | (cpu.a << 8);
+    uint8_t status = memory.read(iob + IOB_STATUS);
+    cpu.a = status;
+    cpu.ps = status == OK ? (cpu.ps & ~CPU::AF_CARRY) : (cpu.ps | CPU::AF_CARRY);
+
+    // RTS
+    uint8_t lo = memory.read(0x0100 | ++cpu.sp);
+    uint8_t hi = memory.read(0x0100 | ++cpu.sp);
+    cpu.pc = ((hi << 8) | lo) + 1;
+    return true;
+}
+
+// Carries out the IOB request, or returns false if the real RWTS should.
+bool RwtsTrap::perform(uint16_t iob) {
+    auto byte = [&](int offset) { return memory.read(iob + offset); };
+    uint8_t command = byte(IOB_COMMAND);
+    int drive = byte(IOB_DRIVE) - 1;
+    uint8_t track = byte(IOB_TRACK);
+    uint8_t sector = byte(IOB_SECTOR);
+    uint8_t volume = byte(IOB_VOLUME);
+    uint16_t buffer = byte(IOB_BUFFER) | (byte(IOB_BUFFER + 1) << 8);
+
+    if (byte(IOB_TYPE) != 1 || byte(IOB_SLOT) != slot * 16 || drive < 0 || drive >= Disk2::DRIVES ||
+        !disk.hasDisk(drive) || disk.isBitstream(drive) || track >= gcr::TRACKS || sector >= gcr::SECTORS ||
+        (command != CMD_SEEK && command != CMD_READ && command != CMD_WRITE)) {
+        return false;
+    }
+
+    uint8_t status = OK;
+    uint8_t data[gcr::SECTOR_SIZE];
+    if (volume != 0 && volume != gcr::DEFAULT_VOLUME) {
+        status = VOLUME_MISMATCH;
+    } else if (command == CMD_READ) {
+        disk.readSector(drive, track, sector, data);
+        for (size_t i = 0; i < gcr::SECTOR_SIZE; ++i) {
+            memory.write(buffer + i, data[i]);
+        }
+    } else if (command == CMD_WRITE) {
+        for (size_t i = 0; i < gcr::SECTOR_SIZE; ++i) {
+            data[i] = memory.read(buffer + i);
+        }
+        if (!disk.writeSector(drive, track, sector, data)) {
+            status = WRITE_PROTECTED;
+        }
+    }
+
+    memory.write(iob + IOB_STATUS, status);
+    memory.write(iob + IOB_VOLUME_FOUND, gcr::DEFAULT_VOLUME);
+    memory.write(iob + IOB_PREV_SLOT, slot * 16);
+    memory.write(iob + IOB_PREV_DRIVE, drive + 1);
+    // RWTS leaves the motor off
+    memory.read(0xC088 + slot * 16);
+    return true;
+}
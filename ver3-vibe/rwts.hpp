@@ -0,0 +1,44 @@
+#pragma once
+
+#include <cstdint>
+
+class CPU;
+class Disk2;
+class Memory;
+
+// High-level trap for DOS 3.3's RWTS. When the CPU reaches the RWTS entry
+// point with a valid IOB (pointer in A/Y), the sector is copied between the
+// disk image and the IOB buffer directly and RWTS returns at once with the
+// status DOS expects. Anything the trap does not recognize -- modified RWTS
+// code (detected by checksum), another slot, FORMAT, a bad IOB -- falls
+// through to the emulated RWTS running against the real controller.
+class RwtsTrap {
+public:
+    static constexpr uint16_t ENTRY = 0xBD00;
+
+    // IOB return codes
+    static constexpr uint8_t OK = 0x00;
+    static constexpr uint8_t WRITE_PROTECTED = 0x10;
+    static constexpr uint8_t VOLUME_MISMATCH = 0x20;
+
+    RwtsTrap(Memory& mem, Disk2& disk, int slot = 6);
+
+    // Called with PC at ENTRY. Returns true if the request was handled and
+    // the CPU has been returned to the caller.
+    bool handle(CPU& cpu);
+
+    // Checksum of the RWTS code in memory, and the value for stock DOS 3.3.
+    uint32_t checksum() const;
+    static const uint32_t STOCK_CHECKSUM;
+    uint32_t expectedChecksum = STOCK_CHECKSUM; // RWTS code the trap accepts
+
+    uint64_t handled = 0;
+    uint64_t fallbacks = 0;
+
+private:
+    bool perform(uint16_t iob);
+
+    Memory& memory;
+    Disk2& disk;
+    int slot;
+};
@@ -0,0 +1,168 @@
+#include "savestate.hpp"
+#include "lz.hpp"
+#include <bit>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+
+static_assert(std::endian::native == std::endian::little, "save states are written in host byte order");
+
+namespace savestate {
+
+namespace {
+
+constexpr char MAGIC[8] = {'A', '2', 'S', 'T', 'A', 'T', 'E', 0};
+constexpr uint32_t FORMAT_VERSION = 1;
+constexpr size_t ALIGN = 16;
+
+struct FileHeader {
+    char magic[8];
+    uint32_t version;
+    uint32_t chunks;
+};
+
+struct ChunkHeader {
+    char id[4];
+    uint16_t version;
+    uint16_t flags;
+    uint32_t size;
+    uint32_t storedSize;
+    uint32_t reserved;
+};
+
+static_assert(sizeof(FileHeader) == 16 && sizeof(ChunkHeader) == 20);
+
+size_t padded(size_t size) {
+    return (size + ALIGN - 1) & ~(ALIGN - 1);
+}
+
+} // namespace
+
+void Writer::add(const char id[4], uint16_t version, const void* data, size_t size, bool compress) {
+    const uint8_t* bytes = static_cast<const uint8_t*>(data);
+    std::vector<uint8_t> packed;
+    if (compress) {
+        packed = lzCompress(bytes, size);
+    }
+    bool useLz = compress && packed.size() < size;
+    const uint8_t* payload = useLz ? packed.data() : bytes;
+
+    ChunkHeader header{};
+    memcpy(header.id, id, 4);
+    header.version = version;
+    header.flags = useLz ? LZ : 0;
+    header.size = static_cast<uint32_t>(size);
+    header.storedSize = static_cast<uint32_t>(useLz ? packed.size() : size);
+
+    // Header and payload each start on an ALIGN boundary.
+    size_t at = chunks.size();
+    chunks.resize(at + padded(sizeof(header)) + padded(header.storedSize));
+    memcpy(&chunks[at], &header, sizeof(header));
+    if (header.storedSize) {
+        memcpy(&chunks[at + padded(sizeof(header))], payload, header.storedSize);
+    }
+    count++;
+}
+
+bool Writer::write(const std::string& filename) const {
+    std::string temporary = filename + ".tmp";
+    {
+        std::ofstream out(temporary, std::ios::binary | std::ios::trunc);
+        if (!out) {
+            return false;
+        }
+        FileHeader header{};
+        memcpy(header.magic, MAGIC, sizeof(MAGIC));
+        header.version = FORMAT_VERSION;
+        header.chunks = count;
+        out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+        out.write(reinterpret_cast<const char*>(chunks.data()), chunks.size());
+        if (!out.flush()) {
+            std::remove(temporary.c_str());
+            return false;
+        }
+    }
+    return std::rename(temporary.c_str(), filename.c_str()) == 0;
+}
+
+bool Reader::open(const std::string& filename, std::string* error) {
+    auto fail = [&](const char* message) {
+        if (error) {
+            *error = message;
+        }
+        file.close();
+        chunks.clear();
+        return false;
+    };
+    chunks.clear();
+    if (!file.open(filename, false)) {
+        return fail("cannot open file");
+    }
+    const uint8_t* data = file.data();
+    size_t length = file.size();
+    FileHeader header;
+    if (length < sizeof(header)) {
+        return fail("not a save state");
+    }
+    memcpy(&header, data, sizeof(header));
+    if (memcmp(header.magic, MAGIC, sizeof(MAGIC)) != 0) {
+        return fail("not a save state");
+    }
+    if (header.version != FORMAT_VERSION) {
+        return fail("unsupported save state version");
+    }
+
+    size_t at = sizeof(header);
+    for (uint32_t i = 0; i < header.chunks; ++i) {
+        ChunkHeader chunk;
+        if (at > length || length - at < sizeof(chunk)) {
+            return fail("truncated save state");
+        }
+        memcpy(&chunk, data + at, sizeof(chunk));
+        at += padded(sizeof(chunk));
+        if (at > length || length - at < chunk.storedSize) {
+            return fail("truncated save state");
+        }
+        Chunk c;
+        memcpy(c.id, chunk.id, 4);
+        c.version = chunk.version;
+        c.flags = chunk.flags;
+        c.size = chunk.size;
+        c.storedSize = chunk.storedSize;
+        c.payload = data + at;
+        chunks.push_back(c);
+        at += padded(chunk.storedSize);
+    }
+    return true;
+}
+
+const Reader::Chunk* Reader::find(const char id[4]) const {
+    for (const Chunk& chunk : chunks) {
+        if (memcmp(chunk.id, id, 4) == 0) {
+            return &chunk;
+        }
+    }
+    return nullptr;
+}
+
+size_t Reader::size(const char id[4]) const {
+    const Chunk* chunk = find(id);
+    return chunk ? chunk->size : 0;
+}
+
+bool Reader::read(const char id[4], uint16_t version, void* data, size_t size) const {
+    const Chunk* chunk = find(id);
+    if (!chunk || chunk->version != version || chunk->size != size) {
+        return false;
+    }
+    if (chunk->flags & LZ) {
+        return lzDecompress(chunk->payload, chunk->storedSize, static_cast<uint8_t*>(data), size);
+    }
+    if (chunk->storedSize != size) {
+        return false;
+    }
+    memcpy(data, chunk->payload, size);
+    return true;
+}
+
+} // namespace savestate
@@ -0,0 +1,66 @@
+#pragma once
+
+#include "mapped_file.hpp"
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// Chunked save-state files.
+//
+//   header  "A2STATE\0", u32 format version, u32 chunk count
+//   chunk   4-char id, u16 payload version, u16 flags, u32 size,
+//           u32 stored size, u32 reserved, then the payload
+//
+// Chunk headers and payloads start on 16-byte boundaries.
+//
+// A payload is stored as is, or LZ-compressed (flag LZ) when asked for and
+// smaller. Readers map the file and index the chunks in place: a stored
+// payload is copied straight out of the mapping and unknown chunks are
+// skipped, so chunks can be added without breaking older readers. A chunk's
+// version changes whenever its layout does. Fields are little-endian.
+namespace savestate {
+
+constexpr uint16_t LZ = 0x1;
+
+class Writer {
+public:
+    void add(const char id[4], uint16_t version, const void* data, size_t size, bool compress = false);
+    // Writes to a temporary file and renames it over `filename`, so an
+    // interrupted save never leaves a truncated state behind.
+    bool write(const std::string& filename) const;
+
+private:
+    std::vector<uint8_t> chunks;
+    uint32_t count = 0;
+};
+
+class Reader {
+public:
+    // On failure returns false and, if given, sets `error`.
+    bool open(const std::string& filename, std::string* error = nullptr);
+
+    bool has(const char id[4]) const { return find(id) != nullptr; }
+    // Payload size of chunk `id`, or 0 if there is none.
+    size_t size(const char id[4]) const;
+    // Copies or decompresses exactly `size` bytes of chunk `id`. False if
+    // the chunk is missing, has another version or size, or is corrupt.
+    bool read(const char id[4], uint16_t version, void* data, size_t size) const;
+
+private:
+    struct Chunk {
+        char id[4];
+        uint16_t version;
+        uint16_t flags;
+        uint32_t size;
+        uint32_t storedSize;
+        const uint8_t* payload;
+    };
+
+    const Chunk* find(const char id[4]) const;
+
+    MappedFile file;
+    std::vector<Chunk> chunks;
+};
+
+} // namespace savestate
@@ -0,0 +1,171 @@
+#include "speaker.hpp"
+#include <algorithm>
+#include <cmath>
+
+namespace {
+
+constexpr int PHASES = 32;     // sub-sample positions
+constexpr int TAPS = 16;       // kernel width in samples
+constexpr float CUTOFF = 0.9f; // fraction of Nyquist
+constexpr float DC_BLOCK = 0.999f;
+constexpr double MAX_LATENCY = 0.1;    // seconds of emulated audio before skipping
+constexpr double TARGET_LATENCY = 0.03; // where a skip lands
+
+// Blackman-windowed sinc impulses, one row per sub-sample phase, each
+// normalised to unit sum so integrating them yields a clean step.
+struct BlepTable {
+    float kernel[PHASES][TAPS];
+    BlepTable() {
+        const double pi = 3.14159265358979323846;
+        for (int p = 0; p < PHASES; ++p) {
+            double sum = 0;
+            for (int k = 0; k < TAPS; ++k) {
+                double d = (k - (TAPS / 2 - 1)) - double(p) / PHASES;
+                double x = d * CUTOFF;
+                double sinc = x == 0 ? 1.0 : std::sin(pi * x) / (pi * x);
+                double w = 0.42 + 0.5 * std::cos(pi * d / (TAPS / 2)) + 0.08 * std::cos(2 * pi * d / (TAPS / 2));
+                kernel[p][k] = static_cast<float>(sinc * std::max(w, 0.0));
+                sum += kernel[p][k];
+            }
+            for (int k = 0; k < TAPS; ++k) {
+                kernel[p][k] = static_cast<float>(kernel[p][k] / sum);
+            }
+        }
+    }
+};
+const BlepTable BLEP;
+
+} // namespace
+
+Speaker::Speaker(const uint64_t& clock, int sampleRate, double clockHz)
+    : clock(clock), rate(sampleRate), cyclesPerSample(clockHz / sampleRate), ring(CAPACITY),
+      reached(clock), played(clock), cursor(static_cast<double>(clock)), deltas(DELTA_RING) {}
+
+size_t Speaker::available() const {
+    return samplesBetween(static_cast<double>(played.load(std::memory_order_acquire)),
+                          reached.load(std::memory_order_acquire));
+}
+
+size_t Speaker::samplesBetween(double from, uint64_t to) const {
+    double ahead = static_cast<double>(to) - from;
+    return ahead > 0 ? static_cast<size_t>(ahead / cyclesPerSample) : 0;
+}
+
+// The cursor itself stays consumer-owned; the producer sees it through
+// `played`.
+void Speaker::setCursor(double cycle) {
+    cursor = cycle;
+    played.store(static_cast<uint64_t>(cycle), std::memory_order_release);
+}
+
+void Speaker::render(int16_t* out, size_t frames) {
+    double limit = MAX_LATENCY * rate * cyclesPerSample;
+    double now = static_cast<double>(reached.load(std::memory_order_acquire));
+    if (now - cursor > limit) {
+        skipTo(now - TARGET_LATENCY * rate * cyclesPerSample);
+    }
+    while (frames > 0) {
+        size_t n = std::min(frames, DELTA_RING - TAPS);
+        renderChunk(out, n);
+        out += n;
+        frames -= n;
+    }
+}
+
+// Drops toggles before `cycle`, keeping the cone where they left it.
+void Speaker::skipTo(double cycle) {
+    size_t head = published.load(std::memory_order_acquire);
+    bool flip = false;
+    while (tail != head && static_cast<double>(ring[tail & MASK]) < cycle) {
+        flip = !flip;
+        tail++;
+    }
+    consumed.store(tail, std::memory_order_release);
+    if (flip) {
+        deltas[deltaPos] += -2 * level;
+        level = -level;
+    }
+    setCursor(cycle);
+}
+
+void Speaker::renderChunk(int16_t* out, size_t frames) {
+    size_t renderable = std::min(frames, samplesBetween(cursor, reached.load(std::memory_order_acquire)));
+    double end = cursor + renderable * cyclesPerSample;
+    size_t head = published.load(std::memory_order_acquire);
+    while (tail != head) {
+        double t = static_cast<double>(ring[tail & MASK]);
+        if (t >= end) {
+            break;
+        }
+        double pos = std::max(0.0, (t - cursor) / cyclesPerSample);
+        size_t whole = static_cast<size_t>(pos);
+        int phase = std::min(PHASES - 1, static_cast<int>((pos - whole) * PHASES));
+        float delta = -2 * level;
+        level = -level;
+        const float* k = BLEP.kernel[phase];
+        for (int i = 0; i < TAPS; ++i) {
+            deltas[(deltaPos + whole + i) & (DELTA_RING - 1)] += delta * k[i];
+        }
+        tail++;
+    }
+    consumed.store(tail, std::memory_order_release);
+    setCursor(end);
+    if (renderable < frames) {
+        starvedSamples.fetch_add(frames - renderable, std::memory_order_relaxed);
+    }
+
+    for (size_t i = 0; i < frames; ++i) {
+        float& d = deltas[deltaPos];
+        integrator += d;
+        d = 0;
+        deltaPos = (deltaPos + 1) & (DELTA_RING - 1);
+        // The real speaker cannot hold a level; block DC so an idle cone is silent.
+        lastOut = integrator - lastIn + DC_BLOCK * lastOut;
+        lastIn = integrator;
+        float v = std::clamp(lastOut, -1.0f, 1.0f);
+        out[i] = static_cast<int16_t>(v * 32767);
+    }
+}
+
+bool WavWriter::open(const std::string& filename, int sampleRate) {
+    close();
+    file.open(filename, std::ios::binary | std::ios::trunc);
+    if (!file) {
+        return false;
+    }
+    auto u32 = [&](uint32_t v) { file.write(reinterpret_cast<const char*>(&v), 4); };
+    auto u16 = [&](uint16_t v) { file.write(reinterpret_cast<const char*>(&v), 2); };
+    file.write("RIFF", 4);
+    u32(36); // patched by close()
+    file.write("WAVEfmt ", 8);
+    u32(16);
+    u16(1); // PCM
+    u16(1); // mono
+    u32(sampleRate);
+    u32(sampleRate * 2);
+    u16(2);
+    u16(16);
+    file.write("data", 4);
+    u32(0);
+    dataBytes = 0;
+    return static_cast<bool>(file);
+}
+
+void WavWriter::write(const int16_t* samples, size_t count) {
+    if (file.is_open()) {
+        file.write(reinterpret_cast<const char*>(samples), count * sizeof(int16_t));
+        dataBytes += static_cast<uint32_t>(count * sizeof(int16_t));
+    }
+}
+
+void WavWriter::close() {
+    if (!file.is_open()) {
+        return;
+    }
+    uint32_t riff = 36 + dataBytes;
+    file.seekp(4);
+    file.write(reinterpret_cast<const char*>(&riff), 4);
+    file.seekp(40);
+    file.write(reinterpret_cast<const char*>(&dataBytes), 4);
+    file.close();
+}
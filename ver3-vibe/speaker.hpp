@@ -0,0 +1,103 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <fstream>
+#include <string>
+#include <vector>
+
+// Apple II speaker ($C030). Every access flips the cone, so the only thing
+// worth recording is when: toggle() appends the current CPU cycle to a
+// single-producer/single-consumer ring, which costs one store. The consumer
+// (the SDL audio callback, or the main loop when writing a WAV) turns the
+// toggles into band-limited steps with a precomputed BLEP kernel.
+//
+// The audio cursor never runs ahead of the emulated time published by
+// endFrame(); if emulation gets far ahead (disk warp, turbo) the cursor
+// skips forward so latency stays bounded.
+class Speaker {
+public:
+    static constexpr size_t CAPACITY = size_t(1) << 16; // toggles, power of two
+    static constexpr int DEFAULT_SAMPLE_RATE = 44100;
+    static constexpr double DEFAULT_CLOCK_HZ = 1020484.0; // NTSC
+
+    explicit Speaker(const uint64_t& clock, int sampleRate = DEFAULT_SAMPLE_RATE,
+                     double clockHz = DEFAULT_CLOCK_HZ);
+    Speaker(const Speaker&) = delete;
+    Speaker& operator=(const Speaker&) = delete;
+
+    // Producer side (emulation thread)
+    void toggle() {
+        if (head - cachedTail > MASK) {
+            cachedTail = consumed.load(std::memory_order_acquire);
+            if (head - cachedTail > MASK) {
+                droppedToggles.fetch_add(1, std::memory_order_relaxed);
+                return;
+            }
+        }
+        ring[head & MASK] = clock;
+        head++;
+        published.store(head, std::memory_order_release);
+    }
+    // Marks everything up to the current cycle as final and renderable.
+    void endFrame() { reached.store(clock, std::memory_order_release); }
+
+    // Consumer side (audio thread). Fills `frames` mono samples; samples
+    // past the published emulated time repeat the current level.
+    void render(int16_t* out, size_t frames);
+    // Samples that can be rendered from emulated time already published.
+    // Safe from either thread: reads only atomics.
+    size_t available() const;
+
+    int sampleRate() const { return rate; }
+    uint64_t dropped() const { return droppedToggles.load(std::memory_order_relaxed); }
+    uint64_t underruns() const { return starvedSamples.load(std::memory_order_relaxed); }
+
+private:
+    static constexpr size_t MASK = CAPACITY - 1;
+    static constexpr size_t DELTA_RING = 4096; // samples, power of two
+
+    void renderChunk(int16_t* out, size_t frames);
+    void skipTo(double cycle);
+    void setCursor(double cycle);
+    size_t samplesBetween(double from, uint64_t to) const;
+
+    const uint64_t& clock;
+    const int rate;
+    const double cyclesPerSample;
+    std::vector<uint64_t> ring;
+
+    // Producer-owned
+    alignas(64) size_t head = 0;
+    size_t cachedTail = 0;
+    // Shared
+    alignas(64) std::atomic<size_t> published{0};
+    std::atomic<uint64_t> reached{0};
+    alignas(64) std::atomic<size_t> consumed{0};
+    std::atomic<uint64_t> played{0}; // whole cycles of `cursor`, for available()
+    std::atomic<uint64_t> droppedToggles{0};
+    std::atomic<uint64_t> starvedSamples{0};
+    // Consumer-owned
+    alignas(64) size_t tail = 0;
+    double cursor = 0;   // emulated cycle of the next output sample
+    float level = 0.25f; // current cone position
+    std::vector<float> deltas; // band-limited steps not yet integrated
+    size_t deltaPos = 0;
+    float integrator = 0;
+    float lastIn = 0;  // DC blocker state
+    float lastOut = 0;
+};
+
+// Minimal 16-bit mono PCM WAV file writer.
+class WavWriter {
+public:
+    ~WavWriter() { close(); }
+    bool open(const std::string& filename, int sampleRate);
+    void write(const int16_t* samples, size_t count);
+    void close(); // patches the header sizes
+
+private:
+    std::ofstream file;
+    uint32_t dataBytes = 0;
+};
@@ -0,0 +1,46 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+
+// Bounded lock-free queue for exactly one producer and one consumer thread.
+// push() fails instead of waiting when the queue is full.
+template <typename T, size_t CAPACITY>
+class SpscQueue {
+    static_assert((CAPACITY & (CAPACITY - 1)) == 0, "CAPACITY must be a power of two");
+
+public:
+    bool push(const T& value) {
+        size_t h = head.load(std::memory_order_relaxed);
+        if (h - cachedTail == CAPACITY) {
+            cachedTail = tail.load(std::memory_order_acquire);
+            if (h - cachedTail == CAPACITY) {
+                return false;
+            }
+        }
+        items[h & (CAPACITY - 1)] = value;
+        head.store(h + 1, std::memory_order_release);
+        return true;
+    }
+
+    bool pop(T& value) {
+        size_t t = tail.load(std::memory_order_relaxed);
+        if (t == cachedHead) {
+            cachedHead = head.load(std::memory_order_acquire);
+            if (t == cachedHead) {
+                return false;
+            }
+        }
+        value = items[t & (CAPACITY - 1)];
+        tail.store(t + 1, std::memory_order_release);
+        return true;
+    }
+
+private:
+    std::array<T, CAPACITY> items{};
+    alignas(64) std::atomic<size_t> head{0}; // written by the producer
+    size_t cachedTail = 0;                    // producer's last view of tail
+    alignas(64) std::atomic<size_t> tail{0}; // written by the consumer
+    size_t cachedHead = 0;                    // consumer's last view of head
+};
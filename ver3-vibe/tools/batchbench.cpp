@@ -0,0 +1,122 @@
+// Throughput of the batched 6502 engine against the scalar core.
+//
+//   batchbench [--lanes N] [--cycles N]
+//
+// Two workloads, each run for N lanes x cycles:
+//   lockstep  one kernel (ADC/EOR/ROL/STA loop) in every lane, seeded with
+//             different data, as in exhaustive tests: lanes stay in step
+//   random    a different random program in every lane, as in fuzzing:
+//             lanes diverge after the first few instructions
+// and three engines: CPU::execute one instance at a time, BatchCPU one lane
+// at a time, and BatchCPU stepping groups of 8 lanes together. Results are in
+// instance-instructions per second.
+#include "../batch_cpu.hpp"
+#include "../cpu.hpp"
+#include "../memory.hpp"
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <random>
+
+namespace {
+
+constexpr uint16_t PROGRAM_START = 0x0200;
+
+const uint8_t KERNEL[] = {
+    0xA2, 0x00,       // LDX #0
+    0x8A,             // TXA
+    0x65, 0x10,       // ADC $10
+    0x9D, 0x00, 0x03, // STA $0300,X
+    0x45, 0x11,       // EOR $11
+    0x2A,             // ROL A
+    0x85, 0x11,       // STA $11
+    0xE8,             // INX
+    0xD0, 0xF2,       // BNE $0202
+    0xE6, 0x12,       // INC $12
+    0x4C, 0x00, 0x02, // JMP $0200
+};
+
+void setUp(BatchCPU& batch, bool lockstep) {
+    std::mt19937 rng(1);
+    for (size_t lane = 0; lane < batch.lanes(); ++lane) {
+        uint8_t* mem = batch.memory(lane);
+        for (size_t i = 0; i < batch.memorySize(); ++i) {
+            mem[i] = static_cast<uint8_t>(rng());
+        }
+        if (lockstep) {
+            memcpy(mem + PROGRAM_START, KERNEL, sizeof(KERNEL));
+        }
+        for (size_t vector = batch.memorySize() - 6; vector < batch.memorySize(); vector += 2) {
+            mem[vector] = PROGRAM_START & 0xFF;
+            mem[vector + 1] = PROGRAM_START >> 8;
+        }
+        batch.pc[lane] = PROGRAM_START;
+        batch.sp[lane] = 0xFF;
+    }
+}
+
+double seconds(std::chrono::steady_clock::time_point start) {
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+// Each instance copied into one Memory and run to the same cycle budget.
+double scalarRate(const BatchCPU& batch, uint32_t cycles) {
+    Memory mem;
+    CPU cpu(mem);
+    uint64_t instructions = 0;
+    auto start = std::chrono::steady_clock::now();
+    for (size_t lane = 0; lane < batch.lanes(); ++lane) {
+        memcpy(mem.data.data(), batch.memory(lane), batch.memorySize());
+        cpu.a = cpu.x = cpu.y = 0;
+        cpu.ps = CPU::AF_RESERVED;
+        cpu.sp = 0xFF;
+        cpu.pc = PROGRAM_START;
+        cpu.cycles = 0;
+        while (cpu.cycles < cycles) {
+            cpu.execute(1);
+            instructions++;
+        }
+    }
+    return instructions / seconds(start);
+}
+
+double batchRate(BatchCPU& batch, uint32_t cycles, bool vectorized) {
+    batch.vectorized = vectorized;
+    auto start = std::chrono::steady_clock::now();
+    batch.execute(cycles);
+    return batch.instructions() / seconds(start);
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    size_t lanes = 1024;
+    uint32_t cycles = 200000;
+    for (int i = 1; i < argc; ++i) {
+        if (strcmp(argv[i], "--lanes") == 0 && i + 1 < argc) {
+            lanes = strtoull(argv[++i], nullptr, 0);
+        } else if (strcmp(argv[i], "--cycles") == 0 && i + 1 < argc) {
+            cycles = static_cast<uint32_t>(strtoul(argv[++i], nullptr, 0));
+        } else {
+            fprintf(stderr, "Usage: %s [--lanes N] [--cycles N]\n", argv[0]);
+            return 2;
+        }
+    }
+
+    printf("%zu lanes x %u cycles, 4K per lane, group steps %s\n", lanes, cycles,
+           BatchCPU::usesAvx2() ? "AVX2" : "portable (build with AVX2 for SIMD)");
+    for (bool lockstep : {true, false}) {
+        BatchCPU perLane(lanes);
+        BatchCPU grouped(lanes);
+        setUp(perLane, lockstep);
+        setUp(grouped, lockstep);
+        double scalar = scalarRate(grouped, cycles);
+        double single = batchRate(perLane, cycles, false);
+        double group = batchRate(grouped, cycles, true);
+        printf("%-9s CPU %7.1f M/s | lane by lane %7.1f M/s (%.2fx) | grouped %7.1f M/s (%.2fx, %.0f%% in groups)\n",
+               lockstep ? "lockstep" : "random", scalar / 1e6, single / 1e6, single / scalar, group / 1e6,
+               group / scalar, 100.0 * grouped.groupSteps * BatchCPU::GROUP / grouped.instructions());
+    }
+    return 0;
+}
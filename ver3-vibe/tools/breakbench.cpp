@@ -0,0 +1,114 @@
+// Cost of breakpoints in a hot loop.
+//
+//   breakbench [--cycles N] [--runs N]
+//
+// Runs "loop: INX / BNE loop / INY / JMP loop" at $0300, which comes back
+// to $0300 every 5 cycles, and reports emulated MHz (best of --runs) for:
+//   none        no breakpoints
+//   same page   a breakpoint elsewhere on the loop's page
+//   false       a breakpoint at $0300 whose condition never holds: a
+//               register test, then the three-term example with every
+//               term evaluated, as range tests and (parenthesized) as
+//               bytecode
+//   ignored     an unconditional breakpoint at $0300 with a huge ignore
+//               count
+#include "../breakpoints.hpp"
+#include "../cpu.hpp"
+#include "../memory.hpp"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <functional>
+#include <memory>
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+constexpr uint16_t LOOP = 0x0300;
+
+struct Bench {
+    Memory memory;
+    CPU cpu{memory};
+    Breakpoints breakpoints{memory};
+
+    Bench() {
+        const uint8_t program[] = {0xE8, 0xD0, 0xFD, 0xC8, 0x4C, 0x00, 0x03};
+        for (size_t i = 0; i < sizeof(program); ++i) {
+            memory.poke(static_cast<uint16_t>(LOOP + i), program[i]);
+        }
+        cpu.reset();
+        cpu.pc = LOOP;
+        cpu.a = 0x8D; // the example's first two terms hold
+        cpu.breakpoints = &breakpoints;
+    }
+};
+
+double megahertz(const std::function<void(Bench&)>& setup, uint64_t cycles, int runs) {
+    double best = 0;
+    for (int run = 0; run < runs; ++run) {
+        auto bench = std::make_unique<Bench>();
+        setup(*bench);
+        Clock::time_point start = Clock::now();
+        bench->cpu.execute(static_cast<uint32_t>(cycles));
+        double seconds = std::chrono::duration<double>(Clock::now() - start).count();
+        if (bench->breakpoints.stopped()) {
+            fprintf(stderr, "Error: the loop stopped at $%04X\n", bench->cpu.pc);
+            exit(1);
+        }
+        best = std::max(best, double(bench->cpu.cycles) / seconds / 1e6);
+    }
+    return best;
+}
+
+void condition(Bench& bench, const char* text) {
+    bench.breakpoints.add(LOOP);
+    if (!bench.breakpoints.rule(LOOP).condition.compile(text)) {
+        fprintf(stderr, "Error: bad condition %s\n", text);
+        exit(1);
+    }
+}
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+    uint64_t cycles = 100000000;
+    int runs = 5;
+    for (int i = 1; i < argc; ++i) {
+        if (strcmp(argv[i], "--cycles") == 0 && i + 1 < argc) {
+            cycles = std::clamp<uint64_t>(strtoull(argv[++i], nullptr, 0), 1, UINT32_MAX);
+        } else if (strcmp(argv[i], "--runs") == 0 && i + 1 < argc) {
+            runs = std::max(1, atoi(argv[++i]));
+        } else {
+            fprintf(stderr, "Usage: %s [--cycles N] [--runs N]\n", argv[0]);
+            return 1;
+        }
+    }
+
+    struct Case {
+        const char* name;
+        std::function<void(Bench&)> setup;
+    };
+    const Case cases[] = {
+        {"none", [](Bench&) {}},
+        {"same page", [](Bench& bench) { bench.breakpoints.add(LOOP + 0x80); }},
+        {"false A==$00", [](Bench& bench) { condition(bench, "A==$00"); }},
+        {"false 3 terms", [](Bench& bench) { condition(bench, "PC=$0300 && A==$8D && mem[$24]>30"); }},
+        {"false bytecode", [](Bench& bench) { condition(bench, "(PC=$0300) && (A==$8D) && (mem[$24]>30)"); }},
+        {"ignored", [](Bench& bench) {
+             bench.breakpoints.add(LOOP);
+             bench.breakpoints.rule(LOOP).ignore = UINT32_MAX;
+         }},
+    };
+    double base = 0;
+    for (const Case& c : cases) {
+        double mhz = megahertz(c.setup, cycles, runs);
+        if (base == 0) {
+            base = mhz;
+        }
+        printf("%-14s %8.1f MHz  %5.2fx\n", c.name, mhz, base / mhz);
+    }
+    return 0;
+}
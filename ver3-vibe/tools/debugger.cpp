@@ -0,0 +1,97 @@
+// Headless debugger: a machine with no window and the debugger console on
+// stdin/stdout, for boot failures and scripted sessions.
+//
+//   debugger [--rom FILE] [--keys TEXT] [--state FILE] [--no-rwts] [IMAGE]
+//
+// Starts at the console before the first instruction (or where the state
+// file left off); "h" lists the commands. History is recorded from there,
+// so rs and rc can step back. The commands that run on (c, n, f,
+// u) run at full speed until a breakpoint or watchpoint stops the machine,
+// it waits for a key once the --keys text ("\n" means Return) is used up,
+// or it hangs on a JMP to itself.
+#include "../debugger.hpp"
+#include <cstdio>
+#include <cstring>
+#include <iostream>
+#include <string>
+
+namespace {
+
+constexpr uint64_t RUN_CYCLES = 1000000; // between checks for a hang or an idle machine
+
+std::string unescape(const std::string& text) {
+    std::string keys;
+    for (size_t i = 0; i < text.size(); ++i) {
+        if (text[i] == '\\' && i + 1 < text.size() && text[i + 1] == 'n') {
+            keys += '\n';
+            i++;
+        } else {
+            keys += text[i];
+        }
+    }
+    return keys;
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    std::string romPath = "Apple2_Plus.rom";
+    std::string keys;
+    std::string statePath;
+    std::string image;
+    bool rwtsTrap = true;
+    for (int i = 1; i < argc; ++i) {
+        if (strcmp(argv[i], "--rom") == 0 && i + 1 < argc) {
+            romPath = argv[++i];
+        } else if (strcmp(argv[i], "--keys") == 0 && i + 1 < argc) {
+            keys = unescape(argv[++i]);
+        } else if (strcmp(argv[i], "--state") == 0 && i + 1 < argc) {
+            statePath = argv[++i];
+        } else if (strcmp(argv[i], "--no-rwts") == 0) {
+            rwtsTrap = false;
+        } else if (argv[i][0] != '-' && image.empty()) {
+            image = argv[i];
+        } else {
+            fprintf(stderr, "Usage: %s [--rom FILE] [--keys TEXT] [--state FILE] [--no-rwts] [IMAGE]\n", argv[0]);
+            return 1;
+        }
+    }
+
+    std::vector<uint8_t> rom;
+    if (!Machine::loadRom(romPath, rom)) {
+        fprintf(stderr, "Error: Could not open ROM file: %s\n", romPath.c_str());
+        return 1;
+    }
+    Machine machine(rom, rwtsTrap);
+    if (!image.empty() && !machine.insertDisk(0, image)) {
+        fprintf(stderr, "Error: Could not open disk image: %s\n", image.c_str());
+        return 1;
+    }
+    if (!statePath.empty()) {
+        std::string error;
+        if (!machine.loadState(statePath, &error)) {
+            fprintf(stderr, "Error: %s: %s\n", statePath.c_str(), error.c_str());
+            return 1;
+        }
+    }
+    machine.type(keys);
+
+    History history(machine);
+    Debugger debugger(machine, &history);
+    debugger.breakIn(std::cout);
+    while (debugger.console(std::cin, std::cout) == Debugger::Action::Run) {
+        while (true) {
+            Machine::Exit exit = machine.run(RUN_CYCLES);
+            if (exit == Machine::Exit::Break) {
+                if (debugger.stopped(std::cout)) {
+                    break;
+                }
+            } else if (exit != Machine::Exit::Budget) {
+                std::cout << (exit == Machine::Exit::Idle ? "Waiting for a key" : "Hung") << "\n";
+                debugger.breakIn(std::cout);
+                break;
+            }
+        }
+    }
+    return 0;
+}
@@ -0,0 +1,204 @@
+// Lockstep differential test of the ver3 CPU against the ver1 CPU.
+//
+// Generates random programs (random 64 KB image and register file), runs
+// both cores one instruction at a time, and stops at the first instruction
+// whose registers, flags, cycle count or memory writes differ.
+//
+//   difftest [--seed N] [--instructions N] [--program-length N]
+//            [--check-interval N] [--exclude OP,OP,...] [--all-opcodes]
+//            [--strict-flags]
+#include "lockstep.hpp"
+#include "../opcodes.hpp"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <random>
+#include <sstream>
+#include <vector>
+
+namespace {
+
+struct Options {
+    uint64_t seed = 1;
+    uint64_t instructions = 10000000;
+    uint64_t programLength = 2000;
+    uint64_t checkInterval = 4096;
+    bool allOpcodes = false;
+    bool strictFlags = false;
+    bool excluded[256] = {};
+};
+
+void usage(const char* argv0) {
+    fprintf(stderr,
+            "Usage: %s [--seed N] [--instructions N] [--program-length N] [--check-interval N]\n"
+            "          [--exclude OP,OP,...] [--all-opcodes] [--strict-flags]\n",
+            argv0);
+}
+
+bool parseOptions(int argc, char** argv, Options& opt) {
+    for (int i = 1; i < argc; ++i) {
+        bool hasValue = i + 1 < argc;
+        if (strcmp(argv[i], "--seed") == 0 && hasValue) {
+            opt.seed = strtoull(argv[++i], nullptr, 0);
+        } else if (strcmp(argv[i], "--instructions") == 0 && hasValue) {
+            opt.instructions = strtoull(argv[++i], nullptr, 0);
+        } else if (strcmp(argv[i], "--program-length") == 0 && hasValue) {
+            opt.programLength = strtoull(argv[++i], nullptr, 0);
+        } else if (strcmp(argv[i], "--check-interval") == 0 && hasValue) {
+            opt.checkInterval = strtoull(argv[++i], nullptr, 0);
+        } else if (strcmp(argv[i], "--exclude") == 0 && hasValue) {
+            std::stringstream list(argv[++i]);
+            std::string op;
+            while (std::getline(list, op, ',')) {
+                opt.excluded[strtoul(op.c_str(), nullptr, 16) & 0xFF] = true;
+            }
+        } else if (strcmp(argv[i], "--all-opcodes") == 0) {
+            opt.allOpcodes = true;
+        } else if (strcmp(argv[i], "--strict-flags") == 0) {
+            opt.strictFlags = true;
+        } else {
+            return false;
+        }
+    }
+    if (opt.programLength == 0 || opt.checkInterval == 0) {
+        return false;
+    }
+    return true;
+}
+
+class DiffTest {
+public:
+    explicit DiffTest(const Options& options) : opt(options), lockstep(options.strictFlags), rng(options.seed) {
+        for (int op = 0; op < 256; ++op) {
+            bool documented = OPCODES[op].mnemonic[0] != '?';
+            if ((opt.allOpcodes || documented) && !opt.excluded[op]) {
+                allowed.push_back(static_cast<uint8_t>(op));
+            }
+        }
+        image.resize(Memory::ADDRESS_SPACE_SIZE);
+    }
+
+    int run() {
+        if (allowed.empty()) {
+            fprintf(stderr, "No opcodes left to test\n");
+            return 2;
+        }
+        auto start = std::chrono::steady_clock::now();
+        uint64_t programLeft = 0;
+        while (executed < opt.instructions) {
+            if (programLeft == 0) {
+                newProgram();
+                programLeft = opt.programLength;
+            }
+            uint64_t chunk = std::min({opt.checkInterval, programLeft, opt.instructions - executed});
+            if (!runChunk(chunk)) {
+                return 1;
+            }
+            executed += chunk;
+            programLeft -= chunk;
+        }
+        double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        printf("No divergence in %llu instructions over %llu programs (%.2f M instructions/s)\n",
+               static_cast<unsigned long long>(executed), static_cast<unsigned long long>(programs),
+               executed / seconds / 1e6);
+        return 0;
+    }
+
+private:
+    void newProgram() {
+        for (size_t i = 0; i < image.size(); i += 8) {
+            uint64_t r = rng();
+            memcpy(&image[i], &r, 8);
+        }
+        uint64_t r = rng();
+        Lockstep::Registers regs{uint8_t(r), uint8_t(r >> 8), uint8_t(r >> 16), uint8_t(r >> 24),
+                                 uint8_t(r >> 32), uint16_t(r >> 40)};
+        regs.p |= CPU::AF_RESERVED;
+        lockstep.load(image.data(), regs);
+        programs++;
+    }
+
+    // Rewrites a disallowed opcode at PC (in both cores) with an allowed one.
+    void patchOpcode() {
+        uint16_t pc = lockstep.cpu().pc;
+        uint8_t& op3 = lockstep.memory().data[pc];
+        if (std::binary_search(allowed.begin(), allowed.end(), op3)) {
+            return;
+        }
+        op3 = allowed[rng() % allowed.size()];
+        lockstep.reference().memory()[pc] = op3;
+    }
+
+    // Runs `count` instructions comparing registers each step and memory at
+    // the end. A memory mismatch rewinds to the start of the chunk and replays
+    // it comparing memory after every instruction to find the culprit.
+    bool runChunk(uint64_t count) {
+        auto saved3 = lockstep.memory().data;
+        std::vector<uint8_t> saved1(lockstep.reference().memory(),
+                                    lockstep.reference().memory() + Memory::ADDRESS_SPACE_SIZE);
+        Lockstep::Registers savedRegs = lockstep.registers();
+        std::mt19937_64 savedRng = rng;
+
+        std::string report;
+        for (uint64_t i = 0; i < count; ++i) {
+            patchOpcode();
+            if (!lockstep.step(report)) {
+                fail(executed + i, report);
+                return false;
+            }
+        }
+        if (lockstep.memoryMatches(report)) {
+            return true;
+        }
+
+        lockstep.memory().data = saved3;
+        memcpy(lockstep.reference().memory(), saved1.data(), saved1.size());
+        lockstep.setRegisters(savedRegs);
+        rng = savedRng;
+        for (uint64_t i = 0; i < count; ++i) {
+            patchOpcode();
+            Lockstep::Registers before = lockstep.registers();
+            uint16_t pc = before.pc;
+            uint8_t bytes[3] = {lockstep.memory().data[pc], lockstep.memory().data[uint16_t(pc + 1)],
+                                lockstep.memory().data[uint16_t(pc + 2)]};
+            lockstep.step(report);
+            if (!lockstep.memoryMatches(report)) {
+                char buf[128];
+                snprintf(buf, sizeof(buf), "instruction: %02X %02X %02X  %s\nbefore:      %s\n", bytes[0],
+                         bytes[1], bytes[2], OPCODES[bytes[0]].mnemonic, Lockstep::describe(before).c_str());
+                fail(executed + i, buf + report);
+                return false;
+            }
+        }
+        fail(executed, "memory differs at end of chunk but replay did not reproduce it\n" + report);
+        return false;
+    }
+
+    void fail(uint64_t index, const std::string& report) {
+        printf("DIVERGENCE at instruction %llu (program %llu, seed %llu)\n%s",
+               static_cast<unsigned long long>(index), static_cast<unsigned long long>(programs),
+               static_cast<unsigned long long>(opt.seed), report.c_str());
+    }
+
+    Options opt;
+    Lockstep lockstep;
+    std::mt19937_64 rng;
+    std::vector<uint8_t> allowed;
+    std::vector<uint8_t> image;
+    uint64_t executed = 0;
+    uint64_t programs = 0;
+};
+
+} // namespace
+
+int main(int argc, char** argv) {
+    Options opt;
+    if (!parseOptions(argc, argv, opt)) {
+        usage(argv[0]);
+        return 2;
+    }
+    DiffTest test(opt);
+    return test.run();
+}
@@ -0,0 +1,457 @@
+// Indexes a library of disk images on all cores.
+//
+//   diskindex [-j THREADS] [-o INDEX] PATH...   scan files/directories
+//   diskindex --list INDEX                      print an index as text
+//
+// Every .dsk/.do/.po/.woz/.nib image found is memory-mapped and identified:
+// sector order (from the directory structures, not just the extension),
+// DOS 3.3 / ProDOS / unknown, an FNV-1a hash of the boot sector, the DOS 3.3
+// volume and catalog or the ProDOS volume name. Bitstream images are first
+// decoded track by track. The index is written as one LZ-compressed block:
+//
+//   "DIDX" u32 version, u32 count, u32 rawSize, u32 packedSize, packed records
+//   record: u16 len, path | u8 format | u8 order | u64 bootHash | u8 volume |
+//           u8 len, label | u16 files | files x (u8 type, u16 sectors, u8 len, name)
+#include "../gcr.hpp"
+#include "../lz.hpp"
+#include "../mapped_file.hpp"
+#include "../woz.hpp"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace {
+
+constexpr uint32_t INDEX_VERSION = 1;
+constexpr int VTOC_TRACK = 17;
+constexpr int MAX_CATALOG_SECTORS = 64; // guards against looped chains
+constexpr int MAX_DIRECTORY_BLOCKS = 32;
+
+enum Format : uint8_t { UNKNOWN, DOS33, PRODOS, UNREADABLE };
+enum Order : uint8_t { DOS_ORDER, PRODOS_ORDER, NIBBLE };
+
+const char* const FORMAT_NAMES[] = {"unknown", "DOS 3.3", "ProDOS", "unreadable"};
+const char* const ORDER_NAMES[] = {"DOS", "ProDOS", "nibble"};
+
+struct CatalogEntry {
+    uint8_t type; // DOS 3.3 file type byte, bit 7 = locked
+    uint16_t sectors;
+    std::string name;
+};
+
+struct Entry {
+    std::string path;
+    Format format = UNREADABLE;
+    Order order = DOS_ORDER;
+    uint64_t bootHash = 0;
+    uint8_t volume = 0;
+    std::string label;
+    std::vector<CatalogEntry> catalog;
+};
+
+uint64_t fnv1a64(const uint8_t* data, size_t size) {
+    uint64_t hash = 0xCBF29CE484222325ull;
+    for (size_t i = 0; i < size; ++i) {
+        hash = (hash ^ data[i]) * 0x100000001B3ull;
+    }
+    return hash;
+}
+
+bool hasExtension(const std::filesystem::path& path, std::initializer_list<const char*> extensions) {
+    std::string ext = path.extension().string();
+    std::transform(ext.begin(), ext.end(), ext.begin(), [](unsigned char c) { return std::tolower(c); });
+    for (const char* e : extensions) {
+        if (ext == e) {
+            return true;
+        }
+    }
+    return false;
+}
+
+// A 140K image viewed through one of the two sector orders.
+struct SectorImage {
+    const uint8_t* data;
+    const uint8_t* order; // gcr::DOS_ORDER or gcr::PRODOS_ORDER
+
+    // File bytes of the physical sector that holds logical sector
+    // `logical` under `interleave` (DOS 3.3 sectors or ProDOS half-blocks).
+    const uint8_t* sector(int track, int logical, const uint8_t* interleave) const {
+        int physical = 0;
+        while (interleave[physical] != logical) {
+            physical++;
+        }
+        return data + track * gcr::TRACK_SIZE + order[physical] * gcr::SECTOR_SIZE;
+    }
+    const uint8_t* dosSector(int track, int sector) const { return this->sector(track, sector, gcr::DOS_ORDER); }
+    void block(int block, uint8_t* out) const {
+        for (int half = 0; half < 2; ++half) {
+            const uint8_t* s = sector(block / 8, (block % 8) * 2 + half, gcr::PRODOS_ORDER);
+            memcpy(out + half * gcr::SECTOR_SIZE, s, gcr::SECTOR_SIZE);
+        }
+    }
+};
+
+// Walks the DOS 3.3 catalog chain from the VTOC. Returns the number of
+// well-formed catalog sectors (0 if this is not a DOS 3.3 disk in this
+// order) and fills `entry`.
+int readDosCatalog(const SectorImage& image, Entry& entry) {
+    const uint8_t* vtoc = image.dosSector(VTOC_TRACK, 0);
+    if (vtoc[1] >= gcr::TRACKS || vtoc[2] >= gcr::SECTORS || vtoc[0x34] != gcr::TRACKS ||
+        vtoc[0x35] != gcr::SECTORS || vtoc[0x36] != 0x00 || vtoc[0x37] != 0x01) {
+        return 0;
+    }
+    entry.volume = vtoc[6];
+    entry.catalog.clear();
+    int track = vtoc[1];
+    int sector = vtoc[2];
+    int valid = 0;
+    while (track != 0 && valid < MAX_CATALOG_SECTORS) {
+        if (track >= gcr::TRACKS || sector >= gcr::SECTORS) {
+            break;
+        }
+        const uint8_t* cat = image.dosSector(track, sector);
+        for (int i = 0; i < 7; ++i) {
+            const uint8_t* file = cat + 0x0B + i * 35;
+            if (file[0] == 0x00) {
+                continue;
+            }
+            if (file[0] == 0xFF) { // deleted
+                continue;
+            }
+            if (file[0] >= gcr::TRACKS || file[1] >= gcr::SECTORS) {
+                return valid;
+            }
+            CatalogEntry e;
+            e.type = file[2];
+            e.sectors = file[0x21] | (file[0x22] << 8);
+            for (int c = 0; c < 30; ++c) {
+                e.name.push_back(static_cast<char>(file[3 + c] & 0x7F));
+            }
+            e.name.erase(e.name.find_last_not_of(' ') + 1);
+            entry.catalog.push_back(std::move(e));
+        }
+        valid++;
+        track = cat[1];
+        sector = cat[2];
+    }
+    return valid;
+}
+
+// Counts linked ProDOS volume directory blocks (0 if block 2 is not a
+// volume directory key block in this order) and reads the volume name.
+int readProdosVolume(const SectorImage& image, Entry& entry) {
+    uint8_t block[512];
+    image.block(2, block);
+    if (block[0] != 0 || block[1] != 0 || (block[4] & 0xF0) != 0xF0 || block[0x23] != 0x27 ||
+        block[0x24] != 0x0D) {
+        return 0;
+    }
+    entry.label.assign(reinterpret_cast<const char*>(block + 5), block[4] & 0x0F);
+    int valid = 1;
+    int next = block[2] | (block[3] << 8);
+    int previous = 2;
+    while (next != 0 && valid < MAX_DIRECTORY_BLOCKS && next < 280) {
+        image.block(next, block);
+        if ((block[0] | (block[1] << 8)) != previous) {
+            break;
+        }
+        valid++;
+        previous = next;
+        next = block[2] | (block[3] << 8);
+    }
+    return valid;
+}
+
+// Tries both orders and both formats and keeps the best-supported reading;
+// the extension breaks ties.
+void identify(const uint8_t* data, bool prodosExtension, Entry& entry) {
+    entry.bootHash = fnv1a64(data, gcr::SECTOR_SIZE); // physical T0 S0 is file sector 0 in either order
+    entry.format = UNKNOWN;
+    entry.order = prodosExtension ? PRODOS_ORDER : DOS_ORDER;
+    int best = 0;
+    for (Order order : {entry.order, prodosExtension ? DOS_ORDER : PRODOS_ORDER}) {
+        SectorImage image{data, order == PRODOS_ORDER ? gcr::PRODOS_ORDER : gcr::DOS_ORDER};
+        Entry candidate;
+        int score = readDosCatalog(image, candidate);
+        if (score > best) {
+            best = score;
+            entry.format = DOS33;
+            entry.order = order;
+            entry.volume = candidate.volume;
+            entry.catalog = std::move(candidate.catalog);
+            entry.label.clear();
+        }
+        candidate = Entry{};
+        score = readProdosVolume(image, candidate);
+        if (score > best) {
+            best = score;
+            entry.format = PRODOS;
+            entry.order = order;
+            entry.volume = 0;
+            entry.catalog.clear();
+            entry.label = std::move(candidate.label);
+        }
+    }
+}
+
+Entry scan(const std::string& path) {
+    Entry entry;
+    entry.path = path;
+    if (hasExtension(path, {".woz", ".nib"})) {
+        woz::Image image;
+        if (!image.open(path)) {
+            return entry;
+        }
+        // Decode whatever standard sectors the bitstream holds.
+        std::vector<uint8_t> sectors(gcr::IMAGE_SIZE);
+        for (int t = 0; t < gcr::TRACKS; ++t) {
+            const woz::Track& track = image.track(t * 4);
+            if (!track.empty()) {
+                gcr::denibblizeTrack(woz::latchNibbles(track), t, gcr::DOS_ORDER, &sectors[t * gcr::TRACK_SIZE]);
+            }
+        }
+        identify(sectors.data(), false, entry);
+        entry.order = NIBBLE;
+        return entry;
+    }
+    MappedFile file;
+    if (!file.open(path, false) || file.size() != gcr::IMAGE_SIZE) {
+        return entry;
+    }
+    identify(file.data(), hasExtension(path, {".po"}), entry);
+    return entry;
+}
+
+class Writer {
+public:
+    void u8(uint8_t v) { bytes.push_back(v); }
+    void u16(uint16_t v) {
+        u8(v & 0xFF);
+        u8(v >> 8);
+    }
+    void u32(uint32_t v) {
+        u16(v & 0xFFFF);
+        u16(v >> 16);
+    }
+    void u64(uint64_t v) {
+        u32(static_cast<uint32_t>(v));
+        u32(static_cast<uint32_t>(v >> 32));
+    }
+    void str8(const std::string& s) {
+        u8(static_cast<uint8_t>(std::min<size_t>(s.size(), 255)));
+        bytes.insert(bytes.end(), s.begin(), s.begin() + std::min<size_t>(s.size(), 255));
+    }
+    void str16(const std::string& s) {
+        u16(static_cast<uint16_t>(std::min<size_t>(s.size(), 65535)));
+        bytes.insert(bytes.end(), s.begin(), s.begin() + std::min<size_t>(s.size(), 65535));
+    }
+    std::vector<uint8_t> bytes;
+};
+
+class Reader {
+public:
+    Reader(const uint8_t* data, size_t size) : data(data), size(size) {}
+    bool ok() const { return !overrun; }
+    uint8_t u8() {
+        if (at >= size) {
+            overrun = true;
+            return 0;
+        }
+        return data[at++];
+    }
+    uint16_t u16() { return u8() | (u8() << 8); }
+    uint32_t u32() { return u16() | (static_cast<uint32_t>(u16()) << 16); }
+    uint64_t u64() { return u32() | (static_cast<uint64_t>(u32()) << 32); }
+    std::string str(size_t length) {
+        if (length > size - at) {
+            overrun = true;
+            return "";
+        }
+        std::string s(reinterpret_cast<const char*>(data + at), length);
+        at += length;
+        return s;
+    }
+
+private:
+    const uint8_t* data;
+    size_t size;
+    size_t at = 0;
+    bool overrun = false;
+};
+
+bool writeIndex(const std::string& filename, const std::vector<Entry>& entries) {
+    Writer body;
+    for (const Entry& e : entries) {
+        body.str16(e.path);
+        body.u8(e.format);
+        body.u8(e.order);
+        body.u64(e.bootHash);
+        body.u8(e.volume);
+        body.str8(e.label);
+        body.u16(static_cast<uint16_t>(e.catalog.size()));
+        for (const CatalogEntry& file : e.catalog) {
+            body.u8(file.type);
+            body.u16(file.sectors);
+            body.str8(file.name);
+        }
+    }
+    std::vector<uint8_t> packed = lzCompress(body.bytes.data(), body.bytes.size());
+    Writer header;
+    header.bytes = {'D', 'I', 'D', 'X'};
+    header.u32(INDEX_VERSION);
+    header.u32(static_cast<uint32_t>(entries.size()));
+    header.u32(static_cast<uint32_t>(body.bytes.size()));
+    header.u32(static_cast<uint32_t>(packed.size()));
+
+    std::ofstream out(filename, std::ios::binary | std::ios::trunc);
+    out.write(reinterpret_cast<const char*>(header.bytes.data()), header.bytes.size());
+    out.write(reinterpret_cast<const char*>(packed.data()), packed.size());
+    return static_cast<bool>(out);
+}
+
+char typeLetter(uint8_t type) {
+    static const char LETTERS[] = "TIABSRAB"; // bits 0-6 of the type byte; 0 is T
+    for (int bit = 0; bit < 7; ++bit) {
+        if (type & (1 << bit)) {
+            return LETTERS[bit + 1];
+        }
+    }
+    return LETTERS[0];
+}
+
+int list(const char* filename) {
+    MappedFile file;
+    if (!file.open(filename, false) || file.size() < 20 || memcmp(file.data(), "DIDX", 4) != 0) {
+        fprintf(stderr, "Error: %s is not a disk index\n", filename);
+        return 2;
+    }
+    Reader header(file.data() + 4, 16);
+    uint32_t version = header.u32();
+    uint32_t count = header.u32();
+    uint32_t rawSize = header.u32();
+    uint32_t packedSize = header.u32();
+    std::vector<uint8_t> body(rawSize);
+    if (version != INDEX_VERSION || packedSize > file.size() - 20 ||
+        !lzDecompress(file.data() + 20, packedSize, body.data(), body.size())) {
+        fprintf(stderr, "Error: %s is corrupt or from another version\n", filename);
+        return 2;
+    }
+    Reader in(body.data(), body.size());
+    for (uint32_t i = 0; i < count && in.ok(); ++i) {
+        std::string path = in.str(in.u16());
+        uint8_t format = std::min<uint8_t>(in.u8(), UNREADABLE);
+        uint8_t order = std::min<uint8_t>(in.u8(), NIBBLE);
+        uint64_t hash = in.u64();
+        uint8_t volume = in.u8();
+        std::string label = in.str(in.u8());
+        printf("%s\n  %s, %s order, boot %016llx", path.c_str(), FORMAT_NAMES[format], ORDER_NAMES[order],
+               static_cast<unsigned long long>(hash));
+        if (format == DOS33) {
+            printf(", volume %d", volume);
+        } else if (format == PRODOS) {
+            printf(", /%s", label.c_str());
+        }
+        printf("\n");
+        uint16_t files = in.u16();
+        for (uint16_t f = 0; f < files && in.ok(); ++f) {
+            uint8_t type = in.u8();
+            uint16_t sectors = in.u16();
+            std::string name = in.str(in.u8());
+            printf("   %c%c %03d %s\n", type & 0x80 ? '*' : ' ', typeLetter(type), sectors, name.c_str());
+        }
+    }
+    if (!in.ok()) {
+        fprintf(stderr, "Error: %s is truncated\n", filename);
+        return 2;
+    }
+    return 0;
+}
+
+std::vector<std::string> collect(const std::vector<std::string>& roots) {
+    namespace fs = std::filesystem;
+    std::vector<std::string> paths;
+    auto consider = [&](const fs::path& path) {
+        if (hasExtension(path, {".dsk", ".do", ".po", ".woz", ".nib"})) {
+            paths.push_back(path.string());
+        }
+    };
+    for (const std::string& root : roots) {
+        std::error_code ec;
+        if (fs::is_directory(root, ec)) {
+            for (fs::recursive_directory_iterator it(root, fs::directory_options::skip_permission_denied, ec), end;
+                 it != end; it.increment(ec)) {
+                if (it->is_regular_file(ec)) {
+                    consider(it->path());
+                }
+            }
+        } else {
+            consider(root);
+        }
+    }
+    std::sort(paths.begin(), paths.end());
+    return paths;
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    if (argc == 3 && strcmp(argv[1], "--list") == 0) {
+        return list(argv[2]);
+    }
+    unsigned threads = std::max(1u, std::thread::hardware_concurrency());
+    std::string output = "disks.didx";
+    std::vector<std::string> roots;
+    for (int i = 1; i < argc; ++i) {
+        if (strcmp(argv[i], "-j") == 0 && i + 1 < argc) {
+            threads = std::max(1, atoi(argv[++i]));
+        } else if (strcmp(argv[i], "-o") == 0 && i + 1 < argc) {
+            output = argv[++i];
+        } else {
+            roots.push_back(argv[i]);
+        }
+    }
+    if (roots.empty()) {
+        fprintf(stderr, "Usage: %s [-j THREADS] [-o INDEX] PATH...\n       %s --list INDEX\n", argv[0], argv[0]);
+        return 2;
+    }
+
+    auto start = std::chrono::steady_clock::now();
+    std::vector<std::string> paths = collect(roots);
+    std::vector<Entry> entries(paths.size());
+    std::atomic<size_t> next{0};
+    std::vector<std::thread> workers;
+    threads = static_cast<unsigned>(std::min<size_t>(threads, std::max<size_t>(1, paths.size())));
+    for (unsigned t = 0; t < threads; ++t) {
+        workers.emplace_back([&] {
+            for (size_t i; (i = next.fetch_add(1, std::memory_order_relaxed)) < paths.size();) {
+                entries[i] = scan(paths[i]);
+            }
+        });
+    }
+    for (std::thread& worker : workers) {
+        worker.join();
+    }
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    if (!writeIndex(output, entries)) {
+        fprintf(stderr, "Error: Could not write %s\n", output.c_str());
+        return 1;
+    }
+    size_t counts[4] = {};
+    for (const Entry& e : entries) {
+        counts[e.format]++;
+    }
+    printf("%zu images (%zu DOS 3.3, %zu ProDOS, %zu unknown, %zu unreadable) in %.2f s on %u threads "
+           "(%.0f images/s) -> %s\n",
+           entries.size(), counts[DOS33], counts[PRODOS], counts[UNKNOWN], counts[UNREADABLE], seconds, threads,
+           entries.size() / std::max(seconds, 1e-9), output.c_str());
+    return 0;
+}
@@ -0,0 +1,164 @@
+// Boots many independent machines at once for regression runs.
+//
+//   farm [-j THREADS] [--cycles N] [--keys TEXT | --script FILE]
+//        [--repeat N] [--no-rwts] [--boot-cache DIR] [--rom FILE] [-v]
+//        [IMAGE...]
+//
+// Every image is run once per key script (each line of FILE, or TEXT; "\n"
+// in either means Return), `--repeat` times over; with no images, the
+// scripts run on a machine with an empty drive. `--boot-cache` starts each
+// machine from a post-reset snapshot kept in DIR (see BootCache), so no job
+// pays for the ROM's reset sequence and diskless jobs start at ]. Each job gets a fresh
+// machine and a cycle budget and reports how it stopped, the cycles run and
+// an FNV-1a hash of the final text screen. Repeats of the same image and
+// script must agree; any that do not are listed as nondeterministic.
+#include "../farm.hpp"
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <map>
+#include <set>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace {
+
+std::string unescape(const std::string& text) {
+    std::string keys;
+    for (size_t i = 0; i < text.size(); ++i) {
+        if (text[i] == '\\' && i + 1 < text.size() && text[i + 1] == 'n') {
+            keys += '\n';
+            i++;
+        } else {
+            keys += text[i];
+        }
+    }
+    return keys;
+}
+
+const char* diskName(const std::string& image) {
+    return image.empty() ? "(no disk)" : image.c_str();
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    unsigned threads = 0;
+    uint64_t cycles = 100000000;
+    int repeat = 1;
+    bool rwtsTrap = true;
+    bool verbose = false;
+    std::string romPath = "Apple2_Plus.rom";
+    std::string bootCache;
+    std::vector<std::string> scripts;
+    std::vector<std::string> images;
+    for (int i = 1; i < argc; ++i) {
+        if (strcmp(argv[i], "-j") == 0 && i + 1 < argc) {
+            threads = std::max(1, atoi(argv[++i]));
+        } else if (strcmp(argv[i], "--cycles") == 0 && i + 1 < argc) {
+            cycles = strtoull(argv[++i], nullptr, 0);
+        } else if (strcmp(argv[i], "--keys") == 0 && i + 1 < argc) {
+            scripts.push_back(unescape(argv[++i]));
+        } else if (strcmp(argv[i], "--script") == 0 && i + 1 < argc) {
+            std::ifstream file(argv[++i]);
+            if (!file) {
+                fprintf(stderr, "Error: Could not open %s\n", argv[i]);
+                return 1;
+            }
+            for (std::string line; std::getline(file, line);) {
+                if (!line.empty()) {
+                    scripts.push_back(unescape(line));
+                }
+            }
+        } else if (strcmp(argv[i], "--repeat") == 0 && i + 1 < argc) {
+            repeat = std::max(1, atoi(argv[++i]));
+        } else if (strcmp(argv[i], "--no-rwts") == 0) {
+            rwtsTrap = false;
+        } else if (strcmp(argv[i], "--boot-cache") == 0 && i + 1 < argc) {
+            bootCache = argv[++i];
+        } else if (strcmp(argv[i], "--rom") == 0 && i + 1 < argc) {
+            romPath = argv[++i];
+        } else if (strcmp(argv[i], "-v") == 0) {
+            verbose = true;
+        } else {
+            images.push_back(argv[i]);
+        }
+    }
+    if (images.empty() && scripts.empty()) {
+        fprintf(stderr,
+                "Usage: %s [-j THREADS] [--cycles N] [--keys TEXT | --script FILE] [--repeat N] [--no-rwts] "
+                "[--boot-cache DIR] [--rom FILE] [-v] [IMAGE...]\n",
+                argv[0]);
+        return 2;
+    }
+    if (images.empty()) {
+        images.push_back("");
+    }
+    if (scripts.empty()) {
+        scripts.push_back("");
+    }
+    std::vector<uint8_t> rom;
+    if (!Machine::loadRom(romPath, rom)) {
+        fprintf(stderr, "Error: Could not open ROM file: %s\n", romPath.c_str());
+        return 1;
+    }
+
+    std::vector<FarmJob> jobs;
+    std::vector<std::pair<size_t, size_t>> origin; // (image, script) per job
+    for (int r = 0; r < repeat; ++r) {
+        for (size_t i = 0; i < images.size(); ++i) {
+            for (size_t s = 0; s < scripts.size(); ++s) {
+                jobs.push_back({images[i], scripts[s], cycles, rwtsTrap});
+                origin.emplace_back(i, s);
+            }
+        }
+    }
+
+    Farm farm(std::move(rom), threads);
+    std::string error;
+    if (!bootCache.empty() && !farm.useBootCache(bootCache, &error)) {
+        fprintf(stderr, "Warning: no boot snapshot (%s); booting cold\n", error.c_str());
+    }
+    auto start = std::chrono::steady_clock::now();
+    std::vector<FarmResult> results = farm.run(jobs);
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    std::map<std::pair<size_t, size_t>, std::set<uint64_t>> hashes;
+    size_t exits[4] = {};
+    size_t failed = 0;
+    uint64_t totalCycles = 0;
+    double busy = 0;
+    for (size_t j = 0; j < jobs.size(); ++j) {
+        const FarmResult& r = results[j];
+        if (!r.booted) {
+            failed++;
+            continue;
+        }
+        exits[static_cast<int>(r.exit)]++;
+        totalCycles += r.cycles;
+        busy += r.cpuSeconds;
+        hashes[origin[j]].insert(r.screenHash);
+        if (verbose) {
+            printf("%s\tscript %zu\t%s\t%llu cycles\tpc %04X\tscreen %016llx\n", diskName(jobs[j].disk),
+                   origin[j].second, Machine::exitName(r.exit), static_cast<unsigned long long>(r.cycles), r.pc,
+                   static_cast<unsigned long long>(r.screenHash));
+        }
+    }
+    for (const auto& [key, set] : hashes) {
+        if (set.size() > 1) {
+            printf("nondeterministic: %s script %zu (%zu different screens)\n", diskName(images[key.first]),
+                   key.second, set.size());
+        }
+    }
+
+    printf("%zu jobs (%zu idle, %zu hung, %zu out of budget, %zu failed to load) in %.2f s on %u threads\n",
+           jobs.size(), exits[static_cast<int>(Machine::Exit::Idle)], exits[static_cast<int>(Machine::Exit::Hung)],
+           exits[static_cast<int>(Machine::Exit::Budget)], failed, seconds, farm.threads());
+    printf("%.1f jobs/s, %.1f emulated MHz total, %.2f cores busy, %llu steals\n",
+           jobs.size() / std::max(seconds, 1e-9), totalCycles / std::max(seconds, 1e-9) / 1e6,
+           busy / std::max(seconds, 1e-9), static_cast<unsigned long long>(farm.steals()));
+    return failed ? 1 : 0;
+}
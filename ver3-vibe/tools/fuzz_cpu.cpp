@@ -0,0 +1,249 @@
+// Coverage-guided fuzz target for the CPU core and memory bus.
+//
+// Input layout: A, X, Y, P, S, then the program, loaded at $0200 where
+// execution starts. Each input runs for at most MAX_CYCLES cycles and aborts
+// on a broken invariant:
+//   - the cycles charged match the opcode table (base, page-cross and
+//     branch penalties worked out independently from the pre-state)
+//   - with FUZZ_DIFFERENTIAL, registers, cycles and memory match the ver1 core
+//
+// Memory is reset between inputs with Memory::restoreSnapshot(), which only
+// copies back the pages the previous input wrote.
+//
+//   libFuzzer:  clang++ -DFUZZ_LIBFUZZER -fsanitize=fuzzer,address ...
+//   AFL++:      afl-clang-fast++ ... (persistent mode via __AFL_LOOP)
+//   standalone: fuzz_cpu FILE...    run inputs (stdin when none is given)
+//               fuzz_cpu --bench N  run N random inputs and report exec/s
+#ifdef FUZZ_DIFFERENTIAL
+#include "lockstep.hpp"
+#endif
+#include "../cpu.hpp"
+#include "../memory.hpp"
+#include "../opcodes.hpp"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <random>
+#include <string>
+#include <vector>
+
+namespace {
+
+constexpr uint16_t PROGRAM_START = 0x0200;
+constexpr size_t HEADER_SIZE = 5;
+constexpr size_t MAX_PROGRAM = Memory::RAM_END + 1 - PROGRAM_START;
+constexpr uint64_t MAX_CYCLES = 20000;
+
+[[noreturn]] void fail(const char* what, uint16_t pc, uint8_t opcode, const std::string& detail = "") {
+    fprintf(stderr, "INVARIANT FAILED: %s at $%04X (opcode %02X %s)\n%s", what, pc, opcode,
+            OPCODES[opcode].mnemonic, detail.c_str());
+    abort();
+}
+
+// Cycles the next instruction should take, computed from the opcode table
+// and the machine state before it executes. Reads `data` directly so the
+// calculation has no bus side effects.
+uint64_t expectedCycles(const CPU& cpu, const Memory& mem) {
+    const auto& m = mem.data;
+    uint8_t opcode = m[cpu.pc];
+    uint8_t op1 = m[uint16_t(cpu.pc + 1)];
+    const OpcodeInfo& info = OPCODES[opcode];
+    uint64_t cycles = info.cycles;
+
+    if (info.mode == AddrMode::REL) {
+        static constexpr uint8_t FLAG[4] = {CPU::AF_SIGN, CPU::AF_OVERFLOW, CPU::AF_CARRY, CPU::AF_ZERO};
+        bool set = cpu.ps & FLAG[opcode >> 6];
+        bool taken = (opcode & 0x20) ? set : !set;
+        if (taken) {
+            uint16_t next = cpu.pc + 2;
+            uint16_t target = next + int8_t(op1);
+            cycles += 1 + ((next ^ target) > 0xFF);
+        }
+        return cycles;
+    }
+    if (!info.pagePenalty) {
+        return cycles;
+    }
+    uint8_t low = 0;
+    uint8_t index = 0;
+    switch (info.mode) {
+    case AddrMode::ABX: low = op1; index = cpu.x; break;
+    case AddrMode::ABY: low = op1; index = cpu.y; break;
+    case AddrMode::IZY: low = m[op1]; index = cpu.y; break;
+    default: return cycles;
+    }
+    return cycles + (low + index > 0xFF);
+}
+
+#ifdef FUZZ_DIFFERENTIAL
+// Opcodes the ver1 core gets wrong or does not implement (see difftest);
+// a run stops comparing when it reaches one.
+bool referenceSupports(uint8_t opcode) {
+    static const bool* table = [] {
+        static bool ok[256];
+        static const uint8_t gaps[] = {
+            0x00, 0x01, 0x11, 0x15, 0x16, 0x19, 0x1D, 0x1E, 0x20, 0x21, 0x24, 0x2C, 0x31, 0x35, 0x36, 0x39,
+            0x3D, 0x3E, 0x40, 0x41, 0x51, 0x55, 0x56, 0x59, 0x5D, 0x5E, 0x61, 0x6C, 0x71, 0x75, 0x76, 0x79,
+            0x7D, 0x7E, 0x94, 0x96, 0xA1, 0xB1, 0xB4, 0xB5, 0xB6, 0xB9, 0xBC, 0xBD, 0xBE, 0xC1, 0xD1, 0xD5,
+            0xD6, 0xD9, 0xDD, 0xDE, 0xE1, 0xF1, 0xF5, 0xF6, 0xF9, 0xFD, 0xFE,
+        };
+        for (int op = 0; op < 256; ++op) {
+            ok[op] = OPCODES[op].mnemonic[0] != '?';
+        }
+        for (uint8_t op : gaps) {
+            ok[op] = false;
+        }
+        return ok;
+    }();
+    return table[opcode];
+}
+#endif
+
+class Harness {
+public:
+    Harness() {
+        // BRK/IRQ, reset and NMI all re-enter the program
+        for (uint16_t vector = 0xFFFA; vector != 0; vector += 2) {
+            mem().data[vector] = PROGRAM_START & 0xFF;
+            mem().data[vector + 1] = PROGRAM_START >> 8;
+        }
+        mem().takeSnapshot();
+    }
+
+    void run(const uint8_t* input, size_t size) {
+        if (size < HEADER_SIZE) {
+            return;
+        }
+        mem().restoreSnapshot();
+        size_t length = std::min(size - HEADER_SIZE, MAX_PROGRAM);
+        for (size_t i = 0; i < length; ++i) {
+            mem().write(PROGRAM_START + i, input[HEADER_SIZE + i]);
+        }
+
+        CPU& c = cpu();
+        c.a = input[0];
+        c.x = input[1];
+        c.y = input[2];
+        c.ps = input[3] | CPU::AF_RESERVED;
+        c.sp = input[4];
+        c.pc = PROGRAM_START;
+        c.cycles = 0;
+#ifdef FUZZ_DIFFERENTIAL
+        memcpy(lockstep.reference().memory(), mem().data.data(), Memory::ADDRESS_SPACE_SIZE);
+        lockstep.setRegisters({c.a, c.x, c.y, c.ps, c.sp, c.pc});
+#endif
+
+        while (c.cycles < MAX_CYCLES) {
+            uint16_t pc = c.pc;
+            uint8_t opcode = mem().data[pc];
+            uint64_t expected = expectedCycles(c, mem());
+            uint64_t start = c.cycles;
+#ifdef FUZZ_DIFFERENTIAL
+            if (!referenceSupports(opcode)) {
+                break;
+            }
+            std::string report;
+            if (!lockstep.step(report)) {
+                fail("ver1 and ver3 diverge", pc, opcode, report);
+            }
+#else
+            c.execute(1);
+#endif
+            if (c.cycles - start != expected) {
+                fail("cycle count does not match the opcode table", pc, opcode);
+            }
+        }
+#ifdef FUZZ_DIFFERENTIAL
+        std::string report;
+        if (!lockstep.memoryMatches(report)) {
+            fail("ver1 and ver3 memory differ", c.pc, mem().data[c.pc], report);
+        }
+#endif
+    }
+
+private:
+#ifdef FUZZ_DIFFERENTIAL
+    Memory& mem() { return lockstep.memory(); }
+    CPU& cpu() { return lockstep.cpu(); }
+    Lockstep lockstep;
+#else
+    Memory& mem() { return memory; }
+    CPU& cpu() { return core; }
+    Memory memory;
+    CPU core{memory};
+#endif
+};
+
+Harness& harness() {
+    static Harness instance;
+    return instance;
+}
+
+} // namespace
+
+extern "C" int LLVMFuzzerTestOneInput(const uint8_t* data, size_t size) {
+    harness().run(data, size);
+    return 0;
+}
+
+#ifndef FUZZ_LIBFUZZER
+namespace {
+
+std::vector<uint8_t> readAll(FILE* file) {
+    std::vector<uint8_t> bytes;
+    uint8_t buf[4096];
+    size_t n;
+    while ((n = fread(buf, 1, sizeof(buf), file)) > 0) {
+        bytes.insert(bytes.end(), buf, buf + n);
+    }
+    return bytes;
+}
+
+int bench(uint64_t runs) {
+    std::mt19937_64 rng(1);
+    std::vector<uint8_t> input(HEADER_SIZE + 256);
+    auto start = std::chrono::steady_clock::now();
+    for (uint64_t i = 0; i < runs; ++i) {
+        for (uint8_t& b : input) {
+            b = static_cast<uint8_t>(rng());
+        }
+        LLVMFuzzerTestOneInput(input.data(), input.size());
+    }
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    printf("%llu inputs in %.2f s (%.0f exec/s)\n", static_cast<unsigned long long>(runs), seconds,
+           runs / seconds);
+    return 0;
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    if (argc == 3 && strcmp(argv[1], "--bench") == 0) {
+        return bench(strtoull(argv[2], nullptr, 0));
+    }
+    if (argc > 1) {
+        for (int i = 1; i < argc; ++i) {
+            FILE* file = fopen(argv[i], "rb");
+            if (!file) {
+                fprintf(stderr, "Error: Could not open %s\n", argv[i]);
+                return 2;
+            }
+            std::vector<uint8_t> input = readAll(file);
+            fclose(file);
+            LLVMFuzzerTestOneInput(input.data(), input.size());
+        }
+        return 0;
+    }
+#ifdef __AFL_LOOP
+    while (__AFL_LOOP(10000)) {
+#endif
+        std::vector<uint8_t> input = readAll(stdin);
+        LLVMFuzzerTestOneInput(input.data(), input.size());
+#ifdef __AFL_LOOP
+    }
+#endif
+    return 0;
+}
+#endif
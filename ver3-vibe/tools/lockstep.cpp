@@ -0,0 +1,87 @@
+#include "lockstep.hpp"
+#include "../opcodes.hpp"
+#include <cstdio>
+#include <cstring>
+
+Lockstep::Lockstep(bool strictFlags) : core(mem), flagMask(strictFlags ? 0xFF : 0xCF) {}
+
+void Lockstep::load(const uint8_t* image, const Registers& regs) {
+    memcpy(mem.data.data(), image, Memory::ADDRESS_SPACE_SIZE);
+    memcpy(ver1.memory(), image, Memory::ADDRESS_SPACE_SIZE);
+    setRegisters(regs);
+}
+
+void Lockstep::setRegisters(const Registers& regs) {
+    core.a = regs.a;
+    core.x = regs.x;
+    core.y = regs.y;
+    core.ps = regs.p;
+    core.sp = regs.sp;
+    core.pc = regs.pc;
+    ver1.setRegisters(regs);
+}
+
+Lockstep::Registers Lockstep::registers() const {
+    return {core.a, core.x, core.y, core.ps, core.sp, core.pc};
+}
+
+std::string Lockstep::describe(const Registers& r) {
+    char buf[64];
+    snprintf(buf, sizeof(buf), "PC=%04X A=%02X X=%02X Y=%02X P=%02X SP=%02X", r.pc, r.a, r.x, r.y, r.p, r.sp);
+    return buf;
+}
+
+bool Lockstep::step(std::string& report) {
+    Registers before = registers();
+    uint8_t bytes[3] = {mem.data[before.pc], mem.data[uint16_t(before.pc + 1)], mem.data[uint16_t(before.pc + 2)]};
+
+    uint64_t start = core.cycles;
+    core.execute(1);
+    int cycles3 = static_cast<int>(core.cycles - start);
+    int cycles1 = ver1.step();
+
+    Registers r3 = registers();
+    Registers r1 = ver1.registers();
+    bool same = r3.a == r1.a && r3.x == r1.x && r3.y == r1.y && r3.sp == r1.sp && r3.pc == r1.pc &&
+                (r3.p & flagMask) == (r1.p & flagMask);
+    if (same && cycles3 == cycles1) {
+        return true;
+    }
+
+    const OpcodeInfo& info = OPCODES[bytes[0]];
+    std::string hex;
+    for (int i = 0; i < addrModeLength(info.mode); ++i) {
+        char byte[4];
+        snprintf(byte, sizeof(byte), " %02X", bytes[i]);
+        hex += byte;
+    }
+    char buf[256];
+    snprintf(buf, sizeof(buf),
+             "instruction:%s  %s %s\n"
+             "before:      %s\n"
+             "ver3:        %s cycles=%d\n"
+             "ver1:        %s cycles=%d\n",
+             hex.c_str(), info.mnemonic, addrModeName(info.mode), describe(before).c_str(),
+             describe(r3).c_str(), cycles3, describe(r1).c_str(), cycles1);
+    report = buf;
+    return false;
+}
+
+bool Lockstep::memoryMatches(std::string& report) {
+    const uint8_t* m3 = mem.data.data();
+    const uint8_t* m1 = ver1.memory();
+    if (memcmp(m3, m1, Memory::ADDRESS_SPACE_SIZE) == 0) {
+        return true;
+    }
+    report = "memory differs:\n";
+    int shown = 0;
+    for (uint32_t addr = 0; addr < Memory::ADDRESS_SPACE_SIZE && shown < 8; ++addr) {
+        if (m3[addr] != m1[addr]) {
+            char buf[48];
+            snprintf(buf, sizeof(buf), "  $%04X ver3=%02X ver1=%02X\n", addr, m3[addr], m1[addr]);
+            report += buf;
+            shown++;
+        }
+    }
+    return false;
+}
@@ -0,0 +1,41 @@
+#pragma once
+
+#include "../cpu.hpp"
+#include "../memory.hpp"
+#include "ver1_core.hpp"
+#include <string>
+
+// Runs the ver3 CPU and the ver1 CPU side by side on identical memory
+// images and compares registers, flags and cycle counts per instruction.
+class Lockstep {
+public:
+    using Registers = Ver1Core::Registers;
+
+    // The B and U bits do not exist in the physical P register, so they are
+    // ignored unless strictFlags is set.
+    explicit Lockstep(bool strictFlags = false);
+
+    Memory& memory() { return mem; }
+    CPU& cpu() { return core; }
+    Ver1Core& reference() { return ver1; }
+
+    // Copies a 64 KB image into both cores and sets both register files.
+    void load(const uint8_t* image, const Registers& regs);
+    void setRegisters(const Registers& regs);
+    Registers registers() const;
+
+    // Executes one instruction on both cores. On divergence returns false and
+    // describes the instruction and the differing state in `report`.
+    bool step(std::string& report);
+
+    // Compares the full 64 KB of both cores.
+    bool memoryMatches(std::string& report);
+
+    static std::string describe(const Registers& regs);
+
+private:
+    Memory mem;
+    CPU core;
+    Ver1Core ver1;
+    uint8_t flagMask;
+};
@@ -0,0 +1,147 @@
+// Cost of copying whole-machine state.
+//
+//   statebench [--rom FILE] [--iterations N] [IMAGE]
+//
+// Boots a machine (from IMAGE in drive 1, if given) for a couple of seconds
+// of emulated time, then times:
+//   copy     MachineState to MachineState (one memcpy of the whole block)
+//   save     Machine::save
+//   load     Machine::load
+//   rewind   Machine::rewind after running one video frame from a
+//            checkpoint (the frame itself is not timed)
+// in nanoseconds per operation; the cost of run-ahead per displayed frame
+// (1 and 2 frames ahead, against the 16.7 ms frame budget); and the
+// save-state file round trip, stored and LZ-compressed, against replaying
+// the boot from reset.
+#include "../machine.hpp"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+constexpr uint64_t BOOT_CYCLES = 2000000;
+const char* const STATE_FILE = "statebench.state";
+
+double nanosecondsSince(Clock::time_point start, int iterations) {
+    return std::chrono::duration<double, std::nano>(Clock::now() - start).count() / iterations;
+}
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+    std::string romPath = "Apple2_Plus.rom";
+    std::string image;
+    int iterations = 20000;
+    for (int i = 1; i < argc; ++i) {
+        if (strcmp(argv[i], "--rom") == 0 && i + 1 < argc) {
+            romPath = argv[++i];
+        } else if (strcmp(argv[i], "--iterations") == 0 && i + 1 < argc) {
+            iterations = std::max(1, atoi(argv[++i]));
+        } else if (argv[i][0] != '-' && image.empty()) {
+            image = argv[i];
+        } else {
+            fprintf(stderr, "Usage: %s [--rom FILE] [--iterations N] [IMAGE]\n", argv[0]);
+            return 1;
+        }
+    }
+
+    std::vector<uint8_t> rom;
+    if (!Machine::loadRom(romPath, rom)) {
+        fprintf(stderr, "Error: Could not open ROM file: %s\n", romPath.c_str());
+        return 1;
+    }
+    Clock::time_point booting = Clock::now();
+    auto machine = std::make_unique<Machine>(rom);
+    if (!image.empty() && !machine->insertDisk(0, image)) {
+        fprintf(stderr, "Error: Could not open disk image: %s\n", image.c_str());
+        return 1;
+    }
+    machine->run(BOOT_CYCLES);
+    double bootNs = nanosecondsSince(booting, 1);
+
+    auto a = std::make_unique<MachineState>();
+    auto b = std::make_unique<MachineState>();
+    machine->save(*a);
+    volatile uint8_t sink = 0;
+
+    printf("state size   %zu bytes\n", sizeof(MachineState));
+
+    Clock::time_point start = Clock::now();
+    for (int i = 0; i < iterations; ++i) {
+        a->memory[i & 0xFFFF] ^= 1; // keep the copies from being folded away
+        *b = *a;
+        sink = sink + b->memory[i & 0xFFFF];
+    }
+    printf("copy     %8.0f ns\n", nanosecondsSince(start, iterations));
+
+    start = Clock::now();
+    for (int i = 0; i < iterations; ++i) {
+        machine->save(*a);
+        sink = sink + a->memory[i & 0xFFFF];
+    }
+    printf("save     %8.0f ns\n", nanosecondsSince(start, iterations));
+
+    start = Clock::now();
+    for (int i = 0; i < iterations; ++i) {
+        machine->load(*a);
+        sink = sink + machine->memory.data[i & 0xFFFF];
+    }
+    printf("load     %8.0f ns\n", nanosecondsSince(start, iterations));
+
+    machine->checkpoint();
+    Clock::duration rewinding{};
+    uint64_t pages = 0;
+    for (int i = 0; i < iterations; ++i) {
+        machine->run(Machine::SLICE_CYCLES);
+        pages += machine->memory.dirtyPageCount();
+        Clock::time_point before = Clock::now();
+        machine->rewind();
+        rewinding += Clock::now() - before;
+    }
+    printf("rewind   %8.0f ns  (%.1f dirty pages per frame)\n",
+           std::chrono::duration<double, std::nano>(rewinding).count() / iterations, double(pages) / iterations);
+
+    for (int frames = 1; frames <= 2; ++frames) {
+        const int runs = std::max(1, iterations / 20);
+        start = Clock::now();
+        for (int i = 0; i < runs; ++i) {
+            machine->runAhead(frames, [&] { sink = sink + machine->memory.data[0x0400]; });
+        }
+        printf("ahead %d  %8.3f ms per frame\n", frames, nanosecondsSince(start, runs) / 1e6);
+    }
+
+    printf("boot     %8.2f ms  (%llu cycles from reset)\n", bootNs / 1e6, static_cast<unsigned long long>(BOOT_CYCLES));
+    for (bool compress : {false, true}) {
+        const int files = std::max(1, iterations / 100);
+        start = Clock::now();
+        for (int i = 0; i < files; ++i) {
+            machine->saveState(STATE_FILE, compress);
+        }
+        double saveNs = nanosecondsSince(start, files);
+        FILE* f = fopen(STATE_FILE, "rb");
+        long bytes = 0;
+        if (f) {
+            fseek(f, 0, SEEK_END);
+            bytes = ftell(f);
+            fclose(f);
+        }
+        std::string error;
+        start = Clock::now();
+        for (int i = 0; i < files; ++i) {
+            if (!machine->loadState(STATE_FILE, &error)) {
+                fprintf(stderr, "Error: %s\n", error.c_str());
+                return 1;
+            }
+        }
+        printf("%-8s %8.2f ms save, %.3f ms load, %ld bytes\n", compress ? "lz" : "stored", saveNs / 1e6,
+               nanosecondsSince(start, files) / 1e6, bytes);
+    }
+    std::remove(STATE_FILE);
+    return 0;
+}
@@ -0,0 +1,102 @@
+// Decodes and compares instruction traces written by TraceWriter.
+//
+//   tracetool dump FILE [FIRST [COUNT]]   print records as text
+//   tracetool diff A B [CONTEXT]          report the first divergence
+#include "../opcodes.hpp"
+#include "../trace.hpp"
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <deque>
+#include <string>
+
+namespace {
+
+std::string format(const TraceRecord& r) {
+    char flags[9] = "NV-BDIZC";
+    for (int bit = 0; bit < 8; ++bit) {
+        if (!(r.ps & (0x80 >> bit))) {
+            flags[bit] = '.';
+        }
+    }
+    char line[96];
+    snprintf(line, sizeof(line), "%12llu  $%04X  %02X %s  A=%02X X=%02X Y=%02X P=%02X SP=%02X  %s",
+             static_cast<unsigned long long>(r.cycles), r.pc, r.opcode, OPCODES[r.opcode].mnemonic,
+             r.a, r.x, r.y, r.ps, r.sp, flags);
+    return line;
+}
+
+bool same(const TraceRecord& l, const TraceRecord& r) {
+    return l.cycles == r.cycles && l.pc == r.pc && l.opcode == r.opcode && l.a == r.a && l.x == r.x &&
+           l.y == r.y && l.ps == r.ps && l.sp == r.sp;
+}
+
+int dump(const char* filename, uint64_t first, uint64_t count) {
+    TraceReader reader;
+    if (!reader.open(filename)) {
+        return 2;
+    }
+    TraceRecord r;
+    for (uint64_t i = 0; i < first + count && reader.next(r); ++i) {
+        if (i >= first) {
+            printf("%10llu %s\n", static_cast<unsigned long long>(i), format(r).c_str());
+        }
+    }
+    return 0;
+}
+
+int diff(const char* fileA, const char* fileB, size_t context) {
+    TraceReader a;
+    TraceReader b;
+    if (!a.open(fileA) || !b.open(fileB)) {
+        return 2;
+    }
+
+    std::deque<TraceRecord> history;
+    TraceRecord ra;
+    TraceRecord rb;
+    for (uint64_t i = 0;; ++i) {
+        bool hasA = a.next(ra);
+        bool hasB = b.next(rb);
+        if (!hasA && !hasB) {
+            printf("Traces are identical (%llu instructions)\n", static_cast<unsigned long long>(i));
+            return 0;
+        }
+        if (hasA && hasB && same(ra, rb)) {
+            history.push_back(ra);
+            if (history.size() > context) {
+                history.pop_front();
+            }
+            continue;
+        }
+
+        printf("Traces diverge at instruction %llu\n", static_cast<unsigned long long>(i));
+        uint64_t index = i - history.size();
+        for (const TraceRecord& r : history) {
+            printf("  %10llu %s\n", static_cast<unsigned long long>(index++), format(r).c_str());
+        }
+        printf("< %10llu %s\n", static_cast<unsigned long long>(i), hasA ? format(ra).c_str() : "(end of trace)");
+        printf("> %10llu %s\n", static_cast<unsigned long long>(i), hasB ? format(rb).c_str() : "(end of trace)");
+        return 1;
+    }
+}
+
+void usage(const char* argv0) {
+    fprintf(stderr, "Usage: %s dump FILE [FIRST [COUNT]]\n       %s diff A B [CONTEXT]\n", argv0, argv0);
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    if (argc >= 3 && strcmp(argv[1], "dump") == 0) {
+        uint64_t first = argc > 3 ? strtoull(argv[3], nullptr, 0) : 0;
+        uint64_t count = argc > 4 ? strtoull(argv[4], nullptr, 0) : UINT64_MAX - first;
+        return dump(argv[2], first, count);
+    }
+    if (argc >= 4 && strcmp(argv[1], "diff") == 0) {
+        size_t context = argc > 4 ? strtoul(argv[4], nullptr, 0) : 10;
+        return diff(argv[2], argv[3], context);
+    }
+    usage(argv[0]);
+    return 2;
+}
@@ -0,0 +1,49 @@
+#include "ver1_core.hpp"
+
+// Standard headers the ver1 sources rely on must be included at global scope
+// first; their include guards then keep them out of the namespace below.
+#include <cstdint>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <vector>
+
+namespace v1 {
+#include "../../ver1-vibe/memory.hpp"
+#include "../../ver1-vibe/cpu.hpp"
+#include "../../ver1-vibe/memory.cpp"
+#include "../../ver1-vibe/cpu.cpp"
+} // namespace v1
+
+struct Ver1Core::Impl {
+    v1::Memory mem;
+    v1::CPU cpu{mem};
+};
+
+Ver1Core::Ver1Core() : impl(std::make_unique<Impl>()) {}
+
+Ver1Core::~Ver1Core() = default;
+
+uint8_t* Ver1Core::memory() {
+    return impl->mem.data.data();
+}
+
+Ver1Core::Registers Ver1Core::registers() const {
+    const v1::CPU& cpu = impl->cpu;
+    return {cpu.A, cpu.X, cpu.Y, cpu.P, cpu.S, cpu.PC};
+}
+
+void Ver1Core::setRegisters(const Registers& regs) {
+    v1::CPU& cpu = impl->cpu;
+    cpu.A = regs.a;
+    cpu.X = regs.x;
+    cpu.Y = regs.y;
+    cpu.P = regs.p;
+    cpu.S = regs.sp;
+    cpu.PC = regs.pc;
+}
+
+int Ver1Core::step() {
+    v1::CPU& cpu = impl->cpu;
+    return cpu.execute(impl->mem.read(cpu.PC));
+}
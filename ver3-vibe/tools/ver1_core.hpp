@@ -0,0 +1,28 @@
+#pragma once
+
+#include <cstdint>
+#include <memory>
+
+// Adapter around the ver1-vibe CPU/Memory. Both generations name their classes
+// CPU and Memory, so ver1 is compiled inside its own namespace in
+// ver1_core.cpp and only this interface is visible to the harnesses.
+class Ver1Core {
+public:
+    struct Registers {
+        uint8_t a, x, y, p, sp;
+        uint16_t pc;
+    };
+
+    Ver1Core();
+    ~Ver1Core();
+
+    uint8_t* memory();            // 64 KB image
+    Registers registers() const;
+    void setRegisters(const Registers& regs);
+    // Executes one instruction and returns the cycles it took.
+    int step();
+
+private:
+    struct Impl;
+    std::unique_ptr<Impl> impl;
+};
@@ -0,0 +1,219 @@
+#include "trace.hpp"
+#include "lz.hpp"
+#include <chrono>
+#include <cstring>
+#include <iostream>
+
+namespace {
+
+constexpr char MAGIC[8] = {'A', '2', 'T', 'R', 'A', 'C', 'E', 0};
+constexpr uint32_t VERSION = 1;
+
+// Records are stored as field-wise deltas against the previous record, then
+// transposed into 16 byte planes so the slowly changing bytes compress well.
+void encode(const TraceRecord* records, size_t count, TraceRecord& previous, std::vector<uint8_t>& planes) {
+    planes.resize(count * sizeof(TraceRecord));
+    for (size_t i = 0; i < count; ++i) {
+        TraceRecord delta = records[i];
+        delta.cycles -= previous.cycles;
+        delta.pc -= previous.pc;
+        delta.opcode -= previous.opcode;
+        delta.a -= previous.a;
+        delta.x -= previous.x;
+        delta.y -= previous.y;
+        delta.ps -= previous.ps;
+        delta.sp -= previous.sp;
+        previous = records[i];
+
+        uint8_t bytes[sizeof(TraceRecord)];
+        memcpy(bytes, &delta, sizeof(bytes));
+        for (size_t b = 0; b < sizeof(bytes); ++b) {
+            planes[b * count + i] = bytes[b];
+        }
+    }
+}
+
+void decode(const std::vector<uint8_t>& planes, size_t count, TraceRecord& previous, std::vector<TraceRecord>& records) {
+    records.resize(count);
+    for (size_t i = 0; i < count; ++i) {
+        uint8_t bytes[sizeof(TraceRecord)];
+        for (size_t b = 0; b < sizeof(bytes); ++b) {
+            bytes[b] = planes[b * count + i];
+        }
+        TraceRecord r;
+        memcpy(&r, bytes, sizeof(r));
+        r.cycles += previous.cycles;
+        r.pc += previous.pc;
+        r.opcode += previous.opcode;
+        r.a += previous.a;
+        r.x += previous.x;
+        r.y += previous.y;
+        r.ps += previous.ps;
+        r.sp += previous.sp;
+        records[i] = r;
+        previous = r;
+    }
+}
+
+void writeU32(std::ostream& out, uint32_t v) {
+    uint8_t b[4] = {uint8_t(v), uint8_t(v >> 8), uint8_t(v >> 16), uint8_t(v >> 24)};
+    out.write(reinterpret_cast<const char*>(b), 4);
+}
+
+bool readU32(std::istream& in, uint32_t& v) {
+    uint8_t b[4];
+    if (!in.read(reinterpret_cast<char*>(b), 4)) {
+        return false;
+    }
+    v = b[0] | (b[1] << 8) | (b[2] << 16) | (uint32_t(b[3]) << 24);
+    return true;
+}
+
+} // namespace
+
+TraceWriter::~TraceWriter() {
+    close();
+}
+
+bool TraceWriter::open(const std::string& filename, size_t capacity) {
+    close();
+    file.open(filename, std::ios::binary | std::ios::trunc);
+    if (!file.is_open()) {
+        std::cerr << "Error: Could not open trace file: " << filename << std::endl;
+        return false;
+    }
+    file.write(MAGIC, sizeof(MAGIC));
+    writeU32(file, VERSION);
+    writeU32(file, sizeof(TraceRecord));
+
+    size_t size = 1;
+    while (size < capacity) {
+        size <<= 1;
+    }
+    ring.assign(size, TraceRecord{});
+    mask = size - 1;
+    head = cachedTail = 0;
+    published.store(0);
+    consumed.store(0);
+    stopping.store(false);
+    previous = TraceRecord{};
+    written = 0;
+    staging.resize(BLOCK_RECORDS);
+    writer = std::thread(&TraceWriter::run, this);
+    return true;
+}
+
+void TraceWriter::close() {
+    if (!writer.joinable()) {
+        return;
+    }
+    stopping.store(true, std::memory_order_release);
+    writer.join();
+    file.close();
+}
+
+void TraceWriter::waitForSpace(size_t next) {
+    for (;;) {
+        cachedTail = consumed.load(std::memory_order_acquire);
+        if (next - cachedTail <= mask + 1) {
+            return;
+        }
+        std::this_thread::yield();
+    }
+}
+
+void TraceWriter::run() {
+    size_t tail = 0;
+    int idleMs = 0;
+    for (;;) {
+        // Read the stop flag first so the final pass sees every published record.
+        bool stop = stopping.load(std::memory_order_acquire);
+        size_t available = published.load(std::memory_order_acquire) - tail;
+        if (available == 0 && stop) {
+            break;
+        }
+        // Batch into full blocks, but flush a partial one when stopping, when the
+        // ring is half full, or after ~100 ms so a crash loses little.
+        bool pressure = available >= (mask + 1) / 2;
+        if (available < BLOCK_RECORDS && !stop && !pressure && idleMs < 100) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+            idleMs++;
+            continue;
+        }
+        idleMs = 0;
+        if (available == 0) {
+            continue;
+        }
+
+        size_t count = available < BLOCK_RECORDS ? available : BLOCK_RECORDS;
+        for (size_t i = 0; i < count; ++i) {
+            staging[i] = ring[(tail + i) & mask];
+        }
+        tail += count;
+        consumed.store(tail, std::memory_order_release);
+        writeBlock(staging.data(), count);
+    }
+    file.flush();
+}
+
+void TraceWriter::writeBlock(const TraceRecord* records, size_t count) {
+    std::vector<uint8_t> planes;
+    encode(records, count, previous, planes);
+    std::vector<uint8_t> packed = lzCompress(planes.data(), planes.size());
+    writeU32(file, static_cast<uint32_t>(count));
+    writeU32(file, static_cast<uint32_t>(packed.size()));
+    file.write(reinterpret_cast<const char*>(packed.data()), packed.size());
+    file.flush();
+    written += count;
+}
+
+bool TraceReader::open(const std::string& filename) {
+    file.open(filename, std::ios::binary);
+    if (!file.is_open()) {
+        std::cerr << "Error: Could not open trace file: " << filename << std::endl;
+        return false;
+    }
+    char magic[sizeof(MAGIC)];
+    uint32_t version = 0;
+    uint32_t recordSize = 0;
+    if (!file.read(magic, sizeof(magic)) || memcmp(magic, MAGIC, sizeof(MAGIC)) != 0 ||
+        !readU32(file, version) || !readU32(file, recordSize) ||
+        version != VERSION || recordSize != sizeof(TraceRecord)) {
+        std::cerr << "Error: Not a trace file (or unsupported version): " << filename << std::endl;
+        return false;
+    }
+    block.clear();
+    index = 0;
+    previous = TraceRecord{};
+    return true;
+}
+
+bool TraceReader::loadBlock() {
+    uint32_t count;
+    uint32_t packedSize;
+    if (!readU32(file, count) || !readU32(file, packedSize)) {
+        return false;
+    }
+    std::vector<uint8_t> packed(packedSize);
+    if (!file.read(reinterpret_cast<char*>(packed.data()), packedSize)) {
+        return false;
+    }
+    std::vector<uint8_t> planes(size_t(count) * sizeof(TraceRecord));
+    if (!lzDecompress(packed.data(), packed.size(), planes.data(), planes.size())) {
+        std::cerr << "Error: Corrupt trace block" << std::endl;
+        return false;
+    }
+    decode(planes, count, previous, block);
+    index = 0;
+    return true;
+}
+
+bool TraceReader::next(TraceRecord& record) {
+    while (index >= block.size()) {
+        if (!loadBlock()) {
+            return false;
+        }
+    }
+    record = block[index++];
+    return true;
+}
@@ -0,0 +1,86 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <fstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+// CPU state captured before each instruction executes.
+struct TraceRecord {
+    uint64_t cycles;
+    uint16_t pc;
+    uint8_t opcode;
+    uint8_t a;
+    uint8_t x;
+    uint8_t y;
+    uint8_t ps;
+    uint8_t sp;
+};
+static_assert(sizeof(TraceRecord) == 16, "TraceRecord must stay packed");
+
+// Instruction trace recorder. The CPU appends records into a preallocated
+// single-producer/single-consumer ring; a background thread drains it in
+// blocks, delta-encodes and LZ-compresses them, and writes the trace file.
+// When the ring is full the CPU waits for the writer, so traces are lossless.
+class TraceWriter {
+public:
+    static constexpr size_t DEFAULT_CAPACITY = size_t(1) << 20; // records, power of two
+    static constexpr size_t BLOCK_RECORDS = size_t(1) << 16;
+
+    TraceWriter() = default;
+    ~TraceWriter();
+    TraceWriter(const TraceWriter&) = delete;
+    TraceWriter& operator=(const TraceWriter&) = delete;
+
+    bool open(const std::string& filename, size_t capacity = DEFAULT_CAPACITY);
+    void close();
+
+    void push(const TraceRecord& record) {
+        size_t next = head + 1;
+        if (next - cachedTail > mask + 1) {
+            waitForSpace(next);
+        }
+        ring[head & mask] = record;
+        head = next;
+        published.store(head, std::memory_order_release);
+    }
+
+    uint64_t recordsWritten() const { return written; }
+
+private:
+    void waitForSpace(size_t next);
+    void run();
+    void writeBlock(const TraceRecord* records, size_t count);
+
+    std::vector<TraceRecord> ring;
+    size_t mask = 0;
+    size_t head = 0;           // producer-owned
+    size_t cachedTail = 0;     // producer's last view of `consumed`
+    alignas(64) std::atomic<size_t> published{0};
+    alignas(64) std::atomic<size_t> consumed{0};
+    std::atomic<bool> stopping{false};
+
+    std::ofstream file;
+    std::thread writer;
+    std::vector<TraceRecord> staging;
+    TraceRecord previous{};
+    uint64_t written = 0;
+};
+
+// Sequential reader for files produced by TraceWriter.
+class TraceReader {
+public:
+    bool open(const std::string& filename);
+    // Returns false at end of file or on a corrupt block.
+    bool next(TraceRecord& record);
+
+private:
+    bool loadBlock();
+
+    std::ifstream file;
+    std::vector<TraceRecord> block;
+    size_t index = 0;
+    TraceRecord previous{};
+};
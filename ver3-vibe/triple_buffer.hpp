@@ -0,0 +1,41 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+
+// Lock-free triple buffer between one producer and one consumer. The
+// producer always has a slot to write and the consumer always has the
+// latest complete one to read; neither ever waits. Intermediate values the
+// consumer did not get to are simply overwritten.
+template <typename T>
+class TripleBuffer {
+public:
+    // Producer: fill back(), then publish() it.
+    T& back() { return slots[backIndex]; }
+    void publish() {
+        uint8_t previous = middle.exchange(backIndex | FRESH, std::memory_order_acq_rel);
+        backIndex = previous & INDEX;
+    }
+
+    // Consumer: takes the newest published slot into front(); false if
+    // nothing was published since the last call.
+    bool update() {
+        if (!(middle.load(std::memory_order_relaxed) & FRESH)) {
+            return false;
+        }
+        uint8_t previous = middle.exchange(frontIndex, std::memory_order_acq_rel);
+        frontIndex = previous & INDEX;
+        return true;
+    }
+    const T& front() const { return slots[frontIndex]; }
+
+private:
+    static constexpr uint8_t INDEX = 0x3;
+    static constexpr uint8_t FRESH = 0x4; // middle holds an unread slot
+
+    std::array<T, 3> slots{};
+    alignas(64) uint8_t backIndex = 0;          // producer-owned
+    alignas(64) std::atomic<uint8_t> middle{1}; // shared
+    alignas(64) uint8_t frontIndex = 2;         // consumer-owned
+};
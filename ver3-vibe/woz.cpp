@@ -0,0 +1,176 @@
+#include "woz.hpp"
+#include <cstring>
+
+namespace woz {
+
+namespace {
+
+constexpr uint8_t SIGNATURE[8] = {'W', 'O', 'Z', '2', 0xFF, 0x0A, 0x0D, 0x0A};
+constexpr size_t HEADER_SIZE = 12;
+constexpr size_t BLOCK_SIZE = 512;
+constexpr size_t INFO_SIZE = 60;
+constexpr size_t TRK_ENTRY_SIZE = 8;
+
+uint16_t le16(const uint8_t* p) {
+    return p[0] | (p[1] << 8);
+}
+
+uint32_t le32(const uint8_t* p) {
+    return p[0] | (p[1] << 8) | (p[2] << 16) | (static_cast<uint32_t>(p[3]) << 24);
+}
+
+struct CrcTable {
+    uint32_t value[256];
+    CrcTable() {
+        for (uint32_t i = 0; i < 256; ++i) {
+            uint32_t c = i;
+            for (int k = 0; k < 8; ++k) {
+                c = (c & 1) ? 0xEDB88320 ^ (c >> 1) : c >> 1;
+            }
+            value[i] = c;
+        }
+    }
+};
+const CrcTable CRC_TABLE;
+
+} // namespace
+
+uint32_t crc32(const uint8_t* data, size_t size, uint32_t crc) {
+    crc = ~crc;
+    for (size_t i = 0; i < size; ++i) {
+        crc = CRC_TABLE.value[(crc ^ data[i]) & 0xFF] ^ (crc >> 8);
+    }
+    return ~crc;
+}
+
+std::vector<uint8_t> latchNibbles(const Track& track) {
+    std::vector<uint8_t> nibbles;
+    nibbles.reserve(track.bitCount / 8);
+    uint8_t shifter = 0;
+    for (uint32_t i = 0; i < track.bitCount * 2; ++i) {
+        shifter = static_cast<uint8_t>((shifter << 1) | track.bit(i % track.bitCount));
+        if (shifter & 0x80) {
+            if (i >= track.bitCount) {
+                nibbles.push_back(shifter);
+            }
+            shifter = 0;
+        }
+    }
+    return nibbles;
+}
+
+bool Image::open(const std::string& filename, std::string* error) {
+    close();
+    std::string message;
+    bool ok = false;
+    if (!file.open(filename, false)) {
+        message = "cannot open " + filename;
+    } else if (file.size() >= sizeof(SIGNATURE) && memcmp(file.data(), SIGNATURE, sizeof(SIGNATURE)) == 0) {
+        ok = parseWoz(message);
+    } else if (file.size() == NIB_IMAGE_SIZE) {
+        ok = parseNib(message);
+    } else if (file.size() >= 4 && memcmp(file.data(), "WOZ1", 4) == 0) {
+        message = "WOZ 1.0 images are not supported";
+    } else {
+        message = "not a WOZ 2.0 or .nib image";
+    }
+    if (!ok) {
+        close();
+        if (error) {
+            *error = message;
+        }
+    }
+    return ok;
+}
+
+void Image::close() {
+    file.close();
+    map.fill(NO_TRACK);
+    tracks.fill(Track{});
+    isWoz = false;
+    protectedFlag = true;
+    creatorName.clear();
+}
+
+bool Image::parseWoz(std::string& error) {
+    const uint8_t* data = file.data();
+    size_t size = file.size();
+    const uint8_t* info = nullptr;
+    const uint8_t* tmap = nullptr;
+    const uint8_t* trks = nullptr;
+
+    // INFO, TMAP and TRKS are required; META, WRIT, FLUX etc. are skipped.
+    for (size_t at = HEADER_SIZE; at + 8 <= size;) {
+        uint32_t length = le32(data + at + 4);
+        const uint8_t* body = data + at + 8;
+        if (length > size - at - 8) {
+            error = "truncated chunk";
+            return false;
+        }
+        if (memcmp(data + at, "INFO", 4) == 0 && length >= INFO_SIZE) {
+            info = body;
+        } else if (memcmp(data + at, "TMAP", 4) == 0 && length >= QUARTER_TRACKS) {
+            tmap = body;
+        } else if (memcmp(data + at, "TRKS", 4) == 0 && length >= QUARTER_TRACKS * TRK_ENTRY_SIZE) {
+            trks = body;
+        }
+        at += 8 + static_cast<size_t>(length);
+    }
+    if (!info || !tmap || !trks) {
+        error = "missing INFO, TMAP or TRKS chunk";
+        return false;
+    }
+    if (info[1] != 1) {
+        error = "not a 5.25\" disk";
+        return false;
+    }
+
+    for (int i = 0; i < QUARTER_TRACKS; ++i) {
+        const uint8_t* entry = trks + i * TRK_ENTRY_SIZE;
+        size_t start = le16(entry) * BLOCK_SIZE;
+        size_t blocks = le16(entry + 2);
+        uint32_t bitCount = le32(entry + 4);
+        if (blocks == 0) {
+            continue;
+        }
+        if (start + blocks * BLOCK_SIZE > size || bitCount > blocks * BLOCK_SIZE * 8) {
+            error = "track " + std::to_string(i) + " lies outside the file";
+            return false;
+        }
+        tracks[i] = Track{data + start, bitCount};
+    }
+    for (int q = 0; q < QUARTER_TRACKS; ++q) {
+        uint8_t index = tmap[q];
+        map[q] = index < QUARTER_TRACKS && !tracks[index].empty() ? index : NO_TRACK;
+    }
+
+    isWoz = true;
+    protectedFlag = info[2] != 0;
+    creatorName.assign(reinterpret_cast<const char*>(info + 5), 32);
+    creatorName.erase(creatorName.find_last_not_of(' ') + 1);
+    return true;
+}
+
+bool Image::parseNib(std::string&) {
+    for (int t = 0; t < 35; ++t) {
+        tracks[t] = Track{file.data() + t * NIB_TRACK_SIZE, static_cast<uint32_t>(NIB_TRACK_SIZE * 8)};
+        // Like a WOZ TMAP: the quarter tracks either side of a whole track
+        // read it too.
+        for (int q = t * 4 - 1; q <= t * 4 + 1; ++q) {
+            if (q >= 0) {
+                map[q] = t;
+            }
+        }
+    }
+    return true;
+}
+
+bool Image::verify() const {
+    if (!isWoz) {
+        return isOpen();
+    }
+    uint32_t stored = le32(file.data() + 8);
+    return stored == 0 || stored == crc32(file.data() + HEADER_SIZE, file.size() - HEADER_SIZE);
+}
+
+} // namespace woz
@@ -0,0 +1,69 @@
+#pragma once
+
+#include "mapped_file.hpp"
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// Bit-accurate disk images: WOZ 2.0 and raw .nib (35 tracks of 6656 nibbles).
+//
+// The file is memory-mapped read-only and parsed in place: each quarter
+// track resolves to a pointer into the mapping plus a bit count, so any bit
+// of any track is one index away and nothing is copied.
+namespace woz {
+
+constexpr int QUARTER_TRACKS = 160;
+constexpr size_t NIB_TRACK_SIZE = 6656;
+constexpr size_t NIB_IMAGE_SIZE = 35 * NIB_TRACK_SIZE; // 232,960 bytes
+
+// One track's bitstream, most significant bit of each byte first.
+struct Track {
+    const uint8_t* bits = nullptr;
+    uint32_t bitCount = 0;
+
+    bool empty() const { return bitCount == 0; }
+    uint8_t bit(uint32_t index) const { return (bits[index >> 3] >> (7 - (index & 7))) & 1; }
+};
+
+class Image {
+public:
+    // Maps and parses a .woz (by signature) or .nib (by size) file. On
+    // failure returns false and, if given, sets `error`.
+    bool open(const std::string& filename, std::string* error = nullptr);
+    void close();
+    bool isOpen() const { return file.isOpen(); }
+
+    // Track under the head at quarter track 0-159; empty if unformatted.
+    const Track& track(int quarterTrack) const { return tracks[map[quarterTrack]]; }
+
+    // Checks the WOZ CRC32 over the whole file. Always true for .nib, and
+    // for WOZ files written without a CRC (stored as 0).
+    bool verify() const;
+
+    bool writeProtected() const { return protectedFlag; }
+    const std::string& creator() const { return creatorName; }
+
+private:
+    bool parseWoz(std::string& error);
+    bool parseNib(std::string& error);
+
+    static constexpr uint8_t NO_TRACK = QUARTER_TRACKS; // index of the empty track
+
+    MappedFile file;
+    std::array<uint8_t, QUARTER_TRACKS> map{};   // quarter track -> tracks index
+    std::array<Track, QUARTER_TRACKS + 1> tracks{}; // last entry stays empty
+    bool isWoz = false;
+    bool protectedFlag = true;
+    std::string creatorName;
+};
+
+// One revolution of `track` as the controller latches it (a nibble is
+// complete when a 1 reaches bit 7), after a first revolution to sync up.
+std::vector<uint8_t> latchNibbles(const Track& track);
+
+// CRC32 (IEEE, as used by WOZ) of `size` bytes.
+uint32_t crc32(const uint8_t* data, size_t size, uint32_t crc = 0);
+
+} // namespace woz